@@ -0,0 +1,368 @@
+/**
+ * @file benchmark.cpp
+ * @author X. Y.
+ * @brief 控制器的性能测试
+ * @version 0.1
+ * @date 2023-08-20
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 对每个控制器、每种数据类型（float/double）、每种输入（随机/阶跃）、每种调用方式（Step/StepBlock）、
+ * 每种派发方式（static_dispatch 中的类型可以内联，virtual 为通过 DiscreteControllerBase 的虚函数调用）分别测试：
+ * - 先预热，再重复测量若干个样本，每个样本连续走 batch 个采样周期，记录平均每步的时间
+ * - 报告样本的最小值、中位数、p90、p99、最大值、平均值和吞吐量（百万步每秒）
+ * - 输出都经过 DoNotOptimize()，防止编译器把计算当作无用代码删掉
+ *
+ * 用法：
+ *   control_system_benchmark [--filter 子串] [--samples 样本数] [--batch 每个样本的步数] [--json 输出文件]
+ * 例如：
+ *   control_system_benchmark --filter PID --json pid.json
+ *
+ * 测试结果与编译选项、CPU 频率和负载有关，比较不同版本时应在同一台机器上用同样的编译选项运行
+ *
+ */
+
+#include "control_system/discrete_integrator.hpp"
+#include "control_system/pid_controller.hpp"
+#include "control_system/z_tf.hpp"
+#include "control_system/polynomial.hpp"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace control_system;
+
+namespace
+{
+
+/**
+ * @brief 让编译器认为 value 会被使用，不能删掉计算它的代码
+ *
+ */
+template <typename T>
+inline void DoNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile T sink;
+    sink = value;
+#endif
+}
+
+/**
+ * @brief 让编译器不知道指针指向的对象，用来阻止编译器把虚函数调用优化成直接调用
+ *
+ */
+template <typename T>
+inline T *HidePointer(T *pointer)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : "+r"(pointer));
+#endif
+    return pointer;
+}
+
+int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Options {
+    std::string filter;
+    std::string json;
+    size_t samples = 1000; // 样本数
+    size_t batch   = 1024; // 每个样本的步数
+    size_t warmup  = 64;   // 预热的样本数
+};
+
+struct Result {
+    std::string name;     // 控制器
+    std::string type;     // float / double
+    std::string input;    // random / step
+    std::string method;   // Step / StepBlock
+    std::string dispatch; // static / virtual
+    double min, p50, p90, p99, max, mean; // ns/step
+    double throughput;                    // 百万步每秒
+};
+
+/**
+ * @brief 输入序列：random 为 [-1, 1] 上的均匀分布，step 为每 256 步在 1 和 -1 之间切换的方波
+ *
+ */
+template <typename T>
+std::vector<T> MakeInput(const std::string &kind, size_t length)
+{
+    std::vector<T> input(length);
+    if (kind == "random") {
+        std::mt19937 generator(12345);
+        std::uniform_real_distribution<double> distribution(-1, 1);
+        for (auto &x : input) {
+            x = T(distribution(generator));
+        }
+    } else {
+        for (size_t i = 0; i < length; i++) {
+            input[i] = (i / 256) % 2 == 0 ? T(1) : T(-1);
+        }
+    }
+    return input;
+}
+
+double Percentile(const std::vector<double> &sorted, double p)
+{
+    auto index = size_t(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+/**
+ * @brief 测试一个控制器
+ *
+ * @param controller 可以是 static_dispatch 中的类型，也可以是 DiscreteControllerBase<T>
+ */
+template <typename Controller, typename T>
+Result Measure(Controller &controller, const std::vector<T> &input, bool block, const Options &options)
+{
+    std::vector<T> output(options.batch);
+    std::vector<double> samples;
+
+    auto run = [&] {
+        if (block) {
+            controller.StepBlock(input.data(), output.data(), options.batch);
+            DoNotOptimize(output.back());
+        } else {
+            for (size_t i = 0; i < options.batch; i++) {
+                DoNotOptimize(controller.Step(input[i]));
+            }
+        }
+    };
+
+    for (size_t s = 0; s < options.warmup; s++) {
+        run();
+    }
+
+    for (size_t s = 0; s < options.samples; s++) {
+        auto begin = Now();
+        run();
+        auto end = Now();
+        samples.push_back(double(end - begin) / options.batch);
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.min  = samples.front();
+    result.max  = samples.back();
+    result.p50  = Percentile(samples, 0.5);
+    result.p90  = Percentile(samples, 0.9);
+    result.p99  = Percentile(samples, 0.99);
+    result.mean = 0;
+    for (auto x : samples) {
+        result.mean += x;
+    }
+    result.mean /= samples.size();
+    result.throughput = 1e3 / result.mean;
+    return result;
+}
+
+class Runner
+{
+private:
+    Options options_;
+    std::vector<Result> results_;
+
+    bool Selected(const std::string &name) const
+    {
+        return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+    }
+
+    void Print(const Result &r) const
+    {
+        printf("%-28s %-6s %-6s %-9s %-7s min %8.2f  p50 %8.2f  p90 %8.2f  p99 %8.2f  max %9.2f ns/step  %8.1f Msteps/s\n",
+               r.name.c_str(), r.type.c_str(), r.input.c_str(), r.method.c_str(), r.dispatch.c_str(),
+               r.min, r.p50, r.p90, r.p99, r.max, r.throughput);
+    }
+
+public:
+    explicit Runner(const Options &options)
+        : options_{options} {};
+
+    /**
+     * @brief 对 make() 创建的控制器跑所有组合，每种组合用一个新的控制器
+     *
+     * @param name 名称
+     * @param make 返回 static_dispatch 中的控制器
+     */
+    template <typename T, typename Make>
+    void Add(const std::string &name, Make make)
+    {
+        using Static  = decltype(make());
+        using Dynamic = DynamicController<Static>;
+
+        if (!Selected(name)) return;
+
+        const char *type = sizeof(T) == sizeof(float) ? "float" : "double";
+        for (const char *input_kind : {"random", "step"}) {
+            auto input = MakeInput<T>(input_kind, options_.batch);
+
+            for (bool block : {false, true}) {
+                for (bool dynamic : {false, true}) {
+                    Result result;
+                    if (dynamic) {
+                        Dynamic controller{make()};
+                        auto base = HidePointer<DiscreteControllerBase<T>>(&controller);
+                        result    = Measure(*base, input, block, options_);
+                    } else {
+                        auto controller = make();
+                        result          = Measure(controller, input, block, options_);
+                    }
+
+                    result.name     = name;
+                    result.type     = type;
+                    result.input    = input_kind;
+                    result.method   = block ? "StepBlock" : "Step";
+                    result.dispatch = dynamic ? "virtual" : "static";
+                    Print(result);
+                    results_.push_back(result);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief 把结果写成 JSON
+     *
+     */
+    bool WriteJson(const std::string &path) const
+    {
+        FILE *file = fopen(path.c_str(), "w");
+        if (file == nullptr) return false;
+
+        char date[32];
+        auto now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        fprintf(file, "{\n");
+        fprintf(file, "  \"context\": {\n");
+        fprintf(file, "    \"date\": \"%s\",\n", date);
+#if defined(__clang__)
+        fprintf(file, "    \"compiler\": \"clang %s\",\n", __clang_version__);
+#elif defined(__GNUC__)
+        fprintf(file, "    \"compiler\": \"gcc %s\",\n", __VERSION__);
+#else
+        fprintf(file, "    \"compiler\": \"unknown\",\n");
+#endif
+#ifdef NDEBUG
+        fprintf(file, "    \"assertions\": false,\n");
+#else
+        fprintf(file, "    \"assertions\": true,\n");
+#endif
+        fprintf(file, "    \"samples\": %zu,\n", options_.samples);
+        fprintf(file, "    \"batch\": %zu,\n", options_.batch);
+        fprintf(file, "    \"warmup\": %zu\n", options_.warmup);
+        fprintf(file, "  },\n");
+        fprintf(file, "  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results_.size(); i++) {
+            const auto &r = results_[i];
+            fprintf(file,
+                    "    {\"name\": \"%s\", \"type\": \"%s\", \"input\": \"%s\", \"method\": \"%s\", \"dispatch\": \"%s\", "
+                    "\"ns_per_step\": {\"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f}, "
+                    "\"msteps_per_second\": %.4f}%s\n",
+                    r.name.c_str(), r.type.c_str(), r.input.c_str(), r.method.c_str(), r.dispatch.c_str(),
+                    r.min, r.p50, r.p90, r.p99, r.max, r.mean, r.throughput, i + 1 < results_.size() ? "," : "");
+        }
+        fprintf(file, "  ]\n");
+        fprintf(file, "}\n");
+
+        fclose(file);
+        return true;
+    }
+};
+
+/**
+ * @brief n 阶、极点都在 0.5 的稳定传递函数的分母：(1 - 0.5 z^-1)^n
+ *
+ */
+template <typename T>
+std::vector<T> StableDen(size_t order)
+{
+    std::vector<T> den{1};
+    for (size_t i = 0; i < order; i++) {
+        den = PolyMultiply(den, std::vector<T>{1, T(-0.5)});
+    }
+    return den;
+}
+
+template <typename T>
+void AddControllers(Runner &runner)
+{
+    namespace sd  = control_system::static_dispatch;
+    namespace psd = control_system::pid::static_dispatch;
+
+    for (size_t order : {1, 2, 4, 8, 16}) {
+        auto den = StableDen<T>(order);
+        std::vector<T> num(order + 1, T(0.1));
+        runner.Add<T>("ZTf order " + std::to_string(order), [=] { return sd::ZTf<T>(num, den); });
+    }
+
+    runner.Add<T>("DiscreteIntegrator", [] { return sd::DiscreteIntegrator<T>(2, 0.001); });
+    runner.Add<T>("DiscreteIntegratorSaturation", [] {
+        return sd::DiscreteIntegratorSaturation<T>(sd::DiscreteIntegrator<T>(2, 0.001), Saturation<T, T>(-1, 1));
+    });
+
+    runner.Add<T>("pid::P", [] { return psd::P<T>(1.23); });
+    runner.Add<T>("pid::PI", [] { return psd::PI<T>(1.23, 0.54, 0.001); });
+    runner.Add<T>("pid::PD", [] { return psd::PD<T>(1.23, 0.1, 100, 0.001); });
+    runner.Add<T>("pid::PID", [] { return psd::PID<T>(1.23, 0.54, 0.1, 100, 0.001); });
+    runner.Add<T>("pid::PI_AntiWindup", [] { return psd::PI_AntiWindup<T>(1.23, 0.54, 0.001, 1, -1, 1); });
+    runner.Add<T>("pid::PID_AntiWindup", [] { return psd::PID_AntiWindup<T>(1.23, 0.54, 0.1, 100, 0.001, 1, -1, 1); });
+}
+
+void Usage(const char *program)
+{
+    printf("usage: %s [--filter substring] [--samples n] [--batch n] [--warmup n] [--json file]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        auto has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--filter") == 0 && has_value) {
+            options.filter = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && has_value) {
+            options.json = argv[++i];
+        } else if (strcmp(argv[i], "--samples") == 0 && has_value) {
+            options.samples = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--batch") == 0 && has_value) {
+            options.batch = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+            options.warmup = std::max(0, atoi(argv[++i]));
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Runner runner(options);
+    AddControllers<float>(runner);
+    AddControllers<double>(runner);
+
+    if (!options.json.empty()) {
+        if (!runner.WriteJson(options.json)) {
+            fprintf(stderr, "cannot write %s\n", options.json.c_str());
+            return 1;
+        }
+        printf("results written to %s\n", options.json.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file arena.hpp
+ * @author X. Y.
+ * @brief 线性内存池
+ * @version 0.1
+ * @date 2023-08-05
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 一次申请一整块内存，之后按顺序切分，不单独释放，只能整体清空
+ * 用于初始化时一次性创建大量小对象，让它们在内存中连续排列，运行时不再申请内存
+ *
+ * 使用示例：
+ * control_system::Arena arena(4096);
+ * void *p = arena.Allocate(sizeof(Foo), alignof(Foo));
+ * auto foo = new (p) Foo(); // 析构函数需要自己调用
+ *
+ */
+
+#pragma once
+
+#include <new>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+namespace control_system
+{
+
+class Arena
+{
+private:
+    static constexpr size_t kAlignment = 64; // 整块内存按缓存行对齐
+
+    unsigned char *buffer_ = nullptr;
+    size_t capacity_       = 0;
+    size_t used_           = 0;
+
+    void Release()
+    {
+        if (buffer_ != nullptr) {
+            ::operator delete(buffer_, std::align_val_t{kAlignment});
+        }
+        buffer_   = nullptr;
+        capacity_ = 0;
+        used_     = 0;
+    }
+
+public:
+    Arena(){};
+
+    /**
+     * @brief 申请一块内存
+     *
+     * @param capacity 字节数
+     */
+    explicit Arena(size_t capacity)
+    {
+        Reserve(capacity);
+    }
+
+    Arena(const Arena &)            = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    Arena(Arena &&other) noexcept
+        : buffer_{std::exchange(other.buffer_, nullptr)},
+          capacity_{std::exchange(other.capacity_, 0)},
+          used_{std::exchange(other.used_, 0)} {};
+
+    Arena &operator=(Arena &&other) noexcept
+    {
+        if (this != &other) {
+            Release();
+            buffer_   = std::exchange(other.buffer_, nullptr);
+            capacity_ = std::exchange(other.capacity_, 0);
+            used_     = std::exchange(other.used_, 0);
+        }
+        return *this;
+    }
+
+    ~Arena()
+    {
+        Release();
+    }
+
+    /**
+     * @brief 释放原来的内存，重新申请一块
+     * @note 原来分配出去的内存全部失效，其中的对象需要事先析构
+     *
+     * @param capacity 字节数
+     */
+    void Reserve(size_t capacity)
+    {
+        Release();
+        if (capacity > 0) {
+            buffer_   = static_cast<unsigned char *>(::operator new(capacity, std::align_val_t{kAlignment}));
+            capacity_ = capacity;
+        }
+    }
+
+    /**
+     * @brief 分配一段内存
+     *
+     * @param size 字节数
+     * @param alignment 对齐字节数，必须是 2 的幂，且不大于 64
+     */
+    void *Allocate(size_t size, size_t alignment)
+    {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+        assert(alignment <= kAlignment);
+
+        size_t offset = AlignUp(used_, alignment);
+        assert(offset + size <= capacity_); // 容量不够，需要在 Reserve() 时留足
+
+        used_ = offset + size;
+        return buffer_ + offset;
+    }
+
+    /**
+     * @brief 清空（不释放内存），之后可以重新分配
+     *
+     */
+    void Clear()
+    {
+        used_ = 0;
+    }
+
+    size_t Used() const
+    {
+        return used_;
+    }
+
+    size_t Capacity() const
+    {
+        return capacity_;
+    }
+
+    /**
+     * @brief 分配 size 字节、alignment 对齐的内存，最多需要占用的字节数
+     *
+     */
+    static constexpr size_t MaxFootprint(size_t size, size_t alignment)
+    {
+        return size + alignment - 1;
+    }
+
+    static constexpr size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+};
+
+} // namespace control_system
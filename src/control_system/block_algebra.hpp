@@ -0,0 +1,539 @@
+/**
+ * @file block_algebra.hpp
+ * @author X. Y.
+ * @brief 控制器的串联、并联、反馈组合
+ * @version 0.1
+ * @date 2023-08-03
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Series(a, b)、Parallel(a, b)（也可以写成 a + b）、Feedback(g, h) 把几个控制器组合成一个新的控制器：
+ * - 如果参与组合的都是线性控制器（ZTf、P、D、积分器、不带积分限幅的 PID/PI/PD），
+ *   在创建时直接求出组合后的传递函数，约去相同的零极点，得到一个 static_dispatch::ZTf
+ * - 否则得到一个组合类型（SeriesBlock、ParallelBlock、FeedbackBlock），
+ *   它的 Step() 依次调用各个控制器的 Step()，都不是虚函数，可以完全内联
+ *
+ * 参与组合的控制器会被拷贝（虚函数接口的控制器会取出其中的 static_dispatch 类型），之后与原来的对象无关
+ * 组合后的控制器从零状态开始运行
+ *
+ * 反馈通道 h 的输入是上一个周期的输出，也就是 Feedback(g, h) = g / (1 + z^-1 g h)，
+ * 与数字控制回路中本周期只能用到上一个周期的测量值一致，也避免了代数环
+ *
+ * 使用示例：
+ * control_system::ZTf<float> prefilter({0.2}, {1, -0.8});
+ * control_system::pid::PID<float> pid{1.23, 0.54, 0, 1000, 0.01};
+ * control_system::Saturation<float, float> saturation{-10, 10};
+ * auto controller = control_system::Series(control_system::Series(prefilter, pid), saturation);
+ * controller.Step(1);
+ *
+ */
+
+#pragma once
+
+#include "discrete_controller_base.hpp"
+#include "pid_controller.hpp"
+#include "discrete_integrator.hpp"
+#include "saturation.hpp"
+#include "polynomial.hpp"
+#include "z_tf.hpp"
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace control_system
+{
+
+/**
+ * @brief Z 传递函数的分子和分母（降幂排列，与 ZTf 的参数相同）
+ *
+ */
+struct TfPolynomials {
+    std::vector<double> num;
+    std::vector<double> den;
+};
+
+/**
+ * @brief 约去分子分母中相同的零极点（类似 Matlab 的 minreal），并使分母首项为 1
+ *
+ * @param tf 传递函数
+ * @param tolerance 零点与极点的距离小于 tolerance * max(1, |极点|) 时视为相同
+ */
+inline TfPolynomials MinReal(const TfPolynomials &tf, double tolerance = 1e-6)
+{
+    auto num = PolyTrim(tf.num);
+    auto den = PolyTrim(tf.den);
+
+    if (num.empty() || (num.size() == 1 && num[0] == 0)) return {{0}, {1}};
+
+    auto zeros = PolyRoots(num);
+    auto poles = PolyRoots(den);
+
+    std::vector<std::complex<double>> kept_zeros;
+    std::vector<bool> cancelled(poles.size(), false);
+    for (const auto &z : zeros) {
+        bool found = false;
+        for (size_t j = 0; j < poles.size(); j++) {
+            if (!cancelled[j] && std::abs(z - poles[j]) <= tolerance * std::max(1.0, std::abs(poles[j]))) {
+                cancelled[j] = true;
+                found        = true;
+                break;
+            }
+        }
+        if (!found) kept_zeros.push_back(z);
+    }
+
+    TfPolynomials result;
+
+    if (kept_zeros.size() == zeros.size()) {
+        // 没有可以约去的零极点，保留原来的系数，避免由根重新构造多项式带来的舍入误差
+        result = {num, den};
+    } else {
+        std::vector<std::complex<double>> kept_poles;
+        for (size_t j = 0; j < poles.size(); j++) {
+            if (!cancelled[j]) kept_poles.push_back(poles[j]);
+        }
+
+        for (const auto &c : PolyFromRoots(kept_zeros)) {
+            result.num.push_back(num[0] * c.real());
+        }
+        for (const auto &c : PolyFromRoots(kept_poles)) {
+            result.den.push_back(den[0] * c.real());
+        }
+    }
+
+    auto den0 = result.den[0];
+    for (auto &c : result.num) {
+        c /= den0;
+    }
+    for (auto &c : result.den) {
+        c /= den0;
+    }
+
+    return result;
+}
+
+/**
+ * 以下 LinearTf() 给出线性控制器的传递函数（只使用参数，不使用状态）
+ * 没有 LinearTf() 的控制器都按非线性处理。自定义的线性控制器也可以在自己的命名空间中提供 LinearTf()
+ */
+
+template <typename T>
+TfPolynomials LinearTf(const static_dispatch::ZTf<T> &ztf)
+{
+    TfPolynomials tf;
+    for (const auto &c : ztf.GetInputCoefficients()) {
+        tf.num.push_back(c);
+    }
+    for (const auto &c : ztf.GetOutputCoefficients()) {
+        tf.den.push_back(-c);
+    }
+    return tf;
+}
+
+/**
+ * @brief 积分器：c (z + 1) / (z - 1)，其中 c = Ki * Ts / 2
+ *
+ */
+template <typename T>
+TfPolynomials LinearTf(const static_dispatch::DiscreteIntegrator<T> &integrator)
+{
+    double c = integrator.GetInputCoefficient();
+    return {{c, c}, {1, -1}};
+}
+
+// 带限幅的积分器不是线性的
+template <typename T>
+void LinearTf(const static_dispatch::DiscreteIntegratorSaturation<T> &) = delete;
+
+template <typename T>
+TfPolynomials LinearTf(const pid::static_dispatch::P<T> &p)
+{
+    return {{double(p.GetKp())}, {1}};
+}
+
+/**
+ * @brief 微分器：ci (z - 1) / (z - co)
+ *
+ */
+template <typename T>
+TfPolynomials LinearTf(const pid::static_dispatch::D<T> &d)
+{
+    double ci = d.GetInputCoefficient();
+    double co = d.GetOutputCoefficient();
+    return {{ci, -ci}, {1, -co}};
+}
+
+namespace detail
+{
+
+inline TfPolynomials SeriesTf(const TfPolynomials &a, const TfPolynomials &b)
+{
+    return {PolyMultiply(a.num, b.num), PolyMultiply(a.den, b.den)};
+}
+
+inline TfPolynomials ParallelTf(const TfPolynomials &a, const TfPolynomials &b)
+{
+    return {PolyAdd(PolyMultiply(a.num, b.den), PolyMultiply(b.num, a.den)), PolyMultiply(a.den, b.den)};
+}
+
+/**
+ * @brief g / (1 + z^-1 g h) = z g.num h.den / (z g.den h.den + g.num h.num)
+ *
+ */
+inline TfPolynomials FeedbackTf(const TfPolynomials &g, const TfPolynomials &h)
+{
+    const std::vector<double> z{1, 0};
+    return {PolyMultiply(PolyMultiply(g.num, h.den), z),
+            PolyAdd(PolyMultiply(PolyMultiply(g.den, h.den), z), PolyMultiply(g.num, h.num))};
+}
+
+inline TfPolynomials GainTf(double k)
+{
+    return {{k}, {1}};
+}
+
+} // namespace detail
+
+template <typename T, typename IntegratorType, typename DType>
+auto LinearTf(const pid::static_dispatch::PID<T, IntegratorType, DType> &pid)
+    -> decltype(LinearTf(std::declval<const IntegratorType &>()))
+{
+    auto tf = detail::ParallelTf(detail::GainTf(pid.Kp), LinearTf(pid.i_controller));
+    return detail::ParallelTf(tf, LinearTf(pid.d_controller));
+}
+
+template <typename T, typename IntegratorType>
+auto LinearTf(const pid::static_dispatch::PI<T, IntegratorType> &pi)
+    -> decltype(LinearTf(std::declval<const IntegratorType &>()))
+{
+    return detail::ParallelTf(detail::GainTf(pi.Kp), LinearTf(pi.i_controller));
+}
+
+template <typename T, typename DType>
+TfPolynomials LinearTf(const pid::static_dispatch::PD<T, DType> &pd)
+{
+    return detail::ParallelTf(detail::GainTf(pd.Kp), LinearTf(pd.d_controller));
+}
+
+/**
+ * @brief 把限幅器当作控制器使用
+ *
+ */
+template <typename T>
+class SaturationBlock : public StaticControllerBase<SaturationBlock<T>, T>
+{
+public:
+    Saturation<T, T> saturation;
+
+    SaturationBlock(const Saturation<T, T> &saturation)
+        : saturation{saturation} {};
+
+    T Step(T input)
+    {
+        return saturation(input);
+    }
+
+    void ResetState(){};
+};
+
+namespace detail
+{
+
+// 是否是没有再派生的虚函数接口的控制器（DynamicController 或 ZTf 等公开类型本身）
+template <typename Block, typename = void>
+struct IsExactDynamic : std::false_type {
+};
+
+template <typename Block>
+struct IsExactDynamic<Block, std::void_t<typename Block::ExactType>> : std::is_same<Block, typename Block::ExactType> {
+};
+
+// 参与组合前的转换：虚函数接口的控制器取出其中的 static_dispatch 类型，限幅器转换为 SaturationBlock
+// 用户再派生的类型可能重写了 Step()，保持原样
+template <typename Block, std::enable_if_t<!IsExactDynamic<Block>::value, int> = 0>
+const Block &ToBlock(const Block &block)
+{
+    return block;
+}
+
+template <typename Block, std::enable_if_t<IsExactDynamic<Block>::value, int> = 0>
+const auto &ToBlock(const Block &controller)
+{
+    return controller.GetController();
+}
+
+template <typename T>
+SaturationBlock<T> ToBlock(const Saturation<T, T> &saturation)
+{
+    return saturation;
+}
+
+template <typename X>
+using BlockType = std::decay_t<decltype(ToBlock(std::declval<const X &>()))>;
+
+template <typename X, typename = void>
+struct IsBlock : std::false_type {
+};
+
+template <typename X>
+struct IsBlock<X, std::void_t<typename BlockType<X>::ValueType,
+                              decltype(std::declval<BlockType<X> &>().ResetState())>> : std::true_type {
+};
+
+template <typename X, typename = void>
+struct IsLinear : std::false_type {
+};
+
+template <typename X>
+struct IsLinear<X, std::void_t<decltype(LinearTf(std::declval<const X &>()))>> : std::true_type {
+};
+
+template <typename T>
+static_dispatch::ZTf<T> MakeZTf(const TfPolynomials &tf)
+{
+    return static_dispatch::ZTf<T>(std::vector<T>(tf.num.begin(), tf.num.end()),
+                                   std::vector<T>(tf.den.begin(), tf.den.end()));
+}
+
+} // namespace detail
+
+/**
+ * @brief 串联：先经过 a，再经过 b
+ *
+ */
+template <typename A, typename B>
+class SeriesBlock : public StaticControllerBase<SeriesBlock<A, B>, typename A::ValueType>
+{
+private:
+    using T = typename A::ValueType;
+
+    A a_;
+    B b_;
+
+public:
+    SeriesBlock(const A &a, const B &b)
+        : a_{a}, b_{b}
+    {
+        ResetState();
+    }
+
+    T Step(T input)
+    {
+        return b_.Step(a_.Step(input));
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        a_.StepBlock(input, output, n);
+        b_.StepBlock(output, output, n);
+    }
+
+    void ResetState()
+    {
+        a_.ResetState();
+        b_.ResetState();
+    }
+
+    A &GetFirst()
+    {
+        return a_;
+    }
+
+    B &GetSecond()
+    {
+        return b_;
+    }
+};
+
+/**
+ * @brief 并联：a 与 b 的输出相加
+ *
+ */
+template <typename A, typename B>
+class ParallelBlock : public StaticControllerBase<ParallelBlock<A, B>, typename A::ValueType>
+{
+private:
+    using T    = typename A::ValueType;
+    using Base = StaticControllerBase<ParallelBlock<A, B>, T>;
+    using Base::kBlockBufferSize;
+
+    A a_;
+    B b_;
+
+public:
+    ParallelBlock(const A &a, const B &b)
+        : a_{a}, b_{b}
+    {
+        ResetState();
+    }
+
+    T Step(T input)
+    {
+        return a_.Step(input) + b_.Step(input);
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        T a_output[kBlockBufferSize];
+
+        for (size_t begin = 0; begin < n; begin += kBlockBufferSize) {
+            auto length = std::min(n - begin, kBlockBufferSize);
+
+            // a 先算，b 再原地写 output，这样 input 和 output 可以是同一个数组
+            a_.StepBlock(input + begin, a_output, length);
+            b_.StepBlock(input + begin, output + begin, length);
+
+            for (size_t i = 0; i < length; i++) {
+                output[begin + i] += a_output[i];
+            }
+        }
+    }
+
+    void ResetState()
+    {
+        a_.ResetState();
+        b_.ResetState();
+    }
+
+    A &GetFirst()
+    {
+        return a_;
+    }
+
+    B &GetSecond()
+    {
+        return b_;
+    }
+};
+
+/**
+ * @brief 负反馈：e = u - h(上一个周期的 y)，y = g(e)
+ *
+ */
+template <typename G, typename H>
+class FeedbackBlock : public StaticControllerBase<FeedbackBlock<G, H>, typename G::ValueType>
+{
+private:
+    using T = typename G::ValueType;
+
+    G g_;
+    H h_;
+    T last_output_;
+
+public:
+    FeedbackBlock(const G &g, const H &h)
+        : g_{g}, h_{h}
+    {
+        ResetState();
+    }
+
+    T Step(T input)
+    {
+        last_output_ = g_.Step(input - h_.Step(last_output_));
+        return last_output_;
+    }
+
+    void ResetState()
+    {
+        g_.ResetState();
+        h_.ResetState();
+        last_output_ = 0;
+    }
+
+    G &GetForward()
+    {
+        return g_;
+    }
+
+    H &GetFeedback()
+    {
+        return h_;
+    }
+};
+
+/**
+ * @brief 串联
+ *
+ * @return 都是线性控制器时为 static_dispatch::ZTf，否则为 SeriesBlock
+ */
+template <typename A, typename B>
+auto Series(const A &a, const B &b)
+{
+    using BlockA = detail::BlockType<A>;
+    using BlockB = detail::BlockType<B>;
+    using T      = typename BlockA::ValueType;
+    static_assert(std::is_same<T, typename BlockB::ValueType>::value, "组合的控制器数据类型必须相同");
+
+    const BlockA &block_a = detail::ToBlock(a);
+    const BlockB &block_b = detail::ToBlock(b);
+
+    if constexpr (detail::IsLinear<BlockA>::value && detail::IsLinear<BlockB>::value) {
+        return detail::MakeZTf<T>(MinReal(detail::SeriesTf(LinearTf(block_a), LinearTf(block_b))));
+    } else {
+        return SeriesBlock<BlockA, BlockB>(block_a, block_b);
+    }
+}
+
+/**
+ * @brief 并联
+ *
+ * @return 都是线性控制器时为 static_dispatch::ZTf，否则为 ParallelBlock
+ */
+template <typename A, typename B>
+auto Parallel(const A &a, const B &b)
+{
+    using BlockA = detail::BlockType<A>;
+    using BlockB = detail::BlockType<B>;
+    using T      = typename BlockA::ValueType;
+    static_assert(std::is_same<T, typename BlockB::ValueType>::value, "组合的控制器数据类型必须相同");
+
+    const BlockA &block_a = detail::ToBlock(a);
+    const BlockB &block_b = detail::ToBlock(b);
+
+    if constexpr (detail::IsLinear<BlockA>::value && detail::IsLinear<BlockB>::value) {
+        return detail::MakeZTf<T>(MinReal(detail::ParallelTf(LinearTf(block_a), LinearTf(block_b))));
+    } else {
+        return ParallelBlock<BlockA, BlockB>(block_a, block_b);
+    }
+}
+
+/**
+ * @brief 负反馈，反馈通道 h 的输入是上一个周期的输出
+ *
+ * @param g 前向通道
+ * @param h 反馈通道
+ * @return 都是线性控制器时为 static_dispatch::ZTf，否则为 FeedbackBlock
+ */
+template <typename G, typename H>
+auto Feedback(const G &g, const H &h)
+{
+    using BlockG = detail::BlockType<G>;
+    using BlockH = detail::BlockType<H>;
+    using T      = typename BlockG::ValueType;
+    static_assert(std::is_same<T, typename BlockH::ValueType>::value, "组合的控制器数据类型必须相同");
+
+    const BlockG &block_g = detail::ToBlock(g);
+    const BlockH &block_h = detail::ToBlock(h);
+
+    if constexpr (detail::IsLinear<BlockG>::value && detail::IsLinear<BlockH>::value) {
+        return detail::MakeZTf<T>(MinReal(detail::FeedbackTf(LinearTf(block_g), LinearTf(block_h))));
+    } else {
+        return FeedbackBlock<BlockG, BlockH>(block_g, block_h);
+    }
+}
+
+/**
+ * @brief 并联，与 Parallel(a, b) 相同
+ *
+ */
+template <typename A, typename B, typename = std::enable_if_t<detail::IsBlock<A>::value && detail::IsBlock<B>::value>>
+auto operator+(const A &a, const B &b)
+{
+    return Parallel(a, b);
+}
+
+} // namespace control_system
@@ -0,0 +1,624 @@
+/**
+ * @file block_diagram.hpp
+ * @author X. Y.
+ * @brief 运行时搭建的框图
+ * @version 0.1
+ * @date 2023-08-05
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 类似 Simulink 的框图：在运行时添加模块（ZTf、PID、积分器、限幅器等）并连线，然后整体按周期运行
+ * - 每个模块只有一个输入和一个输出，输入是若干信号的加权和（相当于 Simulink 中的 Sum 和 Gain）
+ * - Compile() 时计算一次执行顺序（拓扑排序），并检查代数环；UnitDelay 的输出只与上一个周期有关，可以用来断开环路
+ * - Compile() 时把所有信号和模块（按执行顺序）放在同一块连续的内存（Arena）中，连线存放在连续的数组中，
+ *   Step() 时不申请内存，每个模块一次函数指针调用
+ * - 只有一条增益为 1 的输入连线时（串联），模块直接读取源信号，不做加权求和
+ * - StepBlock() 直接读写各个通道的数据（如内存映射的信号文件）：没有 UnitDelay 时按执行顺序每个模块对一块
+ *   （kBlockSize 个采样）调用一次 StepBlock()，结果与逐个 Step() 逐位相同；有 UnitDelay 时信号跨周期相关，逐个采样运行
+ *
+ * 使用示例：
+ * control_system::BlockDiagram<float> diagram;
+ * auto r     = diagram.AddInput();
+ * auto pid   = diagram.AddBlock(control_system::pid::PID<float>{1.23, 0.54, 0, 1000, 0.01});
+ * auto plant = diagram.AddBlock(control_system::ZTf<float>({0.1}, {1, -0.9}));
+ * auto delay = diagram.AddUnitDelay();
+ * diagram.Connect(r, pid);         // pid 的输入 = r - delay
+ * diagram.Connect(delay, pid, -1);
+ * diagram.Connect(pid, plant);
+ * diagram.Connect(plant, delay);
+ * diagram.AddOutput(plant);
+ * diagram.Compile();
+ * float y;
+ * diagram.Step(&reference, &y);
+ *
+ */
+
+#pragma once
+
+#include "arena.hpp"
+#include "block_algebra.hpp"
+#include <vector>
+#include <functional>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+namespace control_system
+{
+
+template <typename T>
+class BlockDiagram
+{
+private:
+    using StepFunction      = T (*)(void *block, T input);
+    using StepBlockFunction = void (*)(void *block, const T *input, T *output, size_t n);
+    using ResetFunction   = void (*)(void *block);
+    using DestroyFunction = void (*)(void *block);
+
+    enum class NodeType {
+        kInput,
+        kBlock,
+        kUnitDelay,
+    };
+
+    // 搭建时的节点信息
+    struct NodeSpec {
+        NodeType type;
+        size_t size      = 0; // 模块对象的大小和对齐
+        size_t alignment = 1;
+        std::function<void *(void *)> construct; // 在给定的内存上拷贝构造模块
+        StepFunction step            = nullptr;
+        StepBlockFunction step_block = nullptr;
+        ResetFunction reset          = nullptr;
+        DestroyFunction destroy = nullptr;
+        T initial_value         = 0; // UnitDelay 的初值
+    };
+
+    struct EdgeSpec {
+        size_t from, to;
+        T gain;
+    };
+
+    static constexpr uint32_t kNoSource = UINT32_MAX;
+
+    // 运行时的模块，按执行顺序排列
+    struct Node {
+        void *block;
+        StepFunction step;
+        StepBlockFunction step_block;
+        uint32_t edge_begin, edge_end; // 在 edge_source_ 和 edge_gain_ 中的范围
+        uint32_t source;               // 只有一条增益为 1 的连线时为源信号的位置，否则为 kNoSource
+        uint32_t output;               // 输出信号的位置
+    };
+
+    struct Delay {
+        uint32_t edge_begin, edge_end;
+        uint32_t source; // 与 Node::source 相同
+        uint32_t output;
+        T state;
+        T initial_value;
+    };
+
+    // 搭建时的数据
+    std::vector<NodeSpec> specs_;
+    std::vector<EdgeSpec> edge_specs_;
+    std::vector<size_t> output_specs_;
+
+    // Compile() 后的数据
+    Arena arena_;
+    std::vector<size_t> block_order_; // 按执行顺序排列的模块节点编号
+    std::vector<Node> nodes_;         // 与 block_order_ 一一对应
+    std::vector<Delay> delays_;
+    std::vector<uint32_t> edge_source_; // 每个模块的输入连线，按模块的执行顺序连续存放
+    std::vector<T> edge_gain_;
+    T *signals_          = nullptr; // 所有信号：输入、UnitDelay 的输出、模块的输出，放在 arena_ 的开头
+    size_t signal_count_ = 0;
+    std::vector<uint32_t> input_slots_;  // 第 i 个外部输入在 signals_ 中的位置
+    std::vector<uint32_t> output_slots_; // 第 i 个外部输出在 signals_ 中的位置
+    std::vector<uint32_t> slot_of_node_; // 节点编号 -> signals_ 中的位置
+    T *block_signals_ = nullptr;              // StepBlock()：每个信号 kBlockSize 个值，只在没有 UnitDelay 时分配
+    T *block_sum_     = nullptr;              // StepBlock()：加权求和的结果
+    std::vector<const T *> block_sources_;    // StepBlock()：每个信号当前一块数据的位置（外部输入直接指向通道）
+    std::vector<size_t> algebraic_loop_;
+    bool is_compiled_ = false;
+
+    template <typename Block>
+    static T StepThunk(void *block, T input)
+    {
+        return static_cast<Block *>(block)->Step(input);
+    }
+
+    template <typename Block>
+    static void StepBlockThunk(void *block, const T *input, T *output, size_t n)
+    {
+        static_cast<Block *>(block)->StepBlock(input, output, n);
+    }
+
+    template <typename Block>
+    static void ResetThunk(void *block)
+    {
+        static_cast<Block *>(block)->ResetState();
+    }
+
+    template <typename Block>
+    static void DestroyThunk(void *block)
+    {
+        static_cast<Block *>(block)->~Block();
+    }
+
+    void DestroyBlocks()
+    {
+        for (size_t i = 0; i < nodes_.size(); i++) {
+            auto &spec = specs_[block_order_[i]];
+            spec.destroy(nodes_[i].block);
+        }
+        nodes_.clear();
+        block_order_.clear();
+        signals_       = nullptr;
+        signal_count_  = 0;
+        block_signals_ = nullptr;
+        block_sum_     = nullptr;
+        block_sources_.clear();
+        arena_.Clear();
+        is_compiled_ = false;
+    }
+
+    T Input(uint32_t source, uint32_t begin, uint32_t end) const
+    {
+        return source != kNoSource ? signals_[source] : Sum(begin, end);
+    }
+
+    T Sum(uint32_t begin, uint32_t end) const
+    {
+        T sum = 0;
+        for (uint32_t e = begin; e < end; e++) {
+            sum += edge_gain_[e] * signals_[edge_source_[e]];
+        }
+        return sum;
+    }
+
+    // 与 Sum() 相同的求和顺序，对一块中的每个采样
+    const T *SumBlock(uint32_t begin, uint32_t end, size_t count)
+    {
+        std::fill(block_sum_, block_sum_ + count, T(0));
+        for (uint32_t e = begin; e < end; e++) {
+            const T gain   = edge_gain_[e];
+            const T *input = block_sources_[edge_source_[e]];
+            for (size_t k = 0; k < count; k++) {
+                block_sum_[k] += gain * input[k];
+            }
+        }
+        return block_sum_;
+    }
+
+    // 外部输入已经写入 signals_ 后走一个周期
+    void StepSignals()
+    {
+        for (const auto &delay : delays_) {
+            signals_[delay.output] = delay.state;
+        }
+
+        for (const auto &node : nodes_) {
+            signals_[node.output] = node.step(node.block, Input(node.source, node.edge_begin, node.edge_end));
+        }
+
+        for (auto &delay : delays_) {
+            delay.state = Input(delay.source, delay.edge_begin, delay.edge_end);
+        }
+    }
+
+    /**
+     * @brief 拓扑排序，只考虑指向普通模块的连线（UnitDelay 的输入不影响本周期的执行顺序）
+     *
+     * @return 是否成功（没有代数环）
+     */
+    bool Schedule()
+    {
+        const size_t count = specs_.size();
+        std::vector<size_t> in_degree(count, 0);
+        std::vector<std::vector<size_t>> successors(count);
+
+        for (const auto &edge : edge_specs_) {
+            if (specs_[edge.to].type == NodeType::kBlock && specs_[edge.from].type == NodeType::kBlock) {
+                in_degree[edge.to]++;
+                successors[edge.from].push_back(edge.to);
+            }
+        }
+
+        std::vector<size_t> ready;
+        for (size_t i = 0; i < count; i++) {
+            if (specs_[i].type == NodeType::kBlock && in_degree[i] == 0) ready.push_back(i);
+        }
+
+        // 按编号从小到大取，执行顺序尽量与添加顺序一致
+        std::reverse(ready.begin(), ready.end());
+        block_order_.clear();
+        while (!ready.empty()) {
+            auto node = ready.back();
+            ready.pop_back();
+            block_order_.push_back(node);
+
+            for (auto next : successors[node]) {
+                if (--in_degree[next] == 0) ready.push_back(next);
+            }
+        }
+
+        // 没有排进去的模块处于环中或者在环的下游，反复去掉没有后继的模块，剩下的就是代数环
+        algebraic_loop_.clear();
+        std::vector<bool> remaining(count, false);
+        size_t remaining_count = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (specs_[i].type == NodeType::kBlock && in_degree[i] > 0) {
+                remaining[i] = true;
+                remaining_count++;
+            }
+        }
+        if (remaining_count == 0) return true;
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = 0; i < count; i++) {
+                if (!remaining[i]) continue;
+                bool has_successor = false;
+                for (auto next : successors[i]) {
+                    has_successor = has_successor || remaining[next];
+                }
+                if (!has_successor) {
+                    remaining[i] = false;
+                    changed      = true;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (remaining[i]) algebraic_loop_.push_back(i);
+        }
+        block_order_.clear();
+        return false;
+    }
+
+public:
+    static constexpr size_t kBlockSize = 64; // StepBlock() 中每个模块一次处理的采样数
+
+    BlockDiagram(){};
+
+    BlockDiagram(const BlockDiagram &)            = delete;
+    BlockDiagram &operator=(const BlockDiagram &) = delete;
+
+    ~BlockDiagram()
+    {
+        DestroyBlocks();
+    }
+
+    /**
+     * @brief 添加一个外部输入
+     *
+     * @return 节点编号
+     */
+    size_t AddInput()
+    {
+        NodeSpec spec;
+        spec.type = NodeType::kInput;
+        specs_.push_back(std::move(spec));
+        is_compiled_ = false;
+        return specs_.size() - 1;
+    }
+
+    /**
+     * @brief 添加一个模块（拷贝一份）
+     *
+     * @param block 任意控制器（静态多态或虚函数接口的都可以），也可以是 Saturation
+     * @return 节点编号
+     */
+    template <typename Block>
+    size_t AddBlock(const Block &block)
+    {
+        using Type = detail::BlockType<Block>;
+        static_assert(std::is_same<typename Type::ValueType, T>::value, "模块的数据类型必须与框图相同");
+
+        Type prototype = detail::ToBlock(block);
+
+        NodeSpec spec;
+        spec.type      = NodeType::kBlock;
+        spec.size      = sizeof(Type);
+        spec.alignment = alignof(Type);
+        spec.construct = [prototype](void *memory) -> void * { return new (memory) Type(prototype); };
+        spec.step       = &BlockDiagram::StepThunk<Type>;
+        spec.step_block = &BlockDiagram::StepBlockThunk<Type>;
+        spec.reset      = &BlockDiagram::ResetThunk<Type>;
+        spec.destroy    = &BlockDiagram::DestroyThunk<Type>;
+        specs_.push_back(std::move(spec));
+        is_compiled_ = false;
+        return specs_.size() - 1;
+    }
+
+    /**
+     * @brief 添加一个单位延迟（输出为上一个周期的输入），可以用来断开代数环
+     *
+     * @param initial_value 第一个周期的输出
+     * @return 节点编号
+     */
+    size_t AddUnitDelay(T initial_value = 0)
+    {
+        NodeSpec spec;
+        spec.type          = NodeType::kUnitDelay;
+        spec.initial_value = initial_value;
+        specs_.push_back(std::move(spec));
+        is_compiled_ = false;
+        return specs_.size() - 1;
+    }
+
+    /**
+     * @brief 连线：to 的输入加上 gain * from 的输出
+     *
+     */
+    void Connect(size_t from, size_t to, T gain = 1)
+    {
+        assert(from < specs_.size() && to < specs_.size());
+        assert(specs_[to].type != NodeType::kInput); // 外部输入不能作为连线的终点
+
+        edge_specs_.push_back({from, to, gain});
+        is_compiled_ = false;
+    }
+
+    /**
+     * @brief 把一个节点的输出作为外部输出
+     *
+     * @return 外部输出的编号
+     */
+    size_t AddOutput(size_t from)
+    {
+        assert(from < specs_.size());
+        output_specs_.push_back(from);
+        is_compiled_ = false;
+        return output_specs_.size() - 1;
+    }
+
+    /**
+     * @brief 计算执行顺序，创建所有模块并重置状态
+     *
+     * @return 是否成功，有代数环时返回 false，此时可以用 GetAlgebraicLoop() 查看环中的模块
+     */
+    bool Compile()
+    {
+        DestroyBlocks();
+
+        if (!Schedule()) return false;
+
+        // 信号的排列：外部输入、UnitDelay 的输出、模块的输出（按执行顺序）
+        const size_t count = specs_.size();
+        slot_of_node_.assign(count, 0);
+        input_slots_.clear();
+        uint32_t slot = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (specs_[i].type == NodeType::kInput) {
+                input_slots_.push_back(slot);
+                slot_of_node_[i] = slot++;
+            }
+        }
+        std::vector<size_t> delay_nodes;
+        for (size_t i = 0; i < count; i++) {
+            if (specs_[i].type == NodeType::kUnitDelay) {
+                delay_nodes.push_back(i);
+                slot_of_node_[i] = slot++;
+            }
+        }
+        for (auto node : block_order_) {
+            slot_of_node_[node] = slot++;
+        }
+        signal_count_ = slot;
+
+        output_slots_.clear();
+        for (auto node : output_specs_) {
+            output_slots_.push_back(slot_of_node_[node]);
+        }
+
+        // 连线按终点分组：先是各个模块（按执行顺序），然后是各个 UnitDelay
+        std::vector<std::vector<const EdgeSpec *>> incoming(count);
+        for (const auto &edge : edge_specs_) {
+            incoming[edge.to].push_back(&edge);
+        }
+
+        edge_source_.clear();
+        edge_gain_.clear();
+        auto append_edges = [&](size_t node, uint32_t &begin, uint32_t &end, uint32_t &source) {
+            begin = edge_source_.size();
+            for (auto edge : incoming[node]) {
+                edge_source_.push_back(slot_of_node_[edge->from]);
+                edge_gain_.push_back(edge->gain);
+            }
+            end    = edge_source_.size();
+            source = end - begin == 1 && edge_gain_[begin] == T(1) ? edge_source_[begin] : kNoSource;
+        };
+
+        // 信号和所有模块（按执行顺序）放在同一块内存中，没有 UnitDelay 时还有 StepBlock() 用的缓冲区
+        const bool has_delay     = !delay_nodes.empty();
+        const size_t block_count = has_delay ? 0 : (signal_count_ + 1) * kBlockSize;
+        size_t capacity          = Arena::MaxFootprint(signal_count_ * sizeof(T), alignof(T));
+        capacity += Arena::MaxFootprint(block_count * sizeof(T), alignof(T));
+        for (auto node : block_order_) {
+            capacity += Arena::MaxFootprint(specs_[node].size, specs_[node].alignment);
+        }
+        arena_.Reserve(capacity);
+
+        signals_ = static_cast<T *>(arena_.Allocate(signal_count_ * sizeof(T), alignof(T)));
+        for (size_t i = 0; i < signal_count_; i++) {
+            new (signals_ + i) T(0);
+        }
+        if (!has_delay) {
+            block_signals_ = static_cast<T *>(arena_.Allocate(block_count * sizeof(T), alignof(T)));
+            for (size_t i = 0; i < block_count; i++) {
+                new (block_signals_ + i) T(0);
+            }
+            block_sum_ = block_signals_ + signal_count_ * kBlockSize;
+            block_sources_.resize(signal_count_);
+            for (size_t i = 0; i < signal_count_; i++) {
+                block_sources_[i] = block_signals_ + i * kBlockSize;
+            }
+        }
+
+        nodes_.clear();
+        nodes_.reserve(block_order_.size());
+        for (auto node : block_order_) {
+            const auto &spec = specs_[node];
+            Node runtime;
+            runtime.block  = spec.construct(arena_.Allocate(spec.size, spec.alignment));
+            runtime.step       = spec.step;
+            runtime.step_block = spec.step_block;
+            runtime.output     = slot_of_node_[node];
+            append_edges(node, runtime.edge_begin, runtime.edge_end, runtime.source);
+            nodes_.push_back(runtime);
+        }
+
+        delays_.clear();
+        for (auto node : delay_nodes) {
+            Delay delay;
+            delay.output        = slot_of_node_[node];
+            delay.initial_value = specs_[node].initial_value;
+            delay.state         = delay.initial_value;
+            append_edges(node, delay.edge_begin, delay.edge_end, delay.source);
+            delays_.push_back(delay);
+        }
+
+        is_compiled_ = true;
+        ResetState();
+        return true;
+    }
+
+    /**
+     * @brief 走一个周期
+     *
+     * @param inputs 外部输入，按 AddInput() 的顺序排列
+     * @param outputs 外部输出，按 AddOutput() 的顺序排列
+     */
+    void Step(const T *inputs, T *outputs)
+    {
+        assert(is_compiled_);
+
+        for (size_t i = 0; i < input_slots_.size(); i++) {
+            signals_[input_slots_[i]] = inputs[i];
+        }
+        StepSignals();
+        for (size_t i = 0; i < output_slots_.size(); i++) {
+            outputs[i] = signals_[output_slots_[i]];
+        }
+    }
+
+    /**
+     * @brief 走 n 个周期，各个外部输入和输出是独立的通道，直接读写，结果与逐个 Step() 逐位相同
+     *
+     * @param inputs 第 i 个外部输入的 n 个值从 inputs[i] 开始
+     * @param outputs 第 i 个外部输出的 n 个值写到 outputs[i] 开始的位置
+     */
+    void StepBlock(const T *const *inputs, T *const *outputs, size_t n)
+    {
+        assert(is_compiled_);
+
+        // 有 UnitDelay 时模块的输入可能与本块中更早的输出有关，逐个采样运行
+        if (!delays_.empty()) {
+            for (size_t k = 0; k < n; k++) {
+                for (size_t i = 0; i < input_slots_.size(); i++) {
+                    signals_[input_slots_[i]] = inputs[i][k];
+                }
+                StepSignals();
+                for (size_t i = 0; i < output_slots_.size(); i++) {
+                    outputs[i][k] = signals_[output_slots_[i]];
+                }
+            }
+            return;
+        }
+
+        size_t count = 0;
+        for (size_t begin = 0; begin < n; begin += count) {
+            count = std::min(kBlockSize, n - begin);
+            for (size_t i = 0; i < input_slots_.size(); i++) {
+                block_sources_[input_slots_[i]] = inputs[i] + begin;
+            }
+
+            for (const auto &node : nodes_) {
+                const T *input = node.source != kNoSource ? block_sources_[node.source] : SumBlock(node.edge_begin, node.edge_end, count);
+                node.step_block(node.block, input, block_signals_ + node.output * kBlockSize, count);
+            }
+
+            for (size_t i = 0; i < output_slots_.size(); i++) {
+                const T *output = block_sources_[output_slots_[i]];
+                std::copy(output, output + count, outputs[i] + begin);
+            }
+        }
+
+        // GetSignal() 返回最后一个周期的值
+        if (n != 0) {
+            for (size_t i = 0; i < signal_count_; i++) {
+                signals_[i] = block_sources_[i][count - 1];
+            }
+        }
+    }
+
+    /**
+     * @brief 重置所有模块和 UnitDelay 的状态
+     *
+     */
+    void ResetState()
+    {
+        assert(is_compiled_);
+
+        for (size_t i = 0; i < nodes_.size(); i++) {
+            specs_[block_order_[i]].reset(nodes_[i].block);
+        }
+        for (auto &delay : delays_) {
+            delay.state = delay.initial_value;
+        }
+        std::fill(signals_, signals_ + signal_count_, T(0));
+    }
+
+    /**
+     * @brief 节点在最近一个周期的输出
+     *
+     */
+    T GetSignal(size_t node) const
+    {
+        assert(is_compiled_);
+        return signals_[slot_of_node_[node]];
+    }
+
+    /**
+     * @brief 上一次 Compile() 失败时，处于代数环中的模块
+     *
+     */
+    const std::vector<size_t> &GetAlgebraicLoop() const
+    {
+        return algebraic_loop_;
+    }
+
+    bool IsCompiled() const
+    {
+        return is_compiled_;
+    }
+
+    size_t NodeCount() const
+    {
+        return specs_.size();
+    }
+
+    /**
+     * @brief 外部输入的个数
+     *
+     */
+    size_t InputCount() const
+    {
+        return std::count_if(specs_.begin(), specs_.end(), [](const NodeSpec &spec) { return spec.type == NodeType::kInput; });
+    }
+
+    /**
+     * @brief 外部输出的个数
+     *
+     */
+    size_t OutputCount() const
+    {
+        return output_specs_.size();
+    }
+};
+
+} // namespace control_system
@@ -0,0 +1,302 @@
+/**
+ * @file closed_loop.hpp
+ * @author X. Y.
+ * @brief 闭环仿真：多个场景同步运行，并在同一遍中计算性能指标
+ * @version 0.1
+ * @date 2023-08-28
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 每个场景（scenario）是一个单位负反馈回路：
+ *
+ *   reference ──(+)── e ──> 控制器 ── u ──(+)──> 对象 ──┬── y
+ *               │(-)                       ↑ disturbance  │
+ *               └──── y 的测量值 <──(+)── noise ──────────┘
+ *
+ * - 所有场景同步推进，控制器和对象都是多通道的（PIDBank、PIDBank_AntiWindup、ZTfBank、SisoStateSpaceBank，
+ *   或其他有 Step(const T *input, T *output) 和 ResetState() 的类型），每个周期对所有场景做同样的运算，编译器可以生成 SIMD 指令
+ * - 各场景的控制器参数可以不同（如 PIDBank 的每个通道），参考输入、扰动、噪声也可以不同
+ * - 控制器看到的是上一个周期的对象输出（相当于框图中用 UnitDelay 断开环路），对象可以有直通项
+ * - 输入输出都是调用者预先分配好的数组，按时间排列，第 k 个周期第 s 个场景的数据在 [k * scenarios + s]
+ * - 指标在仿真的同一遍中累加，不需要再扫描一遍输出：
+ *   IAE = Σ|r - y| Ts，ISE = Σ(r - y)² Ts；
+ *   超调量和调节时间以参考输入的终值 r_final 为目标（适用于阶跃一类的参考输入）：
+ *   超调量 = 输出越过 r_final 的最大值 / |r_final|（r_final 为 0 时为 0），
+ *   调节时间 = 之后 |y - r_final| 一直不超过容差带的最早时刻，仿真结束时仍在带外则为无穷大
+ *
+ * 使用示例：
+ * pid::PIDBank<float> controllers(256);                      // 256 个场景，各用一组 PID 参数
+ * ZTfBank<float> plants(ZTf<float>({0, 0.01}, {1, -0.99}), 256);
+ * ClosedLoopSimulation<float> simulation(256, 0.001);
+ * ClosedLoopSignals<float> signals;
+ * signals.reference = reference; // steps * 256 个
+ * signals.output    = output;    // 可选，steps * 256 个
+ * simulation.Run(controllers, plants, signals, steps);
+ * simulation.GetMetrics().iae[0];
+ *
+ * 状态衰减到非规格化浮点数时运算会慢很多，离线仿真时可以在外面加一个 ScopedFlushDenormals
+ *
+ */
+
+#pragma once
+
+#include "compiler.hpp"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#endif
+
+namespace control_system
+{
+
+/**
+ * @brief 在作用域内把当前线程的非规格化浮点数（denormal）当作 0 处理，离开作用域时恢复
+ * @note 微分器等的状态衰减到非规格化数后，每次运算要慢几十倍；离线仿真大量场景时很容易遇到。
+ *       开启后结果与实际控制器可能在非规格化数的量级上有差别。只支持 x86（SSE）和 AArch64，其他平台什么也不做
+ */
+class ScopedFlushDenormals
+{
+private:
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    unsigned int saved_ = _mm_getcsr();
+
+public:
+    ScopedFlushDenormals()
+    {
+        _mm_setcsr(saved_ | 0x8040); // FTZ | DAZ
+    }
+
+    ~ScopedFlushDenormals()
+    {
+        _mm_setcsr(saved_);
+    }
+#elif defined(__aarch64__)
+    uint64_t saved_;
+
+public:
+    ScopedFlushDenormals()
+    {
+        asm volatile("mrs %0, fpcr" : "=r"(saved_));
+        asm volatile("msr fpcr, %0" : : "r"(saved_ | (uint64_t(1) << 24))); // FZ
+    }
+
+    ~ScopedFlushDenormals()
+    {
+        asm volatile("msr fpcr, %0" : : "r"(saved_));
+    }
+#else
+public:
+    ScopedFlushDenormals(){};
+#endif
+
+    ScopedFlushDenormals(const ScopedFlushDenormals &)            = delete;
+    ScopedFlushDenormals &operator=(const ScopedFlushDenormals &) = delete;
+};
+
+/**
+ * @brief 闭环仿真的输入输出，都按时间排列，长度为 steps * scenarios；除 reference 外都可以为 nullptr
+ *
+ */
+template <typename T>
+struct ClosedLoopSignals {
+    const T *reference   = nullptr; // 参考输入
+    const T *disturbance = nullptr; // 加在对象输入上的扰动
+    const T *noise       = nullptr; // 加在测量值上的噪声
+    T *output            = nullptr; // 对象输出（不含噪声）
+    T *control           = nullptr; // 控制器输出（不含扰动）
+
+    bool shared_reference = false; // 为 true 时所有场景共用一个参考输入，reference 的长度为 steps
+};
+
+/**
+ * @brief 各场景的性能指标
+ *
+ */
+template <typename T>
+struct ClosedLoopMetrics {
+    std::vector<T> iae;           // 误差绝对值的积分
+    std::vector<T> ise;           // 误差平方的积分
+    std::vector<T> overshoot;     // 相对超调量，0.1 即 10%
+    std::vector<T> settling_time; // 调节时间（秒），没有调节到容差带内为无穷大
+};
+
+/**
+ * @brief 多场景闭环仿真
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ */
+template <typename T>
+class ClosedLoopSimulation
+{
+private:
+    size_t scenarios_;
+    T Ts_;
+    T settling_tolerance_;
+
+    // 每个周期的中间结果，各场景连续存放
+    std::vector<T> reference_, measured_, error_, control_, plant_input_, output_;
+
+    // 指标的累加值和计算指标用的常量
+    std::vector<T> final_reference_, direction_, band_;
+    std::vector<T> iae_, ise_, peak_, settled_at_;
+
+    ClosedLoopMetrics<T> metrics_;
+
+    // 累加一个周期的指标
+    static void MetricsKernel(size_t n, T time, const T *CONTROL_SYSTEM_RESTRICT reference, const T *CONTROL_SYSTEM_RESTRICT output,
+                              const T *CONTROL_SYSTEM_RESTRICT final_reference, const T *CONTROL_SYSTEM_RESTRICT direction,
+                              const T *CONTROL_SYSTEM_RESTRICT band, T *CONTROL_SYSTEM_RESTRICT iae, T *CONTROL_SYSTEM_RESTRICT ise,
+                              T *CONTROL_SYSTEM_RESTRICT peak, T *CONTROL_SYSTEM_RESTRICT settled_at)
+    {
+        for (size_t s = 0; s < n; s++) {
+            const T y = output[s];
+            const T e = reference[s] - y;
+            iae[s] += e < 0 ? -e : e;
+            ise[s] += e * e;
+
+            const T deviation = y - final_reference[s];
+            const T over      = deviation * direction[s];
+            peak[s]           = over > peak[s] ? over : peak[s];
+
+            // 在带外时，最早的调节时刻推迟到下一个采样
+            const T magnitude = deviation < 0 ? -deviation : deviation;
+            settled_at[s]     = magnitude > band[s] ? time : settled_at[s];
+        }
+    }
+
+    /**
+     * @brief 本周期的数据：shared 时把一个值复制给所有场景，否则直接使用原数组
+     *
+     */
+    const T *Row(const T *signal, size_t k, bool shared, std::vector<T> &buffer) const
+    {
+        if (!shared) return signal + k * scenarios_;
+        std::fill(buffer.begin(), buffer.end(), signal[k]);
+        return buffer.data();
+    }
+
+public:
+    /**
+     * @brief 创建闭环仿真
+     *
+     * @param scenarios 场景数，与控制器和对象的通道数相同
+     * @param Ts 采样周期（秒）
+     * @param settling_tolerance 调节时间的容差带，相对于 |r_final|（r_final 为 0 时相对于 1）
+     */
+    ClosedLoopSimulation(size_t scenarios, T Ts, T settling_tolerance = 0.02)
+        : scenarios_{scenarios}, Ts_{Ts}, settling_tolerance_{settling_tolerance},
+          reference_(scenarios), measured_(scenarios), error_(scenarios), control_(scenarios), plant_input_(scenarios),
+          output_(scenarios), final_reference_(scenarios), direction_(scenarios), band_(scenarios),
+          iae_(scenarios), ise_(scenarios), peak_(scenarios), settled_at_(scenarios)
+    {
+        metrics_.iae.resize(scenarios);
+        metrics_.ise.resize(scenarios);
+        metrics_.overshoot.resize(scenarios);
+        metrics_.settling_time.resize(scenarios);
+    }
+
+    /**
+     * @brief 从零状态开始仿真 steps 个周期（会调用控制器和对象的 ResetState()）
+     *
+     * @param controller 多通道控制器，输入为误差，输出为控制量
+     * @param plant 多通道对象
+     */
+    template <typename Controller, typename Plant>
+    void Run(Controller &controller, Plant &plant, const ClosedLoopSignals<T> &signals, size_t steps)
+    {
+        assert(signals.reference != nullptr);
+
+        controller.ResetState();
+        plant.ResetState();
+        std::fill(output_.begin(), output_.end(), 0);
+        std::fill(iae_.begin(), iae_.end(), 0);
+        std::fill(ise_.begin(), ise_.end(), 0);
+        std::fill(peak_.begin(), peak_.end(), 0);
+        std::fill(settled_at_.begin(), settled_at_.end(), 0);
+
+        // 以参考输入的终值为目标，初始输出为 0
+        if (steps > 0) {
+            const T *last = Row(signals.reference, steps - 1, signals.shared_reference, reference_);
+            for (size_t s = 0; s < scenarios_; s++) {
+                const T r           = last[s];
+                final_reference_[s] = r;
+                direction_[s]       = r > 0 ? 1 : (r < 0 ? -1 : 0);
+                band_[s]            = settling_tolerance_ * (r == 0 ? 1 : (r < 0 ? -r : r));
+            }
+        }
+
+        for (size_t k = 0; k < steps; k++) {
+            const T *reference = Row(signals.reference, k, signals.shared_reference, reference_);
+
+            // 测量值为上一个周期的输出加噪声
+            const T *measured = output_.data();
+            if (signals.noise != nullptr) {
+                const T *noise = signals.noise + k * scenarios_;
+                for (size_t s = 0; s < scenarios_; s++) {
+                    measured_[s] = output_[s] + noise[s];
+                }
+                measured = measured_.data();
+            }
+
+            for (size_t s = 0; s < scenarios_; s++) {
+                error_[s] = reference[s] - measured[s];
+            }
+
+            T *control = signals.control != nullptr ? signals.control + k * scenarios_ : control_.data();
+            controller.Step(error_.data(), control);
+
+            const T *plant_input = control;
+            if (signals.disturbance != nullptr) {
+                const T *disturbance = signals.disturbance + k * scenarios_;
+                for (size_t s = 0; s < scenarios_; s++) {
+                    plant_input_[s] = control[s] + disturbance[s];
+                }
+                plant_input = plant_input_.data();
+            }
+
+            plant.Step(plant_input, output_.data());
+            if (signals.output != nullptr) {
+                std::copy(output_.begin(), output_.end(), signals.output + k * scenarios_);
+            }
+
+            MetricsKernel(scenarios_, (k + 1) * Ts_, reference, output_.data(), final_reference_.data(), direction_.data(),
+                          band_.data(), iae_.data(), ise_.data(), peak_.data(), settled_at_.data());
+        }
+
+        const T end_time = steps * Ts_;
+        for (size_t s = 0; s < scenarios_; s++) {
+            const T r                 = final_reference_[s];
+            metrics_.iae[s]           = iae_[s] * Ts_;
+            metrics_.ise[s]           = ise_[s] * Ts_;
+            metrics_.overshoot[s]     = r == 0 ? 0 : peak_[s] / (r < 0 ? -r : r);
+            metrics_.settling_time[s] = settled_at_[s] >= end_time ? std::numeric_limits<T>::infinity() : settled_at_[s];
+        }
+    }
+
+    /**
+     * @brief 最近一次 Run() 的指标
+     *
+     */
+    const ClosedLoopMetrics<T> &GetMetrics() const
+    {
+        return metrics_;
+    }
+
+    size_t Scenarios() const
+    {
+        return scenarios_;
+    }
+
+    T GetTs() const
+    {
+        return Ts_;
+    }
+};
+
+} // namespace control_system
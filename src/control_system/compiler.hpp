@@ -0,0 +1,20 @@
+/**
+ * @file compiler.hpp
+ * @author X. Y.
+ * @brief 编译器相关的宏
+ * @version 0.1
+ * @date 2023-07-25
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+// 告诉编译器指针所指的内存不与其他指针重叠，多通道的循环才能被向量化
+// GCC、Clang 和 MSVC 都支持 __restrict，其他编译器下为空
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define CONTROL_SYSTEM_RESTRICT __restrict
+#else
+#define CONTROL_SYSTEM_RESTRICT
+#endif
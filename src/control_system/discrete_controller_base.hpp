@@ -2,18 +2,54 @@
  * @file discrete_controller_base.hpp
  * @author X. Y.  
  * @brief 离散控制器基类
- * @version 0.2
+ * @version 0.3
  * @date 2023-07-05
  * 
  * @copyright Copyright (c) 2023
  * 
+ * 控制器有两套接口：
+ * - 静态多态（CRTP）：各控制器的实现都放在 static_dispatch 命名空间中，继承 StaticControllerBase，
+ *   Step() 等函数不是虚函数，组合控制器（例如 PID 中的积分器和微分器）以及模板代码中的调用都可以完全内联
+ * - 动态多态：DynamicController 把任意一个静态控制器包装成 DiscreteControllerBase 的派生类，
+ *   原来的 control_system::ZTf、pid::PID 等名字都是以 DynamicController 为基类的类模板，用法与以前相同，
+ *   其中组合控制器的成员（例如 pid::PID 的 i_controller、d_controller）也是虚函数接口的类型，这些类型也可以再派生
+ * 
  */
 
 #pragma once
 
+#include <cstddef>
+#include <type_traits>
+#include <typeinfo>
+
 namespace control_system
 {
 
+/**
+ * @brief 数值类型的特性：控制器中的参数、系数和信号可以用不同的类型
+ * - ParamType：用户给出的参数（Kp、Ki、Ts、传递函数的分子分母等），由参数计算系数时也用这个类型
+ * - CoefficientType：由参数算出的、在 Step() 中与信号相乘的系数
+ * - StateType：积分器、微分器中逐步累加的状态，可以比信号更宽，输出时再转换为 T
+ * 浮点类型三者都是 T 本身；定点类型的特化见 fixed_point.hpp（参数为 double，系数各自选择缩放，Q15 的状态为 Q31）
+ *
+ * @tparam T 信号的数据类型
+ */
+template <typename T>
+struct NumericTraits {
+    using ParamType       = T;
+    using CoefficientType = T;
+    using StateType       = T;
+};
+
+template <typename T>
+using ParamType = typename NumericTraits<T>::ParamType;
+
+template <typename T>
+using CoefficientType = typename NumericTraits<T>::CoefficientType;
+
+template <typename T>
+using StateType = typename NumericTraits<T>::StateType;
+
 /**
  * @brief 离散控制器基类
  *
@@ -23,6 +59,8 @@ template <typename T>
 class DiscreteControllerBase
 {
 public:
+    using ValueType = T;
+
     /**
      * @brief 走一个周期
      *
@@ -36,6 +74,155 @@ public:
      *
      */
     virtual void ResetState() = 0;
+
+    /**
+     * @brief 连续走 n 个周期，结果与依次调用 n 次 Step() 逐位相同
+     * @note 派生类可以重写此函数，在整个数据块内把状态保存在局部变量中，省去每个周期一次的虚函数调用
+     *
+     * @param input 输入数组，长度为 n
+     * @param output 输出数组，长度为 n，可以与 input 是同一个数组
+     * @param n 周期数
+     */
+    virtual void StepBlock(const T *input, T *output, size_t n)
+    {
+        for (size_t i = 0; i < n; i++) {
+            output[i] = Step(input[i]);
+        }
+    }
+
+    virtual ~DiscreteControllerBase() = default;
+};
+
+/**
+ * @brief 静态多态（CRTP）的离散控制器基类
+ * @note 派生类需要实现 T Step(T input) 和 void ResetState()，都不是虚函数
+ *
+ * @tparam Derived 派生类
+ * @tparam T 数据类型，例如 float 或 double
+ */
+template <typename Derived, typename T>
+class StaticControllerBase
+{
+public:
+    using ValueType = T;
+
+    /**
+     * @brief 连续走 n 个周期，结果与依次调用 n 次 Step() 逐位相同
+     * @note 默认实现直接调用派生类的 Step()，可以内联；派生类也可以自己实现
+     *
+     * @param input 输入数组，长度为 n
+     * @param output 输出数组，长度为 n，可以与 input 是同一个数组
+     * @param n 周期数
+     */
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        auto &derived = static_cast<Derived &>(*this);
+        for (size_t i = 0; i < n; i++) {
+            output[i] = derived.Step(input[i]);
+        }
+    }
+
+protected:
+    // 组合控制器在 StepBlock() 中分段处理时，每段的长度（用于栈上的临时数组）
+    static constexpr size_t kBlockBufferSize = 64;
+};
+
+namespace detail
+{
+
+// 声明 Step(T) 和 StepBlock() 的类（可能是 Controller 的基类），只用于 decltype
+template <typename T, typename C>
+C StepOwner(T (C::*)(T));
+
+template <typename T, typename C>
+C StepBlockOwner(void (C::*)(const T *, T *, size_t));
+
+/**
+ * @brief 自己实现了 Step(T) 的控制器，StepBlock() 也必须是自己的（或自己的 CRTP 基类的默认实现）
+ * @note 从另一个静态控制器派生时（例如 DiscreteIntegratorSaturation 派生自 DiscreteIntegrator），CRTP 基类是基类的，
+ *       不重写 StepBlock() 就会继承基类的版本，调用的是基类的 Step()
+ */
+template <typename Controller, typename T = typename Controller::ValueType>
+struct StepBlockMatchesStep {
+    using StepClass      = decltype(StepOwner<T>(&Controller::Step));
+    using StepBlockClass = decltype(StepBlockOwner<T>(&Controller::StepBlock));
+
+    static constexpr bool value = !std::is_same<StepClass, Controller>::value || std::is_same<StepBlockClass, Controller>::value ||
+                                  std::is_same<StepBlockClass, StaticControllerBase<Controller, T>>::value;
+};
+
+} // namespace detail
+
+/**
+ * @brief 把静态多态的控制器包装成 DiscreteControllerBase，用于需要在运行时选择控制器的地方
+ * @note 可以再派生（例如 struct MyTf : ZTf<float>，重写 Step() 等虚函数）；通过具体类型的对象调用时编译器仍然可以去掉虚函数调用。
+ *       派生类的 StepBlock() 按基类的默认实现逐个调用虚函数 Step()，因此重写的 Step() 在 StepBlock() 中同样生效，
+ *       需要更快时派生类可以自己重写 StepBlock()
+ *
+ * 使用示例：
+ * control_system::DynamicController<control_system::static_dispatch::ZTf<float>> ztf({1}, {1, -0.5});
+ * control_system::DiscreteControllerBase<float> &controller = ztf;
+ *
+ * @tparam Controller 静态多态的控制器类型
+ * @tparam Self 以此为基类的公开类型（例如 control_system::ZTf<T>），直接使用 DynamicController 时为 void
+ */
+template <typename Controller, typename Self = void>
+class DynamicController : public Controller, public DiscreteControllerBase<typename Controller::ValueType>
+{
+public:
+    using ValueType = typename Controller::ValueType;
+
+    // 没有再派生时对象的类型，动态类型与之不同说明 Step() 等虚函数可能被重写了
+    using ExactType = std::conditional_t<std::is_void<Self>::value, DynamicController, Self>;
+
+private:
+    using T = ValueType;
+
+    static_assert(detail::StepBlockMatchesStep<Controller>::value,
+                  "Controller 重写了 Step(T)，但 StepBlock() 是从基类继承的，会调用基类的 Step()，需要自己实现 StepBlock()");
+
+public:
+    using Controller::Controller;
+    using Controller::Step;
+
+    DynamicController() = default;
+
+    DynamicController(const Controller &controller)
+        : Controller{controller} {};
+
+    T Step(T input) override
+    {
+        return Controller::Step(input);
+    }
+
+    void StepBlock(const T *input, T *output, size_t n) override
+    {
+        // Controller::StepBlock() 调用的是 Controller::Step()，派生类重写的 Step() 不会被调用
+        if (typeid(*this) != typeid(ExactType)) {
+            DiscreteControllerBase<T>::StepBlock(input, output, n);
+            return;
+        }
+        Controller::StepBlock(input, output, n);
+    }
+
+    void ResetState() override
+    {
+        Controller::ResetState();
+    }
+
+    /**
+     * @brief 被包装的静态多态控制器
+     *
+     */
+    Controller &GetController()
+    {
+        return *this;
+    }
+
+    const Controller &GetController() const
+    {
+        return *this;
+    }
 };
 
 } // namespace control_system
@@ -2,7 +2,7 @@
  * @file discrete_integrator.hpp
  * @author X. Y.
  * @brief 离散时间积分器
- * @version 0.2
+ * @version 0.3
  * @date 2023-07-06
  *
  * @copyright Copyright (c) 2023
@@ -13,29 +13,49 @@
  * control_system::DiscreteIntegrator<float> integrator{2, 0.01}; // 定义一个积分增益为 2 采样周期为 0.01s 的积分器
  * control_system::DiscreteIntegratorSaturation<float> i_controller{{2, 0.01}, {-10, 10}}; // 定义一个带有积分限幅的积分器
  *
+ * 参数也可以整组替换：在其他线程中用 MakeCoefficients() 算好，在控制线程中用 SetCoefficients() 一次性替换，见 triple_buffer.hpp
+ *
+ * 采样周期有抖动时使用 variable_ts.hpp 中的 VariableTsIntegrator，每次传入实测的周期
+ *
+ * T 可以是定点数（fixed_point.hpp），此时 Ki、Ts 为 double，输入系数为 FixedCoefficient，
+ * 内部状态为 StateType<T>（Q15 的状态为 Q31），每步的增量小于信号的分辨率时也能累积，输出时再舍入为 T
+ *
  */
 
 #pragma once
 #include "discrete_controller_base.hpp"
+#include "instrumentation.hpp"
 #include "saturation.hpp"
 
 namespace control_system
 {
 
+namespace static_dispatch
+{
+
 template <typename T>
-class DiscreteIntegrator : public DiscreteControllerBase<T>
+class DiscreteIntegrator : public StaticControllerBase<DiscreteIntegrator<T>, T>
 {
 protected:
-    T Ki, Ts;
-    T input_coefficient_; // 系数，见 UpdateCoefficient()
-    T x_;                 // 内部状态变量
+    ParamType<T> Ki, Ts;
+    CoefficientType<T> input_coefficient_; // 系数，见 UpdateCoefficient()
+    StateType<T> x_;                       // 内部状态变量，等于 y[k] + input_coefficient_ * u[k]
 
     void UpdateCoefficient()
     {
-        input_coefficient_ = Ki * Ts / 2;
+        input_coefficient_ = MakeCoefficients(Ki, Ts).input_coefficient;
     }
 
 public:
+    /**
+     * @brief 一组完整的参数，包括由参数算出的系数
+     *
+     */
+    struct Coefficients {
+        ParamType<T> Ki, Ts;
+        CoefficientType<T> input_coefficient;
+    };
+
     /**
      * @brief 积分器
      *
@@ -43,7 +63,7 @@ public:
      * @param Ts 采样周期
      *
      */
-    DiscreteIntegrator(T Ki, T Ts)
+    DiscreteIntegrator(ParamType<T> Ki, ParamType<T> Ts)
     {
         ResetState();
         SetParam(Ki, Ts);
@@ -55,44 +75,104 @@ public:
      * @param input 输入
      * @return T 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
-        auto temp = input_coefficient_ * input;
+        CONTROL_SYSTEM_PROBE_TIME("DiscreteIntegrator::Step");
+        auto temp = input_coefficient_ * StateType<T>(input);
         auto y_   = x_ + temp; // y_ 是输出
 
         x_ = y_ + temp;
 
-        return y_;
+        return T(y_);
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        auto c = input_coefficient_;
+        auto x = x_;
+
+        for (size_t i = 0; i < n; i++) {
+            auto temp = c * StateType<T>(input[i]);
+            auto y    = x + temp;
+
+            x         = y + temp;
+            output[i] = T(y);
+        }
+
+        x_ = x;
     }
 
-    T GetStateOutput() const
+    StateType<T> GetStateOutput() const
     {
         return x_;
     }
 
-    void SetParam(T Ki, T Ts)
+    /**
+     * @brief 直接设置内部状态变量
+     *
+     */
+    void SetStateOutput(StateType<T> state)
+    {
+        x_ = state;
+    }
+
+    /**
+     * @brief 输入系数 Ki * Ts / 2
+     *
+     */
+    CoefficientType<T> GetInputCoefficient() const
+    {
+        return input_coefficient_;
+    }
+
+    void SetParam(ParamType<T> Ki, ParamType<T> Ts)
     {
         this->Ki = Ki;
         this->Ts = Ts;
         UpdateCoefficient();
     }
 
-    void SetParam(T Ki)
+    void SetParam(ParamType<T> Ki)
     {
         this->Ki = Ki;
         UpdateCoefficient();
     }
 
-    T GetKi() const
+    ParamType<T> GetKi() const
     {
         return Ki;
     }
 
-    T GetTs() const
+    ParamType<T> GetTs() const
     {
         return Ts;
     }
 
+    /**
+     * @brief 由参数算出一组系数，可以在其他线程中调用
+     *
+     */
+    static Coefficients MakeCoefficients(ParamType<T> Ki, ParamType<T> Ts)
+    {
+        return {Ki, Ts, CoefficientType<T>(Ki * Ts / 2)};
+    }
+
+    /**
+     * @brief 一次性替换所有系数，不做任何计算，内部状态保留
+     *
+     */
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        Ki                 = coefficients.Ki;
+        Ts                 = coefficients.Ts;
+        input_coefficient_ = coefficients.input_coefficient;
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {Ki, Ts, input_coefficient_};
+    }
+
     /**
      * @brief 重置控制器状态
      *
@@ -110,6 +190,8 @@ protected:
     using DiscreteIntegrator<T>::x_;
     using DiscreteIntegrator<T>::input_coefficient_;
 
+    CONTROL_SYSTEM_PROBE_STREAK_MEMBER(saturated_); // 开启插桩时记录连续饱和的步数
+
 public:
     using DiscreteIntegrator<T>::DiscreteIntegrator;
     Saturation<T, T> saturation; // 限幅器，可以对这个类操作，调整限幅幅值
@@ -118,21 +200,100 @@ public:
                                  const Saturation<T, T> &saturation)
         : DiscreteIntegrator<T>{discrete_integrator}, saturation{saturation} {};
 
+    /**
+     * @brief 一组完整的参数，包括限幅值
+     *
+     */
+    struct Coefficients {
+        typename DiscreteIntegrator<T>::Coefficients integrator;
+        Saturation<T, T> saturation;
+    };
+
+    /**
+     * @brief 由参数算出一组系数，可以在其他线程中调用
+     * @note 限幅值没有默认值：SetCoefficients() 会整组替换限幅，省略限幅会在控制线程中悄悄去掉积分限幅。
+     *       不改变限幅时传入当前的 saturation
+     */
+    static Coefficients MakeCoefficients(ParamType<T> Ki, ParamType<T> Ts, const Saturation<T, T> &saturation)
+    {
+        return {DiscreteIntegrator<T>::MakeCoefficients(Ki, Ts), saturation};
+    }
+
+    /**
+     * @brief 一次性替换所有系数和限幅值，内部状态保留
+     *
+     */
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        DiscreteIntegrator<T>::SetCoefficients(coefficients.integrator);
+        saturation = coefficients.saturation;
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {DiscreteIntegrator<T>::GetCoefficients(), saturation};
+    }
+
     /**
      * @brief 走一个采样周期
      *
      * @param input 输入
      * @return T 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
-        auto temp = input_coefficient_ * input;
-        auto y_   = saturation(x_ + temp); // y_ 是输出
+        CONTROL_SYSTEM_PROBE_TIME("DiscreteIntegratorSaturation::Step");
+        auto temp = input_coefficient_ * StateType<T>(input);
+        auto y_   = saturation(x_ + temp); // y_ 是输出，限幅值按状态的类型比较
 
+        CONTROL_SYSTEM_PROBE_STREAK("DiscreteIntegratorSaturation saturated", saturated_, y_ != x_ + temp);
         x_ = y_ + temp;
 
-        return y_;
+        return T(y_);
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        auto c   = input_coefficient_;
+        auto x   = x_;
+        auto sat = saturation;
+
+        for (size_t i = 0; i < n; i++) {
+            auto temp = c * StateType<T>(input[i]);
+            auto y    = sat(x + temp);
+
+            CONTROL_SYSTEM_PROBE_STREAK("DiscreteIntegratorSaturation saturated", saturated_, y != x + temp);
+
+            x         = y + temp;
+            output[i] = T(y);
+        }
+
+        x_ = x;
     }
 };
 
+} // namespace static_dispatch
+
+/**
+ * @brief 离散时间积分器（虚函数接口）
+ *
+ */
+template <typename T>
+class DiscreteIntegrator : public DynamicController<static_dispatch::DiscreteIntegrator<T>, DiscreteIntegrator<T>>
+{
+public:
+    using DynamicController<static_dispatch::DiscreteIntegrator<T>, DiscreteIntegrator<T>>::DynamicController;
+};
+
+/**
+ * @brief 带限幅的离散时间积分器（虚函数接口）
+ *
+ */
+template <typename T>
+class DiscreteIntegratorSaturation : public DynamicController<static_dispatch::DiscreteIntegratorSaturation<T>, DiscreteIntegratorSaturation<T>>
+{
+public:
+    using DynamicController<static_dispatch::DiscreteIntegratorSaturation<T>, DiscreteIntegratorSaturation<T>>::DynamicController;
+};
+
 } // namespace control_system
@@ -0,0 +1,417 @@
+/**
+ * @file fixed_point.hpp
+ * @author X. Y.
+ * @brief 定点数（Q15、Q31 等）
+ * @version 0.1
+ * @date 2023-09-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 没有 FPU 的 MCU（例如 Cortex-M0）和定点 DSP 上用整数运算代替浮点运算，结果与平台无关（确定性）：
+ * - Fixed<Storage, FracBits>：Storage 为 int16_t 或 int32_t，小数部分 FracBits 位，例如 Q15 = Fixed<int16_t, 15>，
+ *   Q31 = Fixed<int32_t, 31>，Fixed<int32_t, 16> 的范围为 [-32768, 32768)
+ * - 加、减、乘、除和取负都是饱和运算，溢出时取最大值或最小值，不会回绕；乘法四舍五入，除法向零舍入，除以 0 时饱和
+ * - 由浮点数或整数构造时四舍五入并饱和，转换为浮点数要显式转换（static_cast<double>(x)）
+ * - std::numeric_limits 已特化，Saturation 的默认限幅就是定点数的最小值和最大值
+ *
+ * 控制器的信号（输入、输出、限幅值）用定点数，积分器和微分器的状态用不低于信号精度的定点数（Q15 的状态为 Q31）；参数（Kp、Ki、Ts、传递函数的分子分母等）用 double 给出，
+ * 由参数算出系数时也用 double 计算（见 discrete_controller_base.hpp 中的 NumericTraits），最后每个系数各自转换为
+ * FixedCoefficient：32 位尾数加一个移位数，移位数在计算系数时按系数的大小选择，使尾数用满 31 位，
+ * 因此 Kp = 50、Ki * Ts / 2 = 0.0005 这样范围相差很大的系数都能以相同的相对精度表示，与信号相乘时用 64 位整数
+ *
+ * 支持的控制器：pid 中的各控制器（P、D、PID、PI、PD、PID_AntiWindup、PI_AntiWindup）、DiscreteIntegrator、
+ * DiscreteIntegratorSaturation、ZTf、StaticZTf、Saturation。其余模块（多通道、状态空间、SOS 等）按浮点数设计
+ *
+ * 使用示例：
+ * using control_system::Q31;
+ * control_system::pid::PID_AntiWindup<Q31> pid_controller{0.5, 0.5, 0.001, 100, 0.001, 1, -0.9, 0.9}; // 参数为 double
+ * Q31 output = pid_controller.Step(Q31(0.25));
+ * double value = static_cast<double>(output);
+ *
+ */
+
+#pragma once
+
+#include "discrete_controller_base.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace control_system
+{
+
+namespace detail
+{
+
+// 乘法和饱和运算时用的较宽的整数类型
+template <typename Storage>
+struct FixedWide;
+
+template <>
+struct FixedWide<int16_t> {
+    using type = int32_t;
+};
+
+template <>
+struct FixedWide<int32_t> {
+    using type = int64_t;
+};
+
+// 把较宽的整数饱和到 Storage 的范围内
+template <typename Storage, typename Wide>
+constexpr Storage SaturateTo(Wide value)
+{
+    return value > Wide(std::numeric_limits<Storage>::max())   ? std::numeric_limits<Storage>::max()
+           : value < Wide(std::numeric_limits<Storage>::min()) ? std::numeric_limits<Storage>::min()
+                                                               : Storage(value);
+}
+
+// 算术右移 shift 位，四舍五入（正好一半时向正无穷舍入）
+template <typename Wide>
+constexpr Wide RoundingShiftRight(Wide value, int shift)
+{
+    return shift <= 0 ? value : (value + (Wide(1) << (shift - 1))) >> shift;
+}
+
+} // namespace detail
+
+/**
+ * @brief 定点数
+ *
+ * @tparam Storage 存储类型，int16_t 或 int32_t
+ * @tparam FracBits 小数部分的位数
+ */
+template <typename Storage, int FracBits>
+class Fixed
+{
+    static_assert(std::is_same<Storage, int16_t>::value || std::is_same<Storage, int32_t>::value,
+                  "Storage must be int16_t or int32_t");
+    static_assert(FracBits >= 0 && FracBits < int(sizeof(Storage) * 8), "FracBits out of range");
+
+public:
+    using StorageType = Storage;
+    using WideType    = typename detail::FixedWide<Storage>::type;
+
+    static constexpr int kFracBits = FracBits;
+
+private:
+    Storage raw_ = 0;
+
+    static constexpr Storage kMax = std::numeric_limits<Storage>::max();
+    static constexpr Storage kMin = std::numeric_limits<Storage>::min();
+
+    static constexpr Storage FromDouble(double value)
+    {
+        const double scaled = value * double(WideType(1) << FracBits);
+        if (!(scaled == scaled)) return 0; // NaN
+        if (scaled >= double(kMax)) return kMax;
+        if (scaled <= double(kMin)) return kMin;
+        return Storage(WideType(scaled < 0 ? scaled - 0.5 : scaled + 0.5));
+    }
+
+public:
+    constexpr Fixed() = default;
+
+    /**
+     * @brief 由浮点数或整数构造，四舍五入并饱和
+     *
+     */
+    template <typename A, typename = std::enable_if_t<std::is_arithmetic<A>::value>>
+    constexpr Fixed(A value)
+        : raw_{FromDouble(double(value))}
+    {
+    }
+
+    /**
+     * @brief 由另一种定点数构造：不丢失精度和范围时（例如 Q15 -> Q31）可以隐式转换
+     *
+     */
+    template <typename S2, int F2,
+              typename = std::enable_if_t<(F2 <= FracBits && int(sizeof(S2) * 8) - F2 <= int(sizeof(Storage) * 8) - FracBits)>>
+    constexpr Fixed(Fixed<S2, F2> other)
+        : raw_{Storage(Storage(other.Raw()) * (Storage(1) << (FracBits - F2)))}
+    {
+    }
+
+    /**
+     * @brief 由另一种定点数构造，四舍五入并饱和（例如 Q31 -> Q15）
+     *
+     */
+    template <typename S2, int F2,
+              typename = std::enable_if_t<!(F2 <= FracBits && int(sizeof(S2) * 8) - F2 <= int(sizeof(Storage) * 8) - FracBits)>,
+              typename = void>
+    explicit constexpr Fixed(Fixed<S2, F2> other)
+        : raw_{detail::SaturateTo<Storage>(F2 >= FracBits ? detail::RoundingShiftRight(int64_t(other.Raw()), F2 - FracBits)
+                                                          : int64_t(other.Raw()) * (int64_t(1) << (FracBits - F2)))}
+    {
+    }
+
+    /**
+     * @brief 由内部的整数表示构造
+     *
+     */
+    static constexpr Fixed FromRaw(Storage raw)
+    {
+        Fixed result;
+        result.raw_ = raw;
+        return result;
+    }
+
+    /**
+     * @brief 内部的整数表示，数值为 Raw() / 2^FracBits
+     *
+     */
+    constexpr Storage Raw() const
+    {
+        return raw_;
+    }
+
+    explicit constexpr operator double() const
+    {
+        return double(raw_) / double(WideType(1) << FracBits);
+    }
+
+    explicit constexpr operator float() const
+    {
+        return float(double(*this));
+    }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b)
+    {
+        return FromRaw(detail::SaturateTo<Storage>(WideType(a.raw_) + WideType(b.raw_)));
+    }
+
+    friend constexpr Fixed operator-(Fixed a, Fixed b)
+    {
+        return FromRaw(detail::SaturateTo<Storage>(WideType(a.raw_) - WideType(b.raw_)));
+    }
+
+    friend constexpr Fixed operator*(Fixed a, Fixed b)
+    {
+        return FromRaw(detail::SaturateTo<Storage>(detail::RoundingShiftRight(WideType(a.raw_) * WideType(b.raw_), FracBits)));
+    }
+
+    friend constexpr Fixed operator/(Fixed a, Fixed b)
+    {
+        if (b.raw_ == 0) return FromRaw(a.raw_ >= 0 ? kMax : kMin);
+        return FromRaw(detail::SaturateTo<Storage>(WideType(a.raw_) * (WideType(1) << FracBits) / WideType(b.raw_)));
+    }
+
+    friend constexpr Fixed operator-(Fixed a)
+    {
+        return FromRaw(detail::SaturateTo<Storage>(-WideType(a.raw_)));
+    }
+
+    friend constexpr Fixed operator+(Fixed a)
+    {
+        return a;
+    }
+
+    constexpr Fixed &operator+=(Fixed other)
+    {
+        return *this = *this + other;
+    }
+
+    constexpr Fixed &operator-=(Fixed other)
+    {
+        return *this = *this - other;
+    }
+
+    constexpr Fixed &operator*=(Fixed other)
+    {
+        return *this = *this * other;
+    }
+
+    constexpr Fixed &operator/=(Fixed other)
+    {
+        return *this = *this / other;
+    }
+
+    friend constexpr bool operator==(Fixed a, Fixed b)
+    {
+        return a.raw_ == b.raw_;
+    }
+
+    friend constexpr bool operator!=(Fixed a, Fixed b)
+    {
+        return a.raw_ != b.raw_;
+    }
+
+    friend constexpr bool operator<(Fixed a, Fixed b)
+    {
+        return a.raw_ < b.raw_;
+    }
+
+    friend constexpr bool operator<=(Fixed a, Fixed b)
+    {
+        return a.raw_ <= b.raw_;
+    }
+
+    friend constexpr bool operator>(Fixed a, Fixed b)
+    {
+        return a.raw_ > b.raw_;
+    }
+
+    friend constexpr bool operator>=(Fixed a, Fixed b)
+    {
+        return a.raw_ >= b.raw_;
+    }
+};
+
+using Q15 = Fixed<int16_t, 15>; // [-1, 1)，分辨率 2^-15
+using Q31 = Fixed<int32_t, 31>; // [-1, 1)，分辨率 2^-31
+
+namespace detail
+{
+
+template <typename X>
+struct IsFixed : std::false_type {
+};
+
+template <typename Storage, int FracBits>
+struct IsFixed<Fixed<Storage, FracBits>> : std::true_type {
+};
+
+} // namespace detail
+
+/**
+ * @brief 定点控制器中的系数：value = mantissa * 2^-shift
+ * @note 移位数在构造时按系数的大小选择，使尾数的绝对值在 [2^30, 2^31) 内；与信号相乘时用 64 位整数，结果四舍五入并饱和
+ *
+ * @tparam FixedType 信号的定点类型
+ */
+template <typename FixedType>
+class FixedCoefficient
+{
+private:
+    // 尾数最多 31 位，信号最多 31 位，乘积不超过 2^62
+    static constexpr int kMaxShift = 62;
+
+    int32_t mantissa_ = 0;
+    int shift_        = 0;
+
+public:
+    constexpr FixedCoefficient() = default;
+
+    /**
+     * @brief 由 double 构造，选择移位数。可以隐式转换，所以 pid_controller.Kp = 2.5 这样的写法不变
+     * @note 绝对值不小于 2^31 的系数饱和
+     */
+    FixedCoefficient(double value)
+    {
+        if (value == 0 || !(value == value)) return;
+
+        int exponent;
+        std::frexp(value, &exponent); // |value| = f * 2^exponent，f 在 [0.5, 1) 内
+
+        int shift = 31 - exponent;
+        shift     = shift < 0 ? 0 : (shift > kMaxShift ? kMaxShift : shift);
+
+        double mantissa = std::round(std::ldexp(value, shift));
+        if (std::abs(mantissa) >= 2147483648.0 && shift > 0) {
+            // 四舍五入后进位到 2^31
+            shift--;
+            mantissa = std::round(std::ldexp(value, shift));
+        }
+
+        mantissa_ = mantissa >= 2147483647.0 ? INT32_MAX : (mantissa <= -2147483647.0 ? -INT32_MAX : int32_t(mantissa));
+        shift_    = shift;
+    }
+
+    operator double() const
+    {
+        return std::ldexp(double(mantissa_), -shift_);
+    }
+
+    int32_t GetMantissa() const
+    {
+        return mantissa_;
+    }
+
+    int GetShift() const
+    {
+        return shift_;
+    }
+
+    // 只接受定点数（信号或较宽的状态，见 NumericTraits::StateType），避免与 double 之间的隐式转换产生歧义
+    template <typename X, typename = std::enable_if_t<detail::IsFixed<X>::value>>
+    friend X operator*(const FixedCoefficient &c, X x)
+    {
+        const int64_t product = int64_t(c.mantissa_) * int64_t(x.Raw());
+        return X::FromRaw(detail::SaturateTo<typename X::StorageType>(detail::RoundingShiftRight(product, c.shift_)));
+    }
+
+    template <typename X, typename = std::enable_if_t<detail::IsFixed<X>::value>>
+    friend X operator*(X x, const FixedCoefficient &c)
+    {
+        return c * x;
+    }
+};
+
+/**
+ * @brief 定点类型的参数为 double，系数为各自缩放的 FixedCoefficient
+ * @note 16 位的信号用 32 位的状态（Q15 的状态为 Q31），否则 Ki * Ts / 2 * u 这样的增量小于信号的分辨率，
+ *       会被舍入为 0，积分作用消失；32 位的信号状态也是 32 位
+ */
+template <typename Storage, int FracBits>
+struct NumericTraits<Fixed<Storage, FracBits>> {
+    using ParamType       = double;
+    using CoefficientType = FixedCoefficient<Fixed<Storage, FracBits>>;
+    using StateType       = std::conditional_t<std::is_same<Storage, int16_t>::value, Fixed<int32_t, FracBits + 16>,
+                                               Fixed<Storage, FracBits>>;
+};
+
+} // namespace control_system
+
+namespace std
+{
+
+template <typename Storage, int FracBits>
+class numeric_limits<control_system::Fixed<Storage, FracBits>>
+{
+private:
+    using Type = control_system::Fixed<Storage, FracBits>;
+
+public:
+    static constexpr bool is_specialized    = true;
+    static constexpr bool is_signed         = true;
+    static constexpr bool is_integer        = false;
+    static constexpr bool is_exact          = true;
+    static constexpr bool has_infinity      = false;
+    static constexpr bool has_quiet_NaN     = false;
+    static constexpr bool has_signaling_NaN = false;
+    static constexpr bool is_bounded        = true;
+    static constexpr bool is_modulo         = false;
+    static constexpr int radix              = 2;
+    static constexpr int digits             = numeric_limits<Storage>::digits;
+    static constexpr float_round_style round_style = round_to_nearest;
+
+    // 与浮点类型一致，min() 为最小的正数
+    static constexpr Type min() noexcept
+    {
+        return Type::FromRaw(1);
+    }
+
+    static constexpr Type lowest() noexcept
+    {
+        return Type::FromRaw(numeric_limits<Storage>::min());
+    }
+
+    static constexpr Type max() noexcept
+    {
+        return Type::FromRaw(numeric_limits<Storage>::max());
+    }
+
+    static constexpr Type epsilon() noexcept
+    {
+        return Type::FromRaw(1);
+    }
+
+    static constexpr Type round_error() noexcept
+    {
+        return Type::FromRaw(FracBits > 0 ? Storage(Storage(1) << (FracBits - 1)) : Storage(0));
+    }
+};
+
+} // namespace std
@@ -0,0 +1,429 @@
+/**
+ * @file frequency_response.hpp
+ * @author X. Y.
+ * @brief 频率响应（Bode 图、Nyquist 图）和稳定裕度
+ * @version 0.1
+ * @date 2023-09-01
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 在很多个频率点上计算离散传递函数的频率响应 H(e^{jωTs})：
+ * - 传递函数用 block_algebra.hpp 中的 TfPolynomials 表示，ZTf、PID 等线性控制器由 LinearTf() 得到，
+ *   带抗饱和的 PID/PI 由 LinearRegionTf() 得到线性区（输出不饱和时）的传递函数
+ * - 频率点在构造时给定，z = e^{jωTs} 的实部和虚部预先算好，按“结构数组”存放
+ * - 分子分母用秦九韶（Horner）算法求值，每一步是对一段连续频率点的复数乘加，编译器可以生成 SIMD 指令
+ * - 频率点分段，可以用 ParallelExecutor 多线程计算；EvaluateBatch()、MarginsBatch() 一次计算很多个系统，分摊线程同步的开销
+ *
+ * 稳定裕度由频率响应求得，相邻频率点之间线性插值，频率点越密越准确：
+ * - 相角裕度：|L| = 1 处 180° + ∠L 的最小值
+ * - 幅值裕度：L 穿过负实轴处 1 / |L| 的最小值
+ * 频率点之外总是再加上 Nyquist 频率 π / Ts 这一点（z = -1，L 为实数），L(-1) < 0 时那里就是一个相角穿越，
+ * 频率点停在 π / Ts 之前（例如 LogSpace(0.1, 3141, n)，Ts = 0.001）也不会漏掉
+ * 另外用 Schur-Cohn（Jury）判据判断闭环特征多项式 den + num 的根是否都在单位圆内（单位负反馈闭环是否稳定），不需要求根
+ *
+ * 使用示例：
+ * control_system::pid::PID<double, control_system::DiscreteIntegrator<double>> pid{1.2, 10, 0.01, 100, 0.001};
+ * control_system::ZTf<double> plant({0, 0.01}, {1, -0.99});
+ * auto loop = control_system::OpenLoopTf(control_system::LinearTf(pid), control_system::LinearTf(plant));
+ *
+ * auto frequencies = control_system::FrequencyResponse<double>::LogSpace(0.1, 3141, 2000);
+ * control_system::FrequencyResponse<double> response(frequencies, 0.001);
+ * std::vector<std::complex<double>> h(response.Size());
+ * response.Evaluate(loop, h.data());
+ * auto margins = response.Margins(loop); // margins.phase_margin、margins.gain_margin ...
+ *
+ */
+
+#pragma once
+
+#include "block_algebra.hpp"
+#include "parallel_executor.hpp"
+#include "polynomial.hpp"
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <cassert>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+
+namespace control_system
+{
+
+namespace detail
+{
+
+// 线性区中 Ki 与积分器串联：Ki c (z + 1) / (z - 1)
+template <typename IntegratorCoefficients>
+TfPolynomials AntiWindupIntegratorTf(double Ki, const IntegratorCoefficients &integrator)
+{
+    double c = Ki * integrator.input_coefficient;
+    return {{c, c}, {1, -1}};
+}
+
+} // namespace detail
+
+/**
+ * 带抗饱和的 PID/PI 在线性区（输出不饱和、反算项为 0）的传递函数，此时积分器的输入为 Ki * u
+ * 它们不是线性控制器，所以不提供 LinearTf()，Series() 等仍按非线性控制器组合
+ */
+
+template <typename T, typename DType>
+TfPolynomials LinearRegionTf(const pid::static_dispatch::PID_AntiWindup<T, DType> &pid)
+{
+    const auto c    = pid.GetCoefficients();
+    const double ci = c.d.input_coefficient;
+    const double co = c.d.output_coefficient;
+
+    auto tf = detail::ParallelTf(detail::GainTf(c.Kp), detail::AntiWindupIntegratorTf(c.Ki, c.integrator));
+    return detail::ParallelTf(tf, TfPolynomials{{ci, -ci}, {1, -co}});
+}
+
+template <typename T>
+TfPolynomials LinearRegionTf(const pid::static_dispatch::PI_AntiWindup<T> &pi)
+{
+    const auto c = pi.GetCoefficients();
+    return detail::ParallelTf(detail::GainTf(c.Kp), detail::AntiWindupIntegratorTf(c.Ki, c.integrator));
+}
+
+/**
+ * @brief 开环传递函数：控制器与对象串联（不约去零极点，批量计算时比 Series() 快）
+ *
+ */
+inline TfPolynomials OpenLoopTf(const TfPolynomials &controller, const TfPolynomials &plant)
+{
+    return detail::SeriesTf(controller, plant);
+}
+
+/**
+ * @brief 单位负反馈闭环是否稳定，即特征多项式 den + num 的根都在单位圆内
+ * @note 用 Schur-Cohn（Jury）判据逐次降阶，不需要求根，运算量为 O(n²)
+ *
+ * @param loop 开环传递函数
+ */
+inline bool IsClosedLoopStable(const TfPolynomials &loop)
+{
+    assert(loop.num.size() <= loop.den.size());
+
+    auto a = PolyTrim(PolyAdd(loop.den, loop.num));
+    if (a.empty() || a[0] == 0) return false;
+
+    // a(z) = a0 z^n + ... + an，根都在单位圆内当且仅当 |an| < |a0|，且 (a0 a(z) - an z^n a(1/z)) / z 的根都在单位圆内
+    for (size_t n = a.size() - 1; n > 0; n--) {
+        const double k = a[n] / a[0];
+        if (!(std::abs(k) < 1)) return false;
+
+        std::vector<double> reduced(n);
+        for (size_t i = 0; i < n; i++) {
+            reduced[i] = a[i] - k * a[n - i];
+        }
+        a.swap(reduced);
+    }
+    return true;
+}
+
+/**
+ * @brief 开环传递函数的稳定裕度，没有穿越时裕度为无穷大、频率为 NaN
+ *
+ */
+template <typename T>
+struct StabilityMargins {
+    T gain_margin               = std::numeric_limits<T>::infinity();  // 幅值裕度（倍数）
+    T phase_margin              = std::numeric_limits<T>::infinity();  // 相角裕度（度）
+    T phase_crossover_frequency = std::numeric_limits<T>::quiet_NaN(); // 幅值裕度所在的频率（rad/s）
+    T gain_crossover_frequency  = std::numeric_limits<T>::quiet_NaN(); // 相角裕度所在的频率（rad/s）
+    bool stable                 = false;                               // 单位负反馈闭环是否稳定
+};
+
+/**
+ * @brief 在一组固定的频率点上计算频率响应
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ */
+template <typename T>
+class FrequencyResponse
+{
+private:
+    // 每段的频率点数，一段的中间结果放在栈上的数组里
+    static constexpr size_t kChunkSize = 256;
+
+    // 转换为 T 的系数（降幂排列）
+    struct Polynomials {
+        std::vector<T> num, den;
+    };
+
+    T Ts_;
+    std::vector<T> frequencies_;
+    std::vector<T> zr_, zi_; // z = e^{jωTs} 的实部和虚部
+
+    // 多线程时有固定数量的任务，第 task 个任务执行 job_(task)
+    std::unique_ptr<ParallelExecutor> executor_;
+    std::function<void(size_t)> job_;
+
+    size_t ChunkCount() const
+    {
+        return (frequencies_.size() + kChunkSize - 1) / kChunkSize;
+    }
+
+    static Polynomials Convert(const TfPolynomials &tf)
+    {
+        assert(!tf.num.empty() && !tf.den.empty() && tf.num.size() <= tf.den.size());
+        return {std::vector<T>(tf.num.begin(), tf.num.end()), std::vector<T>(tf.den.begin(), tf.den.end())};
+    }
+
+    /**
+     * @brief 对 [begin, begin + length) 的频率点求多项式的值
+     *
+     */
+    void Horner(const std::vector<T> &a, size_t begin, size_t length, T *re, T *im) const
+    {
+        const T *zr = zr_.data() + begin;
+        const T *zi = zi_.data() + begin;
+
+        std::fill(re, re + length, a[0]);
+        std::fill(im, im + length, T(0));
+        for (size_t k = 1; k < a.size(); k++) {
+            const T ak = a[k];
+            for (size_t i = 0; i < length; i++) {
+                const T r = re[i] * zr[i] - im[i] * zi[i] + ak;
+                const T j = re[i] * zi[i] + im[i] * zr[i];
+                re[i]     = r;
+                im[i]     = j;
+            }
+        }
+    }
+
+    void EvaluateChunk(const Polynomials &tf, size_t chunk, std::complex<T> *response) const
+    {
+        const size_t begin  = chunk * kChunkSize;
+        const size_t length = std::min(kChunkSize, frequencies_.size() - begin);
+
+        T nr[kChunkSize], ni[kChunkSize], dr[kChunkSize], di[kChunkSize];
+        Horner(tf.num, begin, length, nr, ni);
+        Horner(tf.den, begin, length, dr, di);
+
+        for (size_t i = 0; i < length; i++) {
+            const T scale       = 1 / (dr[i] * dr[i] + di[i] * di[i]);
+            const T re          = (nr[i] * dr[i] + ni[i] * di[i]) * scale;
+            const T im          = (ni[i] * dr[i] - nr[i] * di[i]) * scale;
+            response[begin + i] = {re, im};
+        }
+    }
+
+    /**
+     * @brief 频率从 f0 到 f1、响应从 a 到 b 的一段上的穿越，更新裕度
+     *
+     */
+    static void SegmentMargins(std::complex<T> a, std::complex<T> b, T f0, T f1, StabilityMargins<T> &margins)
+    {
+        constexpr T kRadToDeg = T(57.295779513082320876798);
+
+        const T df = f1 - f0;
+
+        // 幅值穿越：|L| 经过 1，先用 |L|² 判断，只在穿越处开方
+        const T na = std::norm(a);
+        const T nb = std::norm(b);
+        if ((na - 1) * (nb - 1) <= 0 && na != nb) {
+            const T ma = std::sqrt(na);
+            const T mb = std::sqrt(nb);
+            const T t  = (1 - ma) / (mb - ma);
+            T phase   = 180 + std::arg(a + (b - a) * t) * kRadToDeg;
+            phase     = phase > 180 ? phase - 360 : phase;
+            if (phase < margins.phase_margin) {
+                margins.phase_margin             = phase;
+                margins.gain_crossover_frequency = f0 + df * t;
+            }
+        }
+
+        // 相角穿越：L 经过负实轴
+        if (a.imag() * b.imag() <= 0 && a.imag() != b.imag()) {
+            const T t  = a.imag() / (a.imag() - b.imag());
+            const T re = a.real() + (b.real() - a.real()) * t;
+            if (re < 0 && -1 / re < margins.gain_margin) {
+                margins.gain_margin               = -1 / re;
+                margins.phase_crossover_frequency = f0 + df * t;
+            }
+        }
+    }
+
+    /**
+     * @brief 对 0 ~ count - 1 中的每个 i 调用 job(i)，有多个线程时分到各任务上
+     *
+     */
+    void ParallelFor(size_t count, const std::function<void(size_t)> &job)
+    {
+        if (!executor_ || count <= 1) {
+            for (size_t i = 0; i < count; i++) {
+                job(i);
+            }
+            return;
+        }
+
+        const size_t tasks = executor_->TaskCount();
+        job_               = [&](size_t task) {
+            for (size_t i = task; i < count; i += tasks) {
+                job(i);
+            }
+        };
+        executor_->RunTick();
+        job_ = nullptr;
+    }
+
+public:
+    /**
+     * @brief 创建频率响应计算器
+     *
+     * @param frequencies 频率点（rad/s），一般不超过 Nyquist 频率 π / Ts；求裕度时应从小到大排列
+     * @param Ts 采样周期（秒）
+     * @param threads 线程数，为 1 时在调用的线程中计算
+     */
+    FrequencyResponse(const std::vector<T> &frequencies, T Ts, size_t threads = 1)
+        : Ts_{Ts}, frequencies_(frequencies), zr_(frequencies.size()), zi_(frequencies.size())
+    {
+        for (size_t i = 0; i < frequencies_.size(); i++) {
+            zr_[i] = std::cos(frequencies_[i] * Ts);
+            zi_[i] = std::sin(frequencies_[i] * Ts);
+        }
+
+        if (threads > 1) {
+            // 任务数多于线程数，各线程耗时不均时可以互相窃取
+            executor_.reset(new ParallelExecutor(threads, 1));
+            for (size_t task = 0; task < 4 * threads; task++) {
+                executor_->AddTask([this, task] { job_(task); });
+            }
+        }
+    }
+
+    FrequencyResponse(const FrequencyResponse &)            = delete;
+    FrequencyResponse &operator=(const FrequencyResponse &) = delete;
+
+    /**
+     * @brief [min, max] 之间按对数均匀分布的 n 个频率点
+     *
+     */
+    static std::vector<T> LogSpace(T min, T max, size_t n)
+    {
+        assert(min > 0 && max >= min);
+
+        std::vector<T> result(n);
+        for (size_t i = 0; i < n; i++) {
+            const T t = n > 1 ? T(i) / T(n - 1) : T(0);
+            result[i] = min * std::pow(max / min, t);
+        }
+        return result;
+    }
+
+    /**
+     * @brief 一个系统的频率响应
+     *
+     * @param response 长度为 Size()，第 k 个为第 k 个频率点的响应
+     */
+    void Evaluate(const TfPolynomials &tf, std::complex<T> *response)
+    {
+        const auto polynomials = Convert(tf);
+        ParallelFor(ChunkCount(), [&](size_t chunk) { EvaluateChunk(polynomials, chunk, response); });
+    }
+
+    /**
+     * @brief 很多个系统的频率响应
+     *
+     * @param responses 长度为 tfs.size() * Size()，第 s 个系统在第 k 个频率点的响应为 responses[s * Size() + k]
+     */
+    void EvaluateBatch(const std::vector<TfPolynomials> &tfs, std::complex<T> *responses)
+    {
+        std::vector<Polynomials> polynomials(tfs.size());
+        ParallelFor(tfs.size(), [&](size_t s) { polynomials[s] = Convert(tfs[s]); });
+
+        const size_t chunks = ChunkCount();
+        ParallelFor(tfs.size() * chunks, [&](size_t job) {
+            const size_t s = job / chunks;
+            EvaluateChunk(polynomials[s], job % chunks, responses + s * frequencies_.size());
+        });
+    }
+
+    /**
+     * @brief 由算好的开环频率响应求裕度（不判断闭环稳定性，stable 为 false）
+     * @note 除了各频率点，还计算 Nyquist 频率 π / Ts 处的 L(-1)：最后一个频率点小于 π / Ts 时补上到 π / Ts 的一段，
+     *       L(-1) < 0 时 π / Ts 处是一个相角穿越
+     *
+     * @param response 长度为 Size()，由 Evaluate(loop, ...) 算出
+     * @param loop 开环传递函数，用来求 L(-1)
+     */
+    StabilityMargins<T> MarginsOf(const std::complex<T> *response, const TfPolynomials &loop) const
+    {
+        StabilityMargins<T> margins;
+        for (size_t k = 0; k + 1 < frequencies_.size(); k++) {
+            SegmentMargins(response[k], response[k + 1], frequencies_[k], frequencies_[k + 1], margins);
+        }
+
+        // z = -1 时 L 为实数；分母在 z = -1 处为 0（极点在 Nyquist 频率上）时没有有限的值
+        const double nyquist_den = PolyEval(loop.den, -1.0);
+        if (frequencies_.empty() || nyquist_den == 0) return margins;
+
+        const T nyquist_frequency = T(3.14159265358979323846) / Ts_;
+        const std::complex<T> nyquist_response(T(PolyEval(loop.num, -1.0) / nyquist_den), 0);
+        if (frequencies_.back() < nyquist_frequency) {
+            SegmentMargins(response[frequencies_.size() - 1], nyquist_response, frequencies_.back(), nyquist_frequency, margins);
+        }
+        if (nyquist_response.real() < 0 && -1 / nyquist_response.real() < margins.gain_margin) {
+            margins.gain_margin               = -1 / nyquist_response.real();
+            margins.phase_crossover_frequency = nyquist_frequency;
+        }
+        return margins;
+    }
+
+    /**
+     * @brief 开环传递函数的稳定裕度
+     *
+     */
+    StabilityMargins<T> Margins(const TfPolynomials &loop)
+    {
+        std::vector<std::complex<T>> response(frequencies_.size());
+        Evaluate(loop, response.data());
+
+        auto margins   = MarginsOf(response.data(), loop);
+        margins.stable = IsClosedLoopStable(loop);
+        return margins;
+    }
+
+    /**
+     * @brief 很多个开环传递函数的稳定裕度，按系统分到各线程上，每个系统的频率响应用完即丢，不占用大量内存
+     *
+     */
+    std::vector<StabilityMargins<T>> MarginsBatch(const std::vector<TfPolynomials> &loops)
+    {
+        const size_t chunks = ChunkCount();
+
+        std::vector<StabilityMargins<T>> margins(loops.size());
+        ParallelFor(loops.size(), [&](size_t s) {
+            const auto polynomials = Convert(loops[s]);
+            std::vector<std::complex<T>> response(frequencies_.size());
+            for (size_t chunk = 0; chunk < chunks; chunk++) {
+                EvaluateChunk(polynomials, chunk, response.data());
+            }
+
+            margins[s]        = MarginsOf(response.data(), loops[s]);
+            margins[s].stable = IsClosedLoopStable(loops[s]);
+        });
+        return margins;
+    }
+
+    const std::vector<T> &GetFrequencies() const
+    {
+        return frequencies_;
+    }
+
+    size_t Size() const
+    {
+        return frequencies_.size();
+    }
+
+    T GetTs() const
+    {
+        return Ts_;
+    }
+};
+
+} // namespace control_system
@@ -0,0 +1,279 @@
+/**
+ * @file gain_scheduled_pid.hpp
+ * @author X. Y.
+ * @brief 增益调度 PID 控制器
+ * @version 0.1
+ * @date 2023-08-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 被控对象的动态随工作点变化时，按调度变量（例如转速、负载）在一张断点表中插值得到当前的 PID 系数：
+ * - 表中存放的是预先算好的最终系数（Kp、积分器的 Ki*Ts/2、微分器的两个系数），而不是 Kp/Ki/Kd/Kn，
+ *   每段还预先算好了各系数对调度变量的斜率，插值只是 “系数 = 起点 + 斜率 * (s - 断点)”，每个采样周期没有除法
+ * - 查表从上一次所在的段开始向前或向后找，调度变量连续变化时通常不用移动或只移动一段
+ * - 调度变量超出表的范围时取两端的系数；最后一个断点的系数单独保存，不由最后一段插值得到
+ * - Ki 放在积分器里面（对 Ki * e 积分，而不是 Ki 乘以 e 的积分），微分器的状态就是它的输出，
+ *   因此系数变化时积分项和微分项的输出都是连续的，不会跳变
+ * - 从手动或其他控制器切换过来时，用 BumplessTransfer() 设置积分器状态，使切换后的第一个输出等于切换前的输出
+ *
+ * 调度变量不变且在断点上（包括两端）时，运算结果与该断点参数的 pid::PID<T>（带积分限幅）逐位相同
+ *
+ * 使用示例：
+ * // 三个工作点的参数，Ts = 0.001
+ * control_system::pid::GainScheduledPID<float> pid_controller({0, 1000, 3000},     // 调度变量的断点，必须递增
+ *                                                             {1.0, 1.5, 2.0},     // Kp
+ *                                                             {10, 15, 30},        // Ki
+ *                                                             {0, 0, 0},           // Kd
+ *                                                             {100, 100, 100},     // Kn
+ *                                                             0.001);
+ * output = pid_controller.Step(error, speed); // 按 speed 插值系数后走一个采样周期
+ *
+ */
+
+#pragma once
+
+#include "discrete_controller_base.hpp"
+#include "instrumentation.hpp"
+#include "pid_controller.hpp"
+#include "saturation.hpp"
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace control_system
+{
+
+namespace pid
+{
+
+namespace static_dispatch
+{
+
+template <typename T>
+class GainScheduledPID : public StaticControllerBase<GainScheduledPID<T>, T>
+{
+public:
+    /**
+     * @brief 一个工作点的最终系数
+     *
+     */
+    struct Gains {
+        T Kp;
+        T i_input_coefficient; // 积分器的 Ki * Ts / 2
+        T d_input_coefficient;
+        T d_output_coefficient;
+    };
+
+    Saturation<T, T> integrator_saturation; // 积分限幅，与 pid::PID 中 i_controller.saturation 的作用相同
+
+private:
+    struct Segment {
+        T breakpoint; // 这一段的起点
+        Gains base;   // 起点处的系数
+        Gains slope;  // 各系数对调度变量的斜率
+    };
+
+    std::vector<Segment> segments_;
+    Gains last_gains_{};  // 最后一个断点处的系数
+    T min_ = 0, max_ = 0; // 调度变量的范围
+    T Ts_  = 0;
+    size_t index_ = 0;    // 上一次所在的段
+    Gains gains_{};       // 当前的系数
+
+    T x_ = 0; // 积分器状态，与 DiscreteIntegrator 相同
+    T last_input_  = 0;
+    T last_output_ = 0; // 微分器状态，与 D 相同
+
+    static Gains MakeGains(T Kp, T Ki, T Kd, T Kn, T Ts)
+    {
+        auto i = control_system::static_dispatch::DiscreteIntegrator<T>::MakeCoefficients(Ki, Ts);
+        auto d = D<T>::MakeCoefficients(Kd, Kn, Ts);
+        return {Kp, i.input_coefficient, d.input_coefficient, d.output_coefficient};
+    }
+
+public:
+    /**
+     * @brief 增益调度 PID 控制器
+     *
+     * @param breakpoints 调度变量的断点，至少一个，必须严格递增
+     * @param Kp 各断点处的比例系数
+     * @param Ki 各断点处的积分系数
+     * @param Kd 各断点处的微分系数
+     * @param Kn 各断点处的滤波器系数
+     * @param Ts 采样周期（秒）
+     */
+    GainScheduledPID(const std::vector<T> &breakpoints,
+                     const std::vector<T> &Kp, const std::vector<T> &Ki,
+                     const std::vector<T> &Kd, const std::vector<T> &Kn, T Ts)
+    {
+        Init(breakpoints, Kp, Ki, Kd, Kn, Ts);
+    }
+
+    /**
+     * @brief 重新指定断点表，参数与构造函数相同
+     * @note 会分配内存、做除法，不要在控制线程中每个周期调用；内部状态保留
+     */
+    void Init(const std::vector<T> &breakpoints,
+              const std::vector<T> &Kp, const std::vector<T> &Ki,
+              const std::vector<T> &Kd, const std::vector<T> &Kn, T Ts)
+    {
+        auto count = breakpoints.size();
+        assert(count >= 1);
+        assert(Kp.size() == count && Ki.size() == count && Kd.size() == count && Kn.size() == count);
+
+        std::vector<Gains> gains;
+        for (size_t i = 0; i < count; i++) {
+            gains.push_back(MakeGains(Kp[i], Ki[i], Kd[i], Kn[i], Ts));
+        }
+
+        // 只有一个断点时，用一段斜率为 0 的段表示
+        segments_.assign(count > 1 ? count - 1 : 1, Segment{breakpoints[0], gains[0], Gains{}});
+        for (size_t i = 0; i + 1 < count; i++) {
+            assert(breakpoints[i + 1] > breakpoints[i]); // 断点必须严格递增
+
+            auto scale = 1 / (breakpoints[i + 1] - breakpoints[i]);
+            auto &a    = gains[i];
+            auto &b    = gains[i + 1];
+
+            segments_[i].breakpoint = breakpoints[i];
+            segments_[i].base       = a;
+            segments_[i].slope      = {(b.Kp - a.Kp) * scale,
+                                       (b.i_input_coefficient - a.i_input_coefficient) * scale,
+                                       (b.d_input_coefficient - a.d_input_coefficient) * scale,
+                                       (b.d_output_coefficient - a.d_output_coefficient) * scale};
+        }
+
+        last_gains_ = gains.back();
+        min_        = breakpoints.front();
+        max_        = breakpoints.back();
+        Ts_         = Ts;
+        index_      = 0;
+        SetSchedulingVariable(min_);
+    }
+
+    /**
+     * @brief 按调度变量插值出当前的系数，之后的 Step(input) 都使用这组系数
+     *
+     */
+    void SetSchedulingVariable(T scheduling_variable)
+    {
+        auto s = std::min(std::max(scheduling_variable, min_), max_);
+
+        // 在最后一个断点上（或超出）时直接取该处的系数，base + slope * ds 不一定与之逐位相同
+        const size_t last = segments_.size() - 1;
+        if (s >= max_) {
+            index_ = last;
+            gains_ = last_gains_;
+            return;
+        }
+
+        // 从上一次所在的段开始找
+        const Segment *segments = segments_.data();
+        size_t index            = index_;
+        while (index > 0 && s < segments[index].breakpoint) {
+            index--;
+        }
+        while (index < last && s >= segments[index + 1].breakpoint) {
+            index++;
+        }
+        index_ = index;
+
+        const auto &segment = segments[index];
+        auto ds             = s - segment.breakpoint;
+
+        gains_ = {segment.base.Kp + segment.slope.Kp * ds,
+                  segment.base.i_input_coefficient + segment.slope.i_input_coefficient * ds,
+                  segment.base.d_input_coefficient + segment.slope.d_input_coefficient * ds,
+                  segment.base.d_output_coefficient + segment.slope.d_output_coefficient * ds};
+    }
+
+    /**
+     * @brief 用当前的系数走一个采样周期
+     *
+     * @param input 输入
+     * @return T 输出
+     */
+    T Step(T input)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("pid::GainScheduledPID::Step");
+        auto p = gains_.Kp * input;
+
+        // 与 DiscreteIntegratorSaturation::Step() 相同
+        auto temp = gains_.i_input_coefficient * input;
+        auto i    = integrator_saturation(x_ + temp);
+        x_        = i + temp;
+
+        // 与 D::Step() 相同
+        last_output_ = gains_.d_input_coefficient * (input - last_input_) + gains_.d_output_coefficient * last_output_;
+        last_input_  = input;
+
+        return p + i + last_output_;
+    }
+
+    /**
+     * @brief 按调度变量插值系数，再走一个采样周期
+     *
+     * @param input 输入
+     * @param scheduling_variable 调度变量
+     * @return T 输出
+     */
+    T Step(T input, T scheduling_variable)
+    {
+        SetSchedulingVariable(scheduling_variable);
+        return Step(input);
+    }
+
+    /**
+     * @brief 无扰切换：设置积分器状态，使下一次 Step(input) 的输出等于 output（不考虑积分限幅）
+     * @note 在切换到本控制器之前调用，output 为切换前执行器的指令，input 为下一次 Step() 的输入
+     */
+    void BumplessTransfer(T output, T input)
+    {
+        auto p = gains_.Kp * input;
+        auto d = gains_.d_input_coefficient * (input - last_input_) + gains_.d_output_coefficient * last_output_;
+        x_     = output - p - d - gains_.i_input_coefficient * input;
+    }
+
+    /**
+     * @brief 当前（插值后）的系数
+     *
+     */
+    const Gains &GetGains() const
+    {
+        return gains_;
+    }
+
+    T GetTs() const
+    {
+        return Ts_;
+    }
+
+    /**
+     * @brief 重置控制器状态，系数不变
+     *
+     */
+    void ResetState()
+    {
+        x_           = 0;
+        last_input_  = 0;
+        last_output_ = 0;
+    }
+};
+
+} // namespace static_dispatch
+
+/**
+ * @brief 增益调度 PID 控制器（虚函数接口）
+ *
+ */
+template <typename T>
+class GainScheduledPID : public DynamicController<static_dispatch::GainScheduledPID<T>, GainScheduledPID<T>>
+{
+public:
+    using DynamicController<static_dispatch::GainScheduledPID<T>, GainScheduledPID<T>>::DynamicController;
+};
+
+} // namespace pid
+
+} // namespace control_system
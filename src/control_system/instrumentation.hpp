@@ -0,0 +1,339 @@
+/**
+ * @file instrumentation.hpp
+ * @author X. Y.
+ * @brief 控制器内部的统计（插桩），编译时开启
+ * @version 0.1
+ * @date 2023-08-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 用宏 CONTROL_SYSTEM_INSTRUMENTATION 选择插桩的级别（在包含任何头文件之前定义，或者在编译选项中 -D）：
+ * - 0（默认）：不插桩，各个 CONTROL_SYSTEM_PROBE_* 宏展开为空，生成的代码与没有插桩时完全相同
+ * - 1：计数。Saturation 的调用次数和限幅次数；带限幅的积分器和抗饱和 PID 处于饱和状态的步数，以及每次连续饱和的长度分布
+ * - 2：在 1 的基础上，统计各控制器每次 Step() 的 CPU 周期数（x86 为 rdtsc，AArch64 为 cntvct_el0，其他平台为纳秒）
+ *
+ * 每个插桩点（probe）在第一次执行时登记到一个全局链表中，同一个模板的每个实例化各有一个插桩点，Snapshot() 时按名称合并
+ * 计数都是 relaxed 的原子操作，可以在监控线程中随时调用 Snapshot()，不加锁，也不会影响控制线程
+ *
+ * 使用示例：
+ * // 编译选项中加上 -DCONTROL_SYSTEM_INSTRUMENTATION=2
+ * for (const auto &probe : control_system::instrumentation::Snapshot()) {
+ *     printf("%s: calls %llu, hit rate %g, cycles per call %g\n", probe.name.c_str(),
+ *            (unsigned long long)probe.calls, probe.HitRate(), probe.CyclesPerCall());
+ * }
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef CONTROL_SYSTEM_INSTRUMENTATION
+#define CONTROL_SYSTEM_INSTRUMENTATION 0
+#endif
+
+namespace control_system
+{
+
+namespace instrumentation
+{
+
+constexpr size_t kStreakBucketCount = 32; // 连续饱和长度的直方图，第 i 个桶为 [2^(i-1), 2^i) 步
+
+/**
+ * @brief 读 CPU 周期计数器
+ *
+ */
+inline uint64_t ReadCycleCounter()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @brief 某一时刻一个插桩点的统计
+ *
+ */
+struct ProbeSnapshot {
+    std::string name;
+    uint64_t calls      = 0; // 执行次数
+    uint64_t hits       = 0; // 条件成立的次数（限幅、饱和）
+    uint64_t cycles     = 0; // 总周期数（级别 2）
+    uint64_t streaks    = 0; // 连续饱和的次数（只计已经结束的）
+    uint64_t max_streak = 0; // 已经结束的连续饱和中最长的一次（步）
+    std::array<uint64_t, kStreakBucketCount> streak_histogram{};
+
+    double HitRate() const
+    {
+        return calls == 0 ? 0 : double(hits) / calls;
+    }
+
+    double CyclesPerCall() const
+    {
+        return calls == 0 ? 0 : double(cycles) / calls;
+    }
+};
+
+class Probe;
+
+inline std::atomic<Probe *> &ProbeList()
+{
+    static std::atomic<Probe *> head{nullptr};
+    return head;
+}
+
+/**
+ * @brief 一个插桩点，由 CONTROL_SYSTEM_PROBE_* 宏定义为函数内的静态变量
+ *
+ */
+class Probe
+{
+private:
+    const char *name_;
+    std::atomic<uint64_t> calls_{0};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> cycles_{0};
+    std::atomic<uint64_t> streaks_{0};
+    std::atomic<uint64_t> max_streak_{0};
+    std::array<std::atomic<uint64_t>, kStreakBucketCount> streak_histogram_{};
+    Probe *next_ = nullptr;
+
+    static size_t BucketOf(uint64_t length)
+    {
+        size_t bucket = 0;
+        while (length != 0 && bucket + 1 < kStreakBucketCount) {
+            length >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+public:
+    explicit Probe(const char *name)
+        : name_{name}
+    {
+        // 无锁地插入链表头
+        auto &head = ProbeList();
+        next_      = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(next_, this, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    Probe(const Probe &)            = delete;
+    Probe &operator=(const Probe &) = delete;
+
+    void Record(bool hit)
+    {
+        calls_.fetch_add(1, std::memory_order_relaxed);
+        if (hit) hits_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void AddCycles(uint64_t cycles)
+    {
+        calls_.fetch_add(1, std::memory_order_relaxed);
+        cycles_.fetch_add(cycles, std::memory_order_relaxed);
+    }
+
+    void RecordStreak(uint64_t length)
+    {
+        streaks_.fetch_add(1, std::memory_order_relaxed);
+        streak_histogram_[BucketOf(length)].fetch_add(1, std::memory_order_relaxed);
+
+        auto max = max_streak_.load(std::memory_order_relaxed);
+        while (length > max && !max_streak_.compare_exchange_weak(max, length, std::memory_order_relaxed)) {
+        }
+    }
+
+    void Reset()
+    {
+        calls_.store(0, std::memory_order_relaxed);
+        hits_.store(0, std::memory_order_relaxed);
+        cycles_.store(0, std::memory_order_relaxed);
+        streaks_.store(0, std::memory_order_relaxed);
+        max_streak_.store(0, std::memory_order_relaxed);
+        for (auto &bucket : streak_histogram_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief 把本插桩点的统计加到 snapshot 上
+     *
+     */
+    void AddTo(ProbeSnapshot &snapshot) const
+    {
+        snapshot.calls += calls_.load(std::memory_order_relaxed);
+        snapshot.hits += hits_.load(std::memory_order_relaxed);
+        snapshot.cycles += cycles_.load(std::memory_order_relaxed);
+        snapshot.streaks += streaks_.load(std::memory_order_relaxed);
+        snapshot.max_streak = std::max(snapshot.max_streak, max_streak_.load(std::memory_order_relaxed));
+        for (size_t i = 0; i < kStreakBucketCount; i++) {
+            snapshot.streak_histogram[i] += streak_histogram_[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    const char *GetName() const
+    {
+        return name_;
+    }
+
+    const Probe *Next() const
+    {
+        return next_;
+    }
+
+    Probe *Next()
+    {
+        return next_;
+    }
+};
+
+/**
+ * @brief 在作用域结束时把经过的周期数记到插桩点上
+ *
+ */
+class ScopedCycles
+{
+private:
+    Probe &probe_;
+    uint64_t start_;
+
+public:
+    explicit ScopedCycles(Probe &probe)
+        : probe_{probe}, start_{ReadCycleCounter()} {};
+
+    ~ScopedCycles()
+    {
+        probe_.AddCycles(ReadCycleCounter() - start_);
+    }
+};
+
+/**
+ * @brief 每个控制器实例各有一个，记录当前连续饱和了多少步，饱和结束时记到插桩点上
+ *
+ */
+class Streak
+{
+private:
+    uint64_t length_ = 0;
+
+public:
+    void Update(Probe &probe, bool saturated)
+    {
+        probe.Record(saturated);
+        if (saturated) {
+            length_++;
+        } else if (length_ != 0) {
+            probe.RecordStreak(length_);
+            length_ = 0;
+        }
+    }
+};
+
+/**
+ * @brief 所有插桩点当前的统计，同名的插桩点（同一个模板的不同实例化）合并为一项
+ * @note 可以在任何线程中随时调用；控制线程同时在计数时，各项之间可能相差几次
+ */
+inline std::vector<ProbeSnapshot> Snapshot()
+{
+    std::vector<ProbeSnapshot> snapshots;
+    for (auto probe = ProbeList().load(std::memory_order_acquire); probe != nullptr; probe = probe->Next()) {
+        auto it = std::find_if(snapshots.begin(), snapshots.end(),
+                               [&](const ProbeSnapshot &s) { return s.name == probe->GetName(); });
+        if (it == snapshots.end()) {
+            snapshots.emplace_back();
+            snapshots.back().name = probe->GetName();
+            it                    = snapshots.end() - 1;
+        }
+        probe->AddTo(*it);
+    }
+
+    std::sort(snapshots.begin(), snapshots.end(),
+              [](const ProbeSnapshot &a, const ProbeSnapshot &b) { return a.name < b.name; });
+    return snapshots;
+}
+
+/**
+ * @brief 清零所有插桩点
+ *
+ */
+inline void ResetProbes()
+{
+    for (auto probe = ProbeList().load(std::memory_order_acquire); probe != nullptr; probe = probe->Next()) {
+        probe->Reset();
+    }
+}
+
+} // namespace instrumentation
+
+} // namespace control_system
+
+#define CONTROL_SYSTEM_PROBE_CONCAT_(a, b) a##b
+#define CONTROL_SYSTEM_PROBE_CONCAT(a, b) CONTROL_SYSTEM_PROBE_CONCAT_(a, b)
+
+#if CONTROL_SYSTEM_INSTRUMENTATION >= 1
+
+// 计数：执行次数，以及 condition 成立的次数
+#define CONTROL_SYSTEM_PROBE_HIT(name, condition)                              \
+    do {                                                                       \
+        static ::control_system::instrumentation::Probe probe_instance_(name); \
+        probe_instance_.Record(condition);                                     \
+    } while (0)
+
+// 在类中声明一个记录连续饱和长度的成员
+#define CONTROL_SYSTEM_PROBE_STREAK_MEMBER(member) ::control_system::instrumentation::Streak member
+
+// 用成员 member 记录连续饱和的长度，saturated 为本步是否饱和
+#define CONTROL_SYSTEM_PROBE_STREAK(name, member, saturated)                   \
+    do {                                                                       \
+        static ::control_system::instrumentation::Probe probe_instance_(name); \
+        member.Update(probe_instance_, saturated);                             \
+    } while (0)
+
+#else
+
+#define CONTROL_SYSTEM_PROBE_HIT(name, condition) \
+    do {                                          \
+    } while (0)
+#define CONTROL_SYSTEM_PROBE_STREAK_MEMBER(member) static_assert(true, "")
+#define CONTROL_SYSTEM_PROBE_STREAK(name, member, saturated) \
+    do {                                                     \
+    } while (0)
+
+#endif
+
+#if CONTROL_SYSTEM_INSTRUMENTATION >= 2
+
+// 统计从这里到作用域结束的周期数
+#define CONTROL_SYSTEM_PROBE_TIME(name)                                                                         \
+    static ::control_system::instrumentation::Probe CONTROL_SYSTEM_PROBE_CONCAT(probe_time_, __LINE__)(name); \
+    ::control_system::instrumentation::ScopedCycles CONTROL_SYSTEM_PROBE_CONCAT(probe_scope_, __LINE__)(       \
+        CONTROL_SYSTEM_PROBE_CONCAT(probe_time_, __LINE__))
+
+#else
+
+#define CONTROL_SYSTEM_PROBE_TIME(name) static_assert(true, "")
+
+#endif
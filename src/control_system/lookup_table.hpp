@@ -0,0 +1,526 @@
+/**
+ * @file lookup_table.hpp
+ * @author X. Y.
+ * @brief 查表模块（1-D、2-D、N-D）
+ * @version 0.1
+ * @date 2023-08-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 按照 Simulink 中的 n-D Lookup Table 模块设计，输入超出断点范围时取端点的值（Clip）：
+ * - 插值方法：线性（Linear）或最近点（Nearest）
+ * - 输入为 NaN 时取第一个断点处的值
+ * - 断点等间距时直接由 (x - x0) / 间距 算出所在的段，不需要查找；除法在构造时变成了乘以间距的倒数
+ * - 断点不等间距时，先看上一次所在的段及其后一段，都不是再二分查找；输入连续变化时通常不用查找
+ * - 每段的间距倒数预先算好，插值时没有除法
+ * - 批量计算：LookupTable1D 的 StepBlock()，LookupTableND 的 EvaluateBlock()（分批先定位再按顶点累加，内层循环可以向量化）
+ *
+ * LookupTable1D 是一个控制器（Step() 即查表），可以与其他控制器串联、并联，放进 BlockDiagram 中
+ *
+ * 表格数据按第 0 维变化最快的顺序存放（与 Matlab 的列优先相同）：
+ *   table[i0 + n0 * (i1 + n1 * (i2 + ...))]
+ *
+ * 使用示例：
+ * control_system::LookupTable1D<float> feedforward({0, 1, 2, 4}, {0, 0.5, 0.8, 1.0});  // 断点和对应的值
+ * auto y = feedforward.Step(1.5);                                                     // 0.65
+ *
+ * control_system::LookupTable2D<float> map({{0, 1000, 2000}, {0, 50, 100}},            // 转速和负载的断点
+ *                                          {0, 1, 2, 3, 4, 5, 6, 7, 8});               // 3 x 3 的表，转速变化最快
+ * auto z = map(1500.0f, 20.0f);
+ *
+ */
+
+#pragma once
+
+#include "discrete_controller_base.hpp"
+#include "instrumentation.hpp"
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace control_system
+{
+
+/**
+ * @brief 插值方法
+ *
+ */
+enum class Interpolation {
+    Linear,  // 线性插值
+    Nearest, // 取最近的断点处的值
+};
+
+/**
+ * @brief 一维的断点，负责找到输入所在的段和段内的位置
+ *
+ * @tparam T 数据类型
+ */
+template <typename T>
+class Breakpoints
+{
+private:
+    std::vector<T> points_;
+    std::vector<T> inverse_spacing_; // 每段间距的倒数
+    bool even_      = false;
+    T inverse_step_ = 0; // 等间距时间距的倒数
+    size_t index_   = 0; // 上一次所在的段
+
+public:
+    Breakpoints(){};
+
+    /**
+     * @brief 由断点创建，断点至少两个，必须严格递增
+     * @note 每个断点与等间距网格的偏差都在几个舍入误差以内时，自动使用等间距的算法
+     */
+    explicit Breakpoints(const std::vector<T> &points)
+        : points_{points}
+    {
+        assert(points_.size() >= 2);
+        assert(points_.size() <= size_t(std::numeric_limits<std::int32_t>::max())); // LocateBlock() 用 32 位的下标
+
+        const auto count     = points_.size();
+        const auto step      = (points_.back() - points_.front()) / T(count - 1);
+        const auto tolerance = 16 * std::numeric_limits<T>::epsilon() * std::max(std::abs(points_.front()), std::abs(points_.back()));
+
+        even_ = true;
+        for (size_t i = 0; i + 1 < count; i++) {
+            auto spacing = points_[i + 1] - points_[i];
+            assert(spacing > 0); // 断点必须严格递增
+
+            inverse_spacing_.push_back(1 / spacing);
+            if (std::abs(points_[i + 1] - (points_.front() + step * T(i + 1))) > tolerance) even_ = false;
+        }
+        inverse_step_ = 1 / step;
+    }
+
+    /**
+     * @brief 等间距的断点：first, first + step, ..., 共 count 个
+     *
+     */
+    static Breakpoints Evenly(T first, T step, size_t count)
+    {
+        std::vector<T> points;
+        for (size_t i = 0; i < count; i++) {
+            points.push_back(first + step * T(i));
+        }
+        return Breakpoints(points);
+    }
+
+    /**
+     * @brief 找到 x 所在的段
+     *
+     * @param x 输入，超出范围时取端点
+     * @param fraction 输出 x 在这一段中的位置，0 到 1
+     * @return 段的序号 i，x 在 [points[i], points[i + 1]] 中
+     */
+    size_t Locate(T x, T &fraction)
+    {
+        const size_t last = points_.size() - 2; // 最后一段
+        x                 = Clip(x);
+
+        size_t i;
+        if (even_) {
+            T t      = (x - points_.front()) * inverse_step_;
+            i        = std::min(size_t(t), last);
+            fraction = t - T(i);
+            return i;
+        }
+
+        i = index_;
+        if (x < points_[i] || x > points_[i + 1]) {
+            // 输入通常连续变化，先看后一段
+            if (i < last && x >= points_[i + 1] && x <= points_[i + 2]) {
+                i++;
+            } else {
+                i = std::upper_bound(points_.begin() + 1, points_.end() - 1, x) - points_.begin() - 1;
+            }
+            index_ = i;
+        }
+
+        fraction = (x - points_[i]) * inverse_spacing_[i];
+        return i;
+    }
+
+    /**
+     * @brief 批量找到 x[k] 所在的段，结果与逐个调用 Locate() 相同
+     * @note 等间距时没有分支，各个查询点之间也没有依赖
+     *
+     */
+    void LocateBlock(const T *x, size_t *index, T *fraction, size_t n)
+    {
+        if (!even_) {
+            for (size_t k = 0; k < n; k++) {
+                index[k] = Locate(x[k], fraction[k]);
+            }
+            return;
+        }
+
+        const size_t last = points_.size() - 2;
+        const T first     = points_.front();
+        const T max       = points_.back();
+
+        for (size_t k = 0; k < n; k++) {
+            T v      = x[k];
+            v        = !(v >= first) ? first : v;
+            v        = v > max ? max : v;
+            T t      = (v - first) * inverse_step_;
+            auto i   = std::int32_t(t); // 32 位的转换可以向量化，64 位的不行（SSE2、AVX2）
+            i        = i > std::int32_t(last) ? std::int32_t(last) : i;
+
+            index[k]    = size_t(i);
+            fraction[k] = t - T(i);
+        }
+    }
+
+    /**
+     * @brief 超出范围时取端点，NaN 取第一个断点（std::min/max 会让 NaN 原样通过，之后转换为 size_t 是未定义行为）
+     *
+     */
+    T Clip(T x) const
+    {
+        if (!(x >= points_.front())) return points_.front();
+        return x > points_.back() ? points_.back() : x;
+    }
+
+    size_t Size() const
+    {
+        return points_.size();
+    }
+
+    bool IsEvenlySpaced() const
+    {
+        return even_;
+    }
+
+    T GetInverseStep() const
+    {
+        return inverse_step_;
+    }
+
+    const std::vector<T> &GetPoints() const
+    {
+        return points_;
+    }
+};
+
+/**
+ * @brief N 维查表
+ *
+ * @tparam T 数据类型
+ * @tparam N 维数
+ */
+template <typename T, size_t N>
+class LookupTableND
+{
+    static_assert(N >= 1, "维数至少为 1");
+
+private:
+    std::array<Breakpoints<T>, N> breakpoints_;
+    std::array<size_t, N> strides_;
+    std::vector<T> table_;
+    Interpolation interpolation_;
+
+    static constexpr size_t kBatchSize = 64; // EvaluateBlock() 每批的点数，中间结果放在栈上
+
+public:
+    /**
+     * @brief 创建 N 维查表
+     *
+     * @param breakpoints 各维的断点
+     * @param table 表格数据，第 0 维变化最快，长度为各维断点数之积
+     * @param interpolation 插值方法
+     */
+    LookupTableND(const std::array<Breakpoints<T>, N> &breakpoints, const std::vector<T> &table,
+                  Interpolation interpolation = Interpolation::Linear)
+        : breakpoints_{breakpoints}, table_{table}, interpolation_{interpolation}
+    {
+        size_t stride = 1;
+        for (size_t d = 0; d < N; d++) {
+            strides_[d] = stride;
+            stride *= breakpoints_[d].Size();
+        }
+        assert(table_.size() == stride); // 表格大小必须等于各维断点数之积
+    }
+
+    /**
+     * @brief 由各维断点的数组创建，其余参数相同
+     *
+     */
+    LookupTableND(const std::vector<std::vector<T>> &breakpoints, const std::vector<T> &table,
+                  Interpolation interpolation = Interpolation::Linear)
+        : LookupTableND(MakeBreakpoints(breakpoints), table, interpolation) {}
+
+    /**
+     * @brief 查表
+     *
+     * @param x 各维的输入
+     * @return T 输出
+     */
+    T Evaluate(const std::array<T, N> &x)
+    {
+        std::array<size_t, N> index;
+        std::array<T, N> fraction;
+        for (size_t d = 0; d < N; d++) {
+            index[d] = breakpoints_[d].Locate(x[d], fraction[d]);
+        }
+
+        if (interpolation_ == Interpolation::Nearest) {
+            size_t offset = 0;
+            for (size_t d = 0; d < N; d++) {
+                offset += (index[d] + (fraction[d] >= T(0.5))) * strides_[d];
+            }
+            return table_[offset];
+        }
+
+        size_t base = 0;
+        for (size_t d = 0; d < N; d++) {
+            base += index[d] * strides_[d];
+        }
+
+        // 对 2^N 个顶点加权求和，第 d 位为 1 表示第 d 维取段的终点
+        std::array<std::array<T, 2>, N> weights;
+        for (size_t d = 0; d < N; d++) {
+            weights[d] = {1 - fraction[d], fraction[d]};
+        }
+
+        T result = 0;
+        for (size_t corner = 0; corner < (size_t(1) << N); corner++) {
+            T weight      = 1;
+            size_t offset = base;
+            for (size_t d = 0; d < N; d++) {
+                size_t bit = (corner >> d) & 1;
+                weight *= weights[d][bit];
+                offset += bit * strides_[d];
+            }
+            result += weight * table_[offset];
+        }
+        return result;
+    }
+
+    /**
+     * @brief 查表，每一维一个参数，例如 table(x, y)
+     *
+     */
+    template <typename... Args>
+    T operator()(Args... x)
+    {
+        static_assert(sizeof...(Args) == N, "参数个数必须等于维数");
+        return Evaluate({T(x)...});
+    }
+
+    /**
+     * @brief 批量查表：output[k] = Evaluate({inputs[0][k], inputs[1][k], ...})
+     *
+     * @param inputs 各维的输入数组
+     * @param output 输出数组
+     * @param n 查询点的个数
+     */
+    void EvaluateBlock(const std::array<const T *, N> &inputs, T *output, size_t n)
+    {
+        // 每批 kBatchSize 个点：先逐维定位，再对每个顶点遍历这一批点；运算顺序与 Evaluate() 相同，结果逐位一致
+        size_t index[kBatchSize];
+        size_t offset[kBatchSize];
+        T weights[N][2][kBatchSize]; // 与 Evaluate() 中的 weights 相同：1 - fraction 和 fraction
+
+        for (size_t begin = 0; begin < n; begin += kBatchSize) {
+            const auto length = std::min(n - begin, kBatchSize);
+            T *out            = output + begin;
+
+            for (size_t k = 0; k < length; k++) {
+                offset[k] = 0;
+            }
+            for (size_t d = 0; d < N; d++) {
+                T *fraction = weights[d][1];
+                breakpoints_[d].LocateBlock(inputs[d] + begin, index, fraction, length);
+                if (interpolation_ == Interpolation::Nearest) {
+                    for (size_t k = 0; k < length; k++) {
+                        offset[k] += (index[k] + (fraction[k] >= T(0.5))) * strides_[d];
+                    }
+                } else {
+                    for (size_t k = 0; k < length; k++) {
+                        offset[k] += index[k] * strides_[d];
+                        weights[d][0][k] = 1 - fraction[k];
+                    }
+                }
+            }
+
+            const T *table = table_.data();
+            if (interpolation_ == Interpolation::Nearest) {
+                for (size_t k = 0; k < length; k++) {
+                    out[k] = table[offset[k]];
+                }
+                continue;
+            }
+
+            for (size_t k = 0; k < length; k++) {
+                out[k] = 0;
+            }
+            for (size_t corner = 0; corner < (size_t(1) << N); corner++) {
+                std::array<const T *, N> w;
+                const T *corner_table = table;
+                for (size_t d = 0; d < N; d++) {
+                    size_t bit = (corner >> d) & 1;
+                    w[d]       = weights[d][bit];
+                    corner_table += bit * strides_[d];
+                }
+
+                for (size_t k = 0; k < length; k++) {
+                    T weight = w[0][k];
+                    for (size_t d = 1; d < N; d++) {
+                        weight *= w[d][k];
+                    }
+                    out[k] += weight * corner_table[offset[k]];
+                }
+            }
+        }
+    }
+
+    const Breakpoints<T> &GetBreakpoints(size_t dimension) const
+    {
+        return breakpoints_.at(dimension);
+    }
+
+    const std::vector<T> &GetTable() const
+    {
+        return table_;
+    }
+
+    Interpolation GetInterpolation() const
+    {
+        return interpolation_;
+    }
+
+private:
+    static std::array<Breakpoints<T>, N> MakeBreakpoints(const std::vector<std::vector<T>> &points)
+    {
+        assert(points.size() == N); // 断点的维数必须与模板参数一致
+
+        std::array<Breakpoints<T>, N> breakpoints;
+        for (size_t d = 0; d < N; d++) {
+            breakpoints[d] = Breakpoints<T>(points[d]);
+        }
+        return breakpoints;
+    }
+};
+
+/**
+ * @brief 二维查表
+ *
+ */
+template <typename T>
+using LookupTable2D = LookupTableND<T, 2>;
+
+namespace static_dispatch
+{
+
+/**
+ * @brief 一维查表，作为一个没有内部状态的控制器
+ *
+ * @tparam T 数据类型
+ */
+template <typename T>
+class LookupTable1D : public StaticControllerBase<LookupTable1D<T>, T>
+{
+private:
+    Breakpoints<T> breakpoints_;
+    std::vector<T> table_;
+    Interpolation interpolation_;
+
+public:
+    /**
+     * @brief 创建一维查表
+     *
+     * @param breakpoints 断点，至少两个，必须严格递增
+     * @param table 断点处的值，长度与断点相同
+     * @param interpolation 插值方法
+     */
+    LookupTable1D(const Breakpoints<T> &breakpoints, const std::vector<T> &table,
+                  Interpolation interpolation = Interpolation::Linear)
+        : breakpoints_{breakpoints}, table_{table}, interpolation_{interpolation}
+    {
+        assert(table_.size() == breakpoints_.Size());
+    }
+
+    LookupTable1D(const std::vector<T> &breakpoints, const std::vector<T> &table,
+                  Interpolation interpolation = Interpolation::Linear)
+        : LookupTable1D(Breakpoints<T>(breakpoints), table, interpolation) {}
+
+    /**
+     * @brief 查表
+     *
+     * @param input 输入
+     * @return T 输出
+     */
+    T Step(T input)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("LookupTable1D::Step");
+        T fraction;
+        size_t i = breakpoints_.Locate(input, fraction);
+
+        if (interpolation_ == Interpolation::Nearest) {
+            return table_[i + (fraction >= T(0.5))];
+        }
+        return table_[i] + (table_[i + 1] - table_[i]) * fraction;
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        if (!breakpoints_.IsEvenlySpaced() || interpolation_ != Interpolation::Linear) {
+            for (size_t k = 0; k < n; k++) {
+                output[k] = Step(input[k]);
+            }
+            return;
+        }
+
+        // 等间距：与 Breakpoints::Locate() 的算法相同，但没有分支，各个查询点之间也没有依赖
+        const T *table    = table_.data();
+        const size_t last = table_.size() - 2;
+        const T first     = breakpoints_.GetPoints().front();
+        const T max       = breakpoints_.GetPoints().back();
+        const T scale     = breakpoints_.GetInverseStep();
+
+        for (size_t k = 0; k < n; k++) {
+            T x      = input[k];
+            x        = !(x >= first) ? first : x; // NaN 也取第一个断点
+            x        = x > max ? max : x;
+            T t      = (x - first) * scale;
+            size_t i = size_t(t);
+            i        = i > last ? last : i;
+            T f      = t - T(i);
+
+            output[k] = table[i] + (table[i + 1] - table[i]) * f;
+        }
+    }
+
+    void ResetState(){};
+
+    const Breakpoints<T> &GetBreakpoints() const
+    {
+        return breakpoints_;
+    }
+
+    const std::vector<T> &GetTable() const
+    {
+        return table_;
+    }
+};
+
+} // namespace static_dispatch
+
+/**
+ * @brief 一维查表（虚函数接口）
+ *
+ */
+template <typename T>
+class LookupTable1D : public DynamicController<static_dispatch::LookupTable1D<T>, LookupTable1D<T>>
+{
+public:
+    using DynamicController<static_dispatch::LookupTable1D<T>, LookupTable1D<T>>::DynamicController;
+};
+
+} // namespace control_system
@@ -0,0 +1,181 @@
+/**
+ * @file multirate_scheduler.hpp
+ * @author X. Y.
+ * @brief 多速率调度
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 把采样周期不同的任务按周期分组，每组的周期必须是基础周期的整数倍
+ * 每个基础周期调用一次 Tick()，只执行到了采样时刻的组：
+ * - 先锁存所有到了采样时刻的组的 RateTransition，再执行任何任务
+ *   这样慢 -> 快的数据正好延迟一个慢周期（慢回路第 0 拍写入，快回路第 N 拍读到），快 -> 慢为零阶保持
+ *   （慢回路看到的是快回路在上一拍写入的值）
+ * - 然后快的组先执行，慢的组后执行
+ * 例如电流环 10 kHz、速度环 1 kHz、位置环 100 Hz 的级联，基础周期为 0.1 ms，速度环每 10 次 Tick() 执行一次，位置环每 100 次执行一次
+ *
+ * Tick() 本身不计时，可以放在 PeriodicScheduler 中按基础周期调用
+ *
+ * 使用示例：
+ * control_system::MultiRateScheduler scheduler(1e-4);
+ * control_system::RateTransition<float> current_reference;
+ * scheduler.AddTask([&] { current_reference.Write(speed_pi.Step(speed_error)); }, 1e-3); // 1 kHz
+ * scheduler.AddRateTransition(current_reference, 1e-3);                                  // 在速度环的采样时刻锁存
+ * scheduler.AddTask([&] { voltage = current_pi.Step(current_reference.Read() - current); }, 1e-4);
+ * while (1) {
+ *     scheduler.Tick();
+ * }
+ *
+ */
+
+#pragma once
+
+#include "rate_transition.hpp"
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace control_system
+{
+
+class MultiRateScheduler
+{
+private:
+    struct Group {
+        double period;
+        uint64_t divisor; // 周期 / 基础周期
+        std::vector<std::function<void()>> transitions;
+        std::vector<std::function<void()>> tasks;
+    };
+
+    double base_period_;
+    std::vector<Group> groups_; // 按周期从小到大排列
+    uint64_t tick_ = 0;
+
+    /**
+     * @brief 找到周期为 period 的组，没有就新建一个
+     *
+     */
+    Group &GetGroup(double period)
+    {
+        double ratio = period / base_period_;
+        auto divisor = uint64_t(std::llround(ratio));
+        assert(divisor >= 1);
+        assert(std::abs(ratio - divisor) < 1e-6 * ratio); // 周期必须是基础周期的整数倍
+
+        auto it = std::lower_bound(groups_.begin(), groups_.end(), divisor,
+                                   [](const Group &group, uint64_t d) { return group.divisor < d; });
+        if (it == groups_.end() || it->divisor != divisor) {
+            it = groups_.insert(it, Group{divisor * base_period_, divisor, {}, {}});
+        }
+        return *it;
+    }
+
+public:
+    /**
+     * @brief 创建多速率调度器
+     *
+     * @param base_period 基础周期（秒），即调用 Tick() 的周期，通常为最快的采样周期
+     */
+    explicit MultiRateScheduler(double base_period)
+        : base_period_{base_period}
+    {
+        assert(base_period > 0);
+    }
+
+    /**
+     * @brief 添加一个任务
+     *
+     * @param task 每个采样周期执行一次
+     * @param period 采样周期（秒），必须是基础周期的整数倍
+     */
+    void AddTask(std::function<void()> task, double period)
+    {
+        GetGroup(period).tasks.push_back(std::move(task));
+    }
+
+    /**
+     * @brief 添加一个控制器，每个采样周期执行 *output = controller.Step(*input)
+     * @note controller、input、output 的生命周期由调用者保证
+     */
+    template <typename Controller, typename T>
+    void AddController(Controller &controller, const T *input, T *output, double period)
+    {
+        AddTask([&controller, input, output] { *output = controller.Step(*input); }, period);
+    }
+
+    /**
+     * @brief 在周期为 period 的组的每个采样时刻锁存 transition，锁存在这一拍所有任务之前
+     * @note 快 -> 慢时 period 取慢的周期（零阶保持），慢 -> 快时也取慢的周期（延迟一个慢周期）
+     */
+    template <typename T>
+    void AddRateTransition(RateTransition<T> &transition, double period)
+    {
+        GetGroup(period).transitions.push_back([&transition] { transition.Update(); });
+    }
+
+    /**
+     * @brief 走一个基础周期
+     *
+     */
+    void Tick()
+    {
+        // 先锁存，快的组就不会在慢的组锁存之前读到上一个慢周期的值
+        for (auto &group : groups_) {
+            if (tick_ % group.divisor != 0) continue;
+
+            for (auto &update : group.transitions) {
+                update();
+            }
+        }
+
+        for (auto &group : groups_) {
+            if (tick_ % group.divisor != 0) continue;
+
+            for (auto &task : group.tasks) {
+                task();
+            }
+        }
+        tick_++;
+    }
+
+    /**
+     * @brief 回到第 0 个基础周期（所有组都在下一次 Tick() 执行）
+     *
+     */
+    void ResetTick()
+    {
+        tick_ = 0;
+    }
+
+    uint64_t GetTick() const
+    {
+        return tick_;
+    }
+
+    double GetBasePeriod() const
+    {
+        return base_period_;
+    }
+
+    size_t GroupCount() const
+    {
+        return groups_.size();
+    }
+
+    /**
+     * @brief 第 i 组（按周期从小到大）的周期
+     *
+     */
+    double GetGroupPeriod(size_t i) const
+    {
+        return groups_.at(i).period;
+    }
+};
+
+} // namespace control_system
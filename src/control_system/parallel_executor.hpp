@@ -0,0 +1,309 @@
+/**
+ * @file parallel_executor.hpp
+ * @author X. Y.
+ * @brief 多线程执行大量互相独立的控制器
+ * @version 0.1
+ * @date 2023-08-08
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 每个周期调用一次 RunTick()，所有任务（例如每个控制器的一次 Step()，或一个 ZTfBank 的一次 Step()）执行完才返回：
+ * - 任务按顺序分成若干段（chunk），各线程分到连续的若干段
+ * - 每个线程先从自己那部分的前端取，做完后从其他线程那部分的末端偷（work-stealing），任务耗时不均匀时也能分摊
+ * - 每个线程的数据按缓存行对齐，避免伪共享
+ * - 调用 RunTick() 的线程也是 0 号工作线程，其余线程在周期之间先自旋等待一会儿，再睡眠
+ * - Linux 下可以把工作线程绑定到各个 CPU 上
+ *
+ * 任务在 RunTick() 之外添加，同一个周期内任务之间不能有数据依赖
+ *
+ * 使用示例：
+ * control_system::ParallelExecutor executor(4);
+ * for (size_t i = 0; i < controllers.size(); i++) {
+ *     executor.AddController(controllers[i], &inputs[i], &outputs[i]);
+ * }
+ * while (1) {
+ *     executor.RunTick();
+ * }
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace control_system
+{
+
+class ParallelExecutor
+{
+public:
+    static constexpr size_t kCacheLineSize = 64;
+
+    /**
+     * @brief 每个线程的统计信息
+     *
+     */
+    struct WorkerStats {
+        uint64_t executed_chunks = 0; // 执行的段数（含偷来的）
+        uint64_t stolen_chunks   = 0; // 从其他线程偷来的段数
+    };
+
+private:
+    struct alignas(kCacheLineSize) Worker {
+        // 剩余的段 [begin, end)，高 32 位为 begin，低 32 位为 end
+        // 自己从前端取，其他线程从末端偷，都用 CAS 修改同一个字
+        std::atomic<uint64_t> range{0};
+        WorkerStats stats;
+        std::thread thread;
+    };
+
+    std::vector<std::function<void()>> tasks_;
+    size_t chunk_size_;
+    size_t chunk_count_ = 0;
+
+    std::vector<Worker> workers_;
+
+    // 周期同步
+    alignas(kCacheLineSize) std::atomic<uint64_t> epoch_{0};
+    alignas(kCacheLineSize) std::atomic<size_t> pending_{0};
+    std::atomic<bool> stop_{false};
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    size_t spin_limit_;
+
+    static uint64_t Pack(uint32_t begin, uint32_t end)
+    {
+        return (uint64_t(begin) << 32) | end;
+    }
+
+    static bool PopFront(std::atomic<uint64_t> &range, uint32_t &chunk)
+    {
+        auto value = range.load(std::memory_order_relaxed);
+        while (true) {
+            uint32_t begin = value >> 32, end = uint32_t(value);
+            if (begin >= end) return false;
+            if (range.compare_exchange_weak(value, Pack(begin + 1, end), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                chunk = begin;
+                return true;
+            }
+        }
+    }
+
+    static bool PopBack(std::atomic<uint64_t> &range, uint32_t &chunk)
+    {
+        auto value = range.load(std::memory_order_relaxed);
+        while (true) {
+            uint32_t begin = value >> 32, end = uint32_t(value);
+            if (begin >= end) return false;
+            if (range.compare_exchange_weak(value, Pack(begin, end - 1), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                chunk = end - 1;
+                return true;
+            }
+        }
+    }
+
+    void RunChunk(uint32_t chunk)
+    {
+        size_t begin = size_t(chunk) * chunk_size_;
+        size_t end   = std::min(begin + chunk_size_, tasks_.size());
+        for (size_t i = begin; i < end; i++) {
+            tasks_[i]();
+        }
+    }
+
+    void Work(size_t id)
+    {
+        auto &self = workers_[id];
+        uint32_t chunk;
+
+        while (PopFront(self.range, chunk)) {
+            RunChunk(chunk);
+            self.stats.executed_chunks++;
+        }
+
+        // 自己的做完了，依次去其他线程的末端偷
+        const size_t count = workers_.size();
+        for (size_t k = 1; k < count; k++) {
+            auto &victim = workers_[(id + k) % count];
+            while (PopBack(victim.range, chunk)) {
+                RunChunk(chunk);
+                self.stats.executed_chunks++;
+                self.stats.stolen_chunks++;
+            }
+        }
+    }
+
+    void WorkerLoop(size_t id)
+    {
+        uint64_t seen = 0;
+
+        while (true) {
+            // 先自旋等待下一个周期，等不到再睡眠
+            size_t spin = 0;
+            while (epoch_.load(std::memory_order_acquire) == seen && spin < spin_limit_) {
+                spin++;
+                std::this_thread::yield(); // 线程数多于 CPU 数时让出时间片
+            }
+            if (epoch_.load(std::memory_order_acquire) == seen) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [&] { return epoch_.load(std::memory_order_acquire) != seen; });
+            }
+            seen = epoch_.load(std::memory_order_acquire);
+
+            if (stop_.load(std::memory_order_acquire)) return;
+
+            Work(id);
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    void Partition()
+    {
+        chunk_count_ = (tasks_.size() + chunk_size_ - 1) / chunk_size_;
+        assert(chunk_count_ <= UINT32_MAX);
+
+        // 每个线程分到连续的一段
+        const size_t count = workers_.size();
+        for (size_t i = 0; i < count; i++) {
+            auto begin = chunk_count_ * i / count;
+            auto end   = chunk_count_ * (i + 1) / count;
+            workers_[i].range.store(Pack(begin, end), std::memory_order_relaxed);
+        }
+    }
+
+    static void PinThread(std::thread &thread, size_t cpu)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu % CPU_SETSIZE, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)cpu;
+#endif
+    }
+
+public:
+    /**
+     * @brief 创建线程池
+     *
+     * @param threads 线程数（包括调用 RunTick() 的线程），至少为 1
+     * @param chunk_size 每段的任务数，任务很轻时取大一些可以减少同步开销
+     * @param pin_threads 是否把第 i 个工作线程绑定到第 i 个 CPU 上（只在 Linux 下有效，调用 RunTick() 的线程不绑定）
+     * @param spin_limit 周期之间自旋等待的次数，超过后睡眠
+     */
+    explicit ParallelExecutor(size_t threads, size_t chunk_size = 64, bool pin_threads = false, size_t spin_limit = 10000)
+        : chunk_size_{std::max<size_t>(chunk_size, 1)}, workers_(std::max<size_t>(threads, 1)), spin_limit_{spin_limit}
+    {
+        for (size_t i = 1; i < workers_.size(); i++) {
+            workers_[i].thread = std::thread(&ParallelExecutor::WorkerLoop, this, i);
+            if (pin_threads) PinThread(workers_[i].thread, i);
+        }
+    }
+
+    ParallelExecutor(const ParallelExecutor &)            = delete;
+    ParallelExecutor &operator=(const ParallelExecutor &) = delete;
+
+    ~ParallelExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_.store(true, std::memory_order_release);
+            epoch_.fetch_add(1, std::memory_order_acq_rel);
+        }
+        condition_.notify_all();
+
+        for (size_t i = 1; i < workers_.size(); i++) {
+            workers_[i].thread.join();
+        }
+    }
+
+    /**
+     * @brief 添加一个每个周期执行一次的任务
+     *
+     */
+    void AddTask(std::function<void()> task)
+    {
+        tasks_.push_back(std::move(task));
+    }
+
+    /**
+     * @brief 添加一个控制器，每个周期执行 *output = controller.Step(*input)
+     * @note controller、input、output 的生命周期由调用者保证
+     */
+    template <typename Controller, typename T>
+    void AddController(Controller &controller, const T *input, T *output)
+    {
+        AddTask([&controller, input, output] { *output = controller.Step(*input); });
+    }
+
+    /**
+     * @brief 执行一个周期的所有任务，全部完成后返回
+     *
+     */
+    void RunTick()
+    {
+        // 上一个周期结束时所有范围都已取空，每个周期重新分配（只与线程数有关，开销很小）
+        Partition();
+
+        pending_.store(workers_.size() - 1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            epoch_.fetch_add(1, std::memory_order_acq_rel);
+        }
+        condition_.notify_all();
+
+        Work(0);
+
+        while (pending_.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    size_t ThreadCount() const
+    {
+        return workers_.size();
+    }
+
+    size_t TaskCount() const
+    {
+        return tasks_.size();
+    }
+
+    /**
+     * @brief 各线程的统计信息，只能在 RunTick() 之外调用
+     *
+     */
+    std::vector<WorkerStats> GetStats() const
+    {
+        std::vector<WorkerStats> stats;
+        for (const auto &worker : workers_) {
+            stats.push_back(worker.stats);
+        }
+        return stats;
+    }
+
+    void ResetStats()
+    {
+        for (auto &worker : workers_) {
+            worker.stats = WorkerStats{};
+        }
+    }
+};
+
+} // namespace control_system
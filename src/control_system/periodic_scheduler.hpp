@@ -0,0 +1,321 @@
+/**
+ * @file periodic_scheduler.hpp
+ * @author X. Y.
+ * @brief 周期任务调度器
+ * @version 0.1
+ * @date 2023-08-10
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 按固定周期调用控制器的 Step()，代替 “Step(); sleep_ms(10);” 这样的循环：
+ * - 按绝对时间睡眠到下一次释放时刻（Linux 下为 clock_nanosleep + TIMER_ABSTIME），周期误差不会累积
+ * - 可以指定在释放时刻前提前醒来，剩下的一小段时间忙等，进一步减小唤醒延迟
+ * - 统计每个任务的启动延迟（实际开始时刻 - 释放时刻）分布、执行时间分布、最坏执行时间、错过截止时间的次数
+ *   每次执行只多两次读时钟和两次直方图计数，开销很小
+ *
+ * 截止时间等于下一次释放时刻。执行超时导致错过了后面的释放时刻时，这些释放被跳过（计入 skipped_releases），不会连续补跑
+ * 时间都以 std::chrono::steady_clock 为准，Linux 下与 CLOCK_MONOTONIC 相同
+ *
+ * 使用示例：
+ * control_system::pid::PID<float> pid_controller{1.23, 0.54, 0, 1000, 0.01};
+ * control_system::PeriodicScheduler scheduler(50e-6); // 最后 50 us 忙等
+ * auto id = scheduler.AddTask([&] { output = pid_controller.Step(input); }, 0.01); // 周期 0.01 s
+ * scheduler.Run(10); // 运行 10 s，也可以在其他线程中调用 Stop() 结束
+ * auto stats = scheduler.GetStats(id);
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __linux__
+#include <time.h>
+#include <errno.h>
+#endif
+
+namespace control_system
+{
+
+/**
+ * @brief 以 2 的幂为分界的纳秒直方图：第 0 个桶为 0 ns，第 i 个桶为 [2^(i-1), 2^i) ns
+ *
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr size_t kBucketCount = 64;
+
+private:
+    std::array<uint64_t, kBucketCount> buckets_{};
+    uint64_t count_ = 0;
+    int64_t sum_    = 0;
+    int64_t min_    = INT64_MAX;
+    int64_t max_    = 0;
+
+    static size_t BucketOf(uint64_t ns)
+    {
+        if (ns == 0) return 0;
+#if defined(__GNUC__) || defined(__clang__)
+        return 64 - __builtin_clzll(ns);
+#else
+        size_t bucket = 0;
+        while (ns != 0) {
+            ns >>= 1;
+            bucket++;
+        }
+        return bucket;
+#endif
+    }
+
+public:
+    /**
+     * @brief 记录一个值（单位 ns，负数按 0 计）
+     *
+     */
+    void Record(int64_t ns)
+    {
+        if (ns < 0) ns = 0;
+
+        buckets_[std::min(BucketOf(ns), kBucketCount - 1)]++;
+        count_++;
+        sum_ += ns;
+        min_ = std::min(min_, ns);
+        max_ = std::max(max_, ns);
+    }
+
+    void Reset()
+    {
+        *this = LatencyHistogram{};
+    }
+
+    uint64_t Count() const
+    {
+        return count_;
+    }
+
+    int64_t Min() const
+    {
+        return count_ == 0 ? 0 : min_;
+    }
+
+    int64_t Max() const
+    {
+        return max_;
+    }
+
+    double Mean() const
+    {
+        return count_ == 0 ? 0 : double(sum_) / count_;
+    }
+
+    /**
+     * @brief 百分位数的上界，例如 Percentile(0.99) 表示 99% 的值都小于返回值
+     *
+     */
+    int64_t Percentile(double p) const
+    {
+        if (count_ == 0) return 0;
+
+        auto target     = uint64_t(p * count_);
+        uint64_t amount = 0;
+        for (size_t i = 0; i < kBucketCount; i++) {
+            amount += buckets_[i];
+            if (amount > target) return std::min<int64_t>(i == 0 ? 0 : (int64_t(1) << i) - 1, max_);
+        }
+        return max_;
+    }
+
+    const std::array<uint64_t, kBucketCount> &Buckets() const
+    {
+        return buckets_;
+    }
+};
+
+/**
+ * @brief 一个周期任务的统计信息
+ *
+ */
+struct TaskStats {
+    uint64_t releases         = 0; // 执行次数
+    uint64_t missed_deadlines = 0; // 执行结束时已超过截止时间的次数
+    uint64_t skipped_releases = 0; // 因为超时而跳过的释放次数
+    LatencyHistogram latency;      // 启动延迟：实际开始时刻 - 释放时刻
+    LatencyHistogram execution;    // 执行时间，其最大值即最坏执行时间（WCET）
+
+    /**
+     * @brief 抖动：启动延迟的最大值与最小值之差（ns）
+     *
+     */
+    int64_t Jitter() const
+    {
+        return latency.Max() - latency.Min();
+    }
+
+    int64_t WorstCaseExecutionTime() const
+    {
+        return execution.Max();
+    }
+};
+
+class PeriodicScheduler
+{
+private:
+    struct Task {
+        std::function<void()> function;
+        int64_t period;       // ns
+        int64_t offset;       // 第一次释放相对于开始时刻的偏移，ns
+        int64_t next_release; // 绝对时间，ns
+        TaskStats stats;
+    };
+
+    std::vector<Task> tasks_;
+    int64_t spin_tail_;
+    std::atomic<bool> stop_{false};
+
+    static int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t ToNanoseconds(double seconds)
+    {
+        return int64_t(seconds * 1e9 + 0.5);
+    }
+
+    static void SleepUntilNs(int64_t deadline)
+    {
+#ifdef __linux__
+        timespec ts;
+        ts.tv_sec  = deadline / 1000000000;
+        ts.tv_nsec = deadline % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+#else
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+#endif
+    }
+
+    /**
+     * @brief 睡眠到 deadline - spin_tail_，剩下的时间忙等
+     *
+     */
+    void SleepUntil(int64_t deadline) const
+    {
+        if (deadline - spin_tail_ > Now()) {
+            SleepUntilNs(deadline - spin_tail_);
+        }
+        while (Now() < deadline) {
+        }
+    }
+
+public:
+    /**
+     * @brief 创建调度器
+     *
+     * @param spin_tail 在释放时刻前多久醒来改为忙等（秒），0 表示不忙等
+     */
+    explicit PeriodicScheduler(double spin_tail = 0)
+        : spin_tail_{ToNanoseconds(spin_tail)} {};
+
+    /**
+     * @brief 添加一个周期任务
+     *
+     * @param function 每个周期调用一次
+     * @param period 周期（秒），例如控制器的 Ts
+     * @param offset 第一次释放相对于 Run() 开始时刻的偏移（秒）
+     * @return 任务编号
+     * @note 多个任务同时到期时按添加的顺序执行，因此应该先添加周期短的任务
+     */
+    size_t AddTask(std::function<void()> function, double period, double offset = 0)
+    {
+        assert(period > 0);
+        tasks_.push_back({std::move(function), ToNanoseconds(period), ToNanoseconds(offset), 0, TaskStats{}});
+        return tasks_.size() - 1;
+    }
+
+    /**
+     * @brief 在当前线程中运行所有任务
+     *
+     * @param duration 运行时间（秒），小于等于 0 时一直运行到 Stop() 被调用
+     */
+    void Run(double duration = 0)
+    {
+        if (tasks_.empty()) return;
+
+        stop_.store(false, std::memory_order_relaxed);
+
+        const int64_t start = Now();
+        const int64_t end   = duration > 0 ? start + ToNanoseconds(duration) : INT64_MAX;
+        for (auto &task : tasks_) {
+            task.next_release = start + task.offset;
+        }
+
+        while (!stop_.load(std::memory_order_relaxed)) {
+            // 下一个到期的任务
+            auto task = std::min_element(tasks_.begin(), tasks_.end(),
+                                         [](const Task &a, const Task &b) { return a.next_release < b.next_release; });
+
+            const int64_t release = task->next_release;
+            if (release >= end) break;
+
+            SleepUntil(release);
+
+            const int64_t begin = Now();
+            task->function();
+            const int64_t finish = Now();
+
+            auto &stats = task->stats;
+            stats.releases++;
+            stats.latency.Record(begin - release);
+            stats.execution.Record(finish - begin);
+
+            task->next_release = release + task->period;
+            if (finish > task->next_release) {
+                stats.missed_deadlines++;
+
+                // 跳过已经错过的释放时刻，保持原来的相位
+                int64_t skipped = (finish - task->next_release) / task->period + 1;
+                stats.skipped_releases += skipped;
+                task->next_release += skipped * task->period;
+            }
+        }
+    }
+
+    /**
+     * @brief 让 Run() 在当前任务执行完后返回，可以在其他线程或任务中调用
+     *
+     */
+    void Stop()
+    {
+        stop_.store(true, std::memory_order_relaxed);
+    }
+
+    const TaskStats &GetStats(size_t id) const
+    {
+        return tasks_.at(id).stats;
+    }
+
+    void ResetStats()
+    {
+        for (auto &task : tasks_) {
+            task.stats = TaskStats{};
+        }
+    }
+
+    size_t TaskCount() const
+    {
+        return tasks_.size();
+    }
+};
+
+} // namespace control_system
@@ -0,0 +1,406 @@
+/**
+ * @file pid_bank.hpp
+ * @author X. Y.
+ * @brief 多通道 PID 控制器
+ * @version 0.1
+ * @date 2023-07-25
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 同时运行大量相互独立、参数各不相同的 PID 控制器（例如一个周期内计算几千路电机的电流环）
+ * 每个通道的参数、预先算好的系数、内部状态和限幅值都按“结构数组”存放，
+ * 每个周期对所有通道做同样的运算，限幅也写成无分支的形式，编译器可以直接生成 SSE/AVX 指令
+ *
+ * PIDBank 的每个通道与 pid::PID<T>（带积分限幅）的运算结果逐位相同
+ * PIDBank_AntiWindup 的每个通道与 pid::PID_AntiWindup<T> 的运算结果逐位相同
+ * 把 Kd 设为 0 即得到对应的 PI 控制器（微分项恒为 0，结果同样逐位相同）
+ * 注：若编译器把乘加合并为 FMA 指令（如 -march=native），合并的位置可能不同，结果只在舍入误差范围内相同
+ *
+ * 使用示例:
+ *   pid::PIDBank<float> bank(1000);                  // 1000 个通道
+ *   bank.SetParam(0, 1.23, 0.54, 0, 1000, 0.01);    // 设置第 0 个通道的参数
+ *   bank.SetIntegratorMinMax(0, -1, 1);             // 设置第 0 个通道的积分限幅
+ *   bank.Step(input, output);                       // 所有通道走一个周期
+ *
+ */
+
+#pragma once
+
+#include "compiler.hpp"
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <cstddef>
+
+namespace control_system
+{
+
+namespace pid
+{
+
+namespace detail
+{
+
+/**
+ * @brief 与 Saturation::operator() 结果相同的无分支限幅
+ *
+ */
+template <typename T>
+inline T Clamp(T value, T min, T max)
+{
+    T result = value < min ? min : value;
+    return value > max ? max : result;
+}
+
+/**
+ * @brief 多通道微分器的参数、系数和状态（与 pid::D 的算法相同）
+ *
+ */
+template <typename T>
+struct DBankLanes {
+    std::vector<T> Kd, Kn, Ts;
+    std::vector<T> input_coefficient, output_coefficient;
+    std::vector<T> last_input, last_output;
+
+    void Resize(size_t lanes)
+    {
+        Kd.resize(lanes, 0);
+        Kn.resize(lanes, 0);
+        Ts.resize(lanes, 0);
+        input_coefficient.resize(lanes, 0);
+        output_coefficient.resize(lanes, 0);
+        last_input.resize(lanes, 0);
+        last_output.resize(lanes, 0);
+    }
+
+    void SetParam(size_t lane, T Kd, T Kn, T Ts)
+    {
+        this->Kd[lane] = Kd;
+        this->Kn[lane] = Kn;
+        this->Ts[lane] = Ts;
+
+        // 与 D::UpdateCoefficient() 相同
+        auto den                 = 2 + Kn * Ts;
+        input_coefficient[lane]  = (2 * Kd * Kn) / den;
+        output_coefficient[lane] = (2 - Kn * Ts) / den;
+    }
+
+    void ResetState(size_t lane)
+    {
+        last_input[lane]  = 0;
+        last_output[lane] = 0;
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief 多通道 PID 控制器，每个通道都等价于一个 pid::PID<T>（带积分限幅）
+ *
+ * @tparam T 运算数据类型
+ */
+template <typename T>
+class PIDBank
+{
+private:
+    size_t lanes_ = 0;
+
+    std::vector<T> Kp_, Ki_, Ts_;
+    std::vector<T> i_coefficient_; // 积分器系数 Ki * Ts / 2
+    std::vector<T> i_state_;       // 积分器状态
+    std::vector<T> i_min_, i_max_; // 积分限幅
+
+    detail::DBankLanes<T> d_;
+
+    // 各数组互不重叠（只有 input 和 output 可能是同一个数组），写成参数编译器才能放心地向量化
+    static void Kernel(size_t lanes, const T *input, T *output,
+                       const T *CONTROL_SYSTEM_RESTRICT kp, const T *CONTROL_SYSTEM_RESTRICT ic,
+                       const T *CONTROL_SYSTEM_RESTRICT i_min, const T *CONTROL_SYSTEM_RESTRICT i_max,
+                       const T *CONTROL_SYSTEM_RESTRICT dci, const T *CONTROL_SYSTEM_RESTRICT dco,
+                       T *CONTROL_SYSTEM_RESTRICT x, T *CONTROL_SYSTEM_RESTRICT last_input, T *CONTROL_SYSTEM_RESTRICT last_output)
+    {
+        for (size_t k = 0; k < lanes; k++) {
+            auto e = input[k];
+
+            // 积分器，与 DiscreteIntegratorSaturation::Step() 相同
+            auto temp = ic[k] * e;
+            auto i    = detail::Clamp(x[k] + temp, i_min[k], i_max[k]);
+            x[k]      = i + temp;
+
+            // 微分器，与 D::Step() 相同
+            auto d         = dci[k] * (e - last_input[k]) + dco[k] * last_output[k];
+            last_output[k] = d;
+            last_input[k]  = e;
+
+            output[k] = kp[k] * e + i + d;
+        }
+    }
+
+public:
+    PIDBank(){};
+
+    /**
+     * @brief 创建多通道 PID 控制器，所有参数为 0，积分器不限幅
+     *
+     * @param lanes 通道数
+     */
+    PIDBank(size_t lanes)
+    {
+        Resize(lanes);
+    }
+
+    /**
+     * @brief 改变通道数，原有通道的参数和状态保持不变，新通道的参数为 0
+     *
+     */
+    void Resize(size_t lanes)
+    {
+        lanes_ = lanes;
+        Kp_.resize(lanes, 0);
+        Ki_.resize(lanes, 0);
+        Ts_.resize(lanes, 0);
+        i_coefficient_.resize(lanes, 0);
+        i_state_.resize(lanes, 0);
+        i_min_.resize(lanes, std::numeric_limits<T>::lowest());
+        i_max_.resize(lanes, std::numeric_limits<T>::max());
+        d_.Resize(lanes);
+    }
+
+    /**
+     * @brief 设置某个通道的参数，含义与 pid::PID::SetParam() 相同
+     *
+     */
+    void SetParam(size_t lane, T Kp, T Ki, T Kd, T Kn, T Ts)
+    {
+        assert(lane < lanes_);
+        Kp_[lane]            = Kp;
+        Ki_[lane]            = Ki;
+        Ts_[lane]            = Ts;
+        i_coefficient_[lane] = Ki * Ts / 2; // 与 DiscreteIntegrator::UpdateCoefficient() 相同
+        d_.SetParam(lane, Kd, Kn, Ts);
+    }
+
+    /**
+     * @brief 设置某个通道的积分限幅
+     *
+     */
+    void SetIntegratorMinMax(size_t lane, T min, T max)
+    {
+        assert(lane < lanes_);
+        i_min_[lane] = min;
+        i_max_[lane] = max;
+    }
+
+    /**
+     * @brief 所有通道走一个采样周期
+     *
+     * @param input 各通道的输入，长度为 Lanes()
+     * @param output 各通道的输出，长度为 Lanes()，可以与 input 是同一个数组
+     */
+    void Step(const T *input, T *output)
+    {
+        Kernel(lanes_, input, output, Kp_.data(), i_coefficient_.data(), i_min_.data(), i_max_.data(),
+               d_.input_coefficient.data(), d_.output_coefficient.data(),
+               i_state_.data(), d_.last_input.data(), d_.last_output.data());
+    }
+
+    /**
+     * @brief 重置所有通道的内部状态
+     *
+     */
+    void ResetState()
+    {
+        for (size_t k = 0; k < lanes_; k++) {
+            ResetState(k);
+        }
+    }
+
+    /**
+     * @brief 重置某个通道的内部状态
+     *
+     */
+    void ResetState(size_t lane)
+    {
+        assert(lane < lanes_);
+        i_state_[lane] = 0;
+        d_.ResetState(lane);
+    }
+
+    size_t Lanes() const
+    {
+        return lanes_;
+    }
+
+    T GetKp(size_t lane) const
+    {
+        return Kp_[lane];
+    }
+
+    T GetKi(size_t lane) const
+    {
+        return Ki_[lane];
+    }
+
+    T GetKd(size_t lane) const
+    {
+        return d_.Kd[lane];
+    }
+
+    T GetKn(size_t lane) const
+    {
+        return d_.Kn[lane];
+    }
+
+    T GetTs(size_t lane) const
+    {
+        return Ts_[lane];
+    }
+};
+
+/**
+ * @brief 多通道抗饱和 PID 控制器，每个通道都等价于一个 pid::PID_AntiWindup<T>
+ *
+ * @tparam T 运算数据类型
+ */
+template <typename T>
+class PIDBank_AntiWindup
+{
+private:
+    size_t lanes_ = 0;
+
+    std::vector<T> Kp_, Ki_, Kb_, Ts_;
+    std::vector<T> i_coefficient_;       // 积分器系数 Ts / 2（积分器本身的增益为 1）
+    std::vector<T> i_state_;             // 积分器状态
+    std::vector<T> out_min_, out_max_;   // 输出限幅
+
+    detail::DBankLanes<T> d_;
+
+    // 各数组互不重叠（只有 input 和 output 可能是同一个数组），写成参数编译器才能放心地向量化
+    static void Kernel(size_t lanes, const T *input, T *output,
+                       const T *CONTROL_SYSTEM_RESTRICT kp, const T *CONTROL_SYSTEM_RESTRICT ki,
+                       const T *CONTROL_SYSTEM_RESTRICT kb, const T *CONTROL_SYSTEM_RESTRICT ic,
+                       const T *CONTROL_SYSTEM_RESTRICT out_min, const T *CONTROL_SYSTEM_RESTRICT out_max,
+                       const T *CONTROL_SYSTEM_RESTRICT dci, const T *CONTROL_SYSTEM_RESTRICT dco,
+                       T *CONTROL_SYSTEM_RESTRICT x, T *CONTROL_SYSTEM_RESTRICT last_input, T *CONTROL_SYSTEM_RESTRICT last_output)
+    {
+        for (size_t k = 0; k < lanes; k++) {
+            auto e = input[k];
+            auto p = kp[k] * e;
+
+            auto d         = dci[k] * (e - last_input[k]) + dco[k] * last_output[k];
+            last_output[k] = d;
+            last_input[k]  = e;
+
+            // 与 PID_AntiWindup::Step() 相同
+            auto preSat  = x[k] + p + d;
+            auto postSat = detail::Clamp(preSat, out_min[k], out_max[k]);
+
+            auto temp     = ic[k] * (e * ki[k] + (postSat - preSat) * kb[k]);
+            auto i_output = x[k] + temp;
+            x[k]          = i_output + temp;
+
+            output[k] = detail::Clamp(i_output + p + d, out_min[k], out_max[k]);
+        }
+    }
+
+public:
+    PIDBank_AntiWindup(){};
+
+    /**
+     * @brief 创建多通道抗饱和 PID 控制器，所有参数为 0，输出不限幅
+     *
+     * @param lanes 通道数
+     */
+    PIDBank_AntiWindup(size_t lanes)
+    {
+        Resize(lanes);
+    }
+
+    /**
+     * @brief 改变通道数，原有通道的参数和状态保持不变，新通道的参数为 0
+     *
+     */
+    void Resize(size_t lanes)
+    {
+        lanes_ = lanes;
+        Kp_.resize(lanes, 0);
+        Ki_.resize(lanes, 0);
+        Kb_.resize(lanes, 0);
+        Ts_.resize(lanes, 0);
+        i_coefficient_.resize(lanes, 0);
+        i_state_.resize(lanes, 0);
+        out_min_.resize(lanes, std::numeric_limits<T>::lowest());
+        out_max_.resize(lanes, std::numeric_limits<T>::max());
+        d_.Resize(lanes);
+    }
+
+    /**
+     * @brief 设置某个通道的参数，含义与 pid::PID_AntiWindup 的构造函数相同
+     *
+     * @param lane 通道序号
+     * @param Kp 比例系数
+     * @param Ki 积分系数
+     * @param Kd 微分系数，为 0 时等价于 pid::PI_AntiWindup
+     * @param Kn 滤波器系数
+     * @param Ts 采样周期（秒）
+     * @param Kb 反算系数
+     * @param output_min 输出饱和下限
+     * @param output_max 输出饱和上限
+     */
+    void SetParam(size_t lane, T Kp, T Ki, T Kd, T Kn, T Ts, T Kb, T output_min, T output_max)
+    {
+        assert(lane < lanes_);
+        Kp_[lane]            = Kp;
+        Ki_[lane]            = Ki;
+        Kb_[lane]            = Kb;
+        Ts_[lane]            = Ts;
+        i_coefficient_[lane] = 1 * Ts / 2; // 与 DiscreteIntegrator{1, Ts} 相同
+        out_min_[lane]       = output_min;
+        out_max_[lane]       = output_max;
+        d_.SetParam(lane, Kd, Kn, Ts);
+    }
+
+    /**
+     * @brief 所有通道走一个采样周期
+     *
+     * @param input 各通道的输入，长度为 Lanes()
+     * @param output 各通道的输出，长度为 Lanes()，可以与 input 是同一个数组
+     */
+    void Step(const T *input, T *output)
+    {
+        Kernel(lanes_, input, output, Kp_.data(), Ki_.data(), Kb_.data(), i_coefficient_.data(),
+               out_min_.data(), out_max_.data(), d_.input_coefficient.data(), d_.output_coefficient.data(),
+               i_state_.data(), d_.last_input.data(), d_.last_output.data());
+    }
+
+    /**
+     * @brief 重置所有通道的内部状态
+     *
+     */
+    void ResetState()
+    {
+        for (size_t k = 0; k < lanes_; k++) {
+            ResetState(k);
+        }
+    }
+
+    /**
+     * @brief 重置某个通道的内部状态
+     *
+     */
+    void ResetState(size_t lane)
+    {
+        assert(lane < lanes_);
+        i_state_[lane] = 0;
+        d_.ResetState(lane);
+    }
+
+    size_t Lanes() const
+    {
+        return lanes_;
+    }
+};
+
+} // namespace pid
+
+} // namespace control_system
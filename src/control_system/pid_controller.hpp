@@ -2,7 +2,7 @@
  * @file pid_controller.hpp
  * @author X. Y.
  * @brief PID 控制器
- * @version 0.4
+ * @version 0.7
  * @date 2023-07-05
  *
  * @copyright Copyright (c) 2023
@@ -38,15 +38,32 @@
  *         sleep_ms(10); // 因为 Ts = 0.01, 等待 10 ms
  *     }
  *
+ *   没有 FPU 的平台可以用定点数（fixed_point.hpp）作为 T，参数仍以 double 给出:
+ *     pid::PID<control_system::Q31> q31_controller{1.23, 0.54, 0, 1000, 0.01};
+ *
+ *   sleep_ms() 的误差会逐周期累积，更好的做法是用 PeriodicScheduler（periodic_scheduler.hpp）按绝对时间调度，并统计延迟和超时:
+ *     control_system::PeriodicScheduler scheduler;
+ *     scheduler.AddTask([&] { output_data = controller.Step(input_data); }, 0.01);
+ *     scheduler.Run();
+ *
+ *   在其他线程（例如调参界面）中修改参数时，不要直接调用 SetParam()，而是用 MakeCoefficients() 算好一组系数，
+ *   通过 CoefficientChannel（triple_buffer.hpp）发布，控制线程在采样周期开始时用 SetCoefficients() 整组替换:
+ *     control_system::CoefficientChannel<pid::PID<float>::Coefficients> channel{pid_controller.GetCoefficients()};
+ *     channel.Publish(pid::PID<float>::MakeCoefficients(1.5, 0.6, 0, 1000, 0.01, {-10, 10})); // 调参线程，最后是积分限幅
+ *     channel.Apply(pid_controller);                                              // 控制线程，每个周期调用一次
+ *     output_data = pid_controller.Step(input_data);
+ *
  */
 
 #pragma once
 
 #include "discrete_controller_base.hpp"
+#include "instrumentation.hpp"
 #include "z_tf.hpp"
 #include "discrete_integrator.hpp"
 #include "saturation.hpp"
 #include <array>
+#include <algorithm>
 
 namespace control_system
 {
@@ -54,14 +71,21 @@ namespace control_system
 namespace pid
 {
 
+namespace static_dispatch
+{
+
 template <typename T>
-class P : public DiscreteControllerBase<T>
+class P : public StaticControllerBase<P<T>, T>
 {
 private:
-    T Kp = 0;
+    CoefficientType<T> Kp{};
 
 public:
-    P(T Kp)
+    struct Coefficients {
+        CoefficientType<T> Kp;
+    };
+
+    P(ParamType<T> Kp)
     {
         SetParam(Kp);
     }
@@ -72,26 +96,50 @@ public:
      * @param input 输入
      * @return T 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
+        CONTROL_SYSTEM_PROBE_TIME("pid::P::Step");
         return Kp * input;
     }
 
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        auto kp = Kp;
+        for (size_t i = 0; i < n; i++) {
+            output[i] = kp * input[i];
+        }
+    }
+
     /**
      * @brief 设置参数
      *
      * @param Kp 比例项
      */
-    void SetParam(T Kp)
+    void SetParam(ParamType<T> Kp)
     {
-        this->Kp = Kp;
+        this->Kp = CoefficientType<T>(Kp);
     }
 
-    T GetKp() const
+    CoefficientType<T> GetKp() const
     {
         return Kp;
     }
 
+    static Coefficients MakeCoefficients(ParamType<T> Kp)
+    {
+        return {CoefficientType<T>(Kp)};
+    }
+
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        Kp = coefficients.Kp;
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {Kp};
+    }
+
     void ResetState(){};
 };
 
@@ -101,27 +149,35 @@ public:
  *
  */
 template <typename T>
-using I = DiscreteIntegratorSaturation<T>;
+using I = control_system::static_dispatch::DiscreteIntegratorSaturation<T>;
 
 template <typename T>
-class D : public DiscreteControllerBase<T>
+class D : public StaticControllerBase<D<T>, T>
 {
-private:
-    T Kd, Kn, Ts;
-    T input_coefficient_;
-    T output_coefficient_;
+protected:
+    ParamType<T> Kd, Kn, Ts;
+    CoefficientType<T> input_coefficient_;
+    CoefficientType<T> output_coefficient_;
     T last_input_;
-    T last_output_;
+    StateType<T> last_output_; // 定点数时比信号宽，见 NumericTraits
 
     void UpdateCoefficient()
     {
-        auto den            = 2 + Kn * Ts;
-        input_coefficient_  = (2 * Kd * Kn) / den;
-        output_coefficient_ = (2 - Kn * Ts) / den;
+        SetCoefficients(MakeCoefficients(Kd, Kn, Ts));
     }
 
 public:
-    D(T Kd, T Kn, T Ts)
+    /**
+     * @brief 一组完整的参数，包括由参数算出的系数
+     *
+     */
+    struct Coefficients {
+        ParamType<T> Kd, Kn, Ts;
+        CoefficientType<T> input_coefficient;
+        CoefficientType<T> output_coefficient;
+    };
+
+    D(ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts)
     {
         ResetState();
         SetParam(Kd, Kn, Ts);
@@ -133,14 +189,61 @@ public:
      * @param input 输入
      * @return T 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
-        last_output_ = input_coefficient_ * (input - last_input_) + output_coefficient_ * last_output_;
+        CONTROL_SYSTEM_PROBE_TIME("pid::D::Step");
+        last_output_ = input_coefficient_ * StateType<T>(input - last_input_) + output_coefficient_ * last_output_;
         last_input_  = input;
+        return T(last_output_);
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        auto ci          = input_coefficient_;
+        auto co          = output_coefficient_;
+        auto last_input  = last_input_;
+        auto last_output = last_output_;
+
+        for (size_t i = 0; i < n; i++) {
+            auto in     = input[i];
+            last_output = ci * StateType<T>(in - last_input) + co * last_output;
+            last_input  = in;
+            output[i]   = T(last_output);
+        }
+
+        last_input_  = last_input;
+        last_output_ = last_output;
+    }
+
+    CoefficientType<T> GetInputCoefficient() const
+    {
+        return input_coefficient_;
+    }
+
+    CoefficientType<T> GetOutputCoefficient() const
+    {
+        return output_coefficient_;
+    }
+
+    /**
+     * @brief 上一步的输入（内部状态）
+     *
+     */
+    T GetLastInput() const
+    {
+        return last_input_;
+    }
+
+    /**
+     * @brief 上一步的输出（内部状态）
+     *
+     */
+    StateType<T> GetLastOutput() const
+    {
         return last_output_;
     }
 
-    void SetParam(T Kd, T Kn, T Ts)
+    void SetParam(ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts)
     {
         this->Kd = Kd;
         this->Kn = Kn;
@@ -148,28 +251,56 @@ public:
         UpdateCoefficient();
     }
 
-    void SetParam(T Kd, T Kn)
+    void SetParam(ParamType<T> Kd, ParamType<T> Kn)
     {
         this->Kd = Kd;
         this->Kn = Kn;
         UpdateCoefficient();
     }
 
-    T GetKd() const
+    ParamType<T> GetKd() const
     {
         return Kd;
     }
 
-    T GetKn() const
+    ParamType<T> GetKn() const
     {
         return Kn;
     }
 
-    T GetTs() const
+    ParamType<T> GetTs() const
     {
         return Ts;
     }
 
+    /**
+     * @brief 由参数算出一组系数，可以在其他线程中调用
+     *
+     */
+    static Coefficients MakeCoefficients(ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts)
+    {
+        auto den = 2 + Kn * Ts;
+        return {Kd, Kn, Ts, CoefficientType<T>((2 * Kd * Kn) / den), CoefficientType<T>((2 - Kn * Ts) / den)};
+    }
+
+    /**
+     * @brief 一次性替换所有系数，不做任何计算，内部状态保留
+     *
+     */
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        Kd                  = coefficients.Kd;
+        Kn                  = coefficients.Kn;
+        Ts                  = coefficients.Ts;
+        input_coefficient_  = coefficients.input_coefficient;
+        output_coefficient_ = coefficients.output_coefficient;
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {Kd, Kn, Ts, input_coefficient_, output_coefficient_};
+    }
+
     /**
      * @brief 重置控制器状态
      *
@@ -186,17 +317,31 @@ public:
  *
  * @tparam T 运算数据类型
  * @tparam IntegratorType 积分器类型，默认为带限幅的 DiscreteIntegratorSaturation<T>. 如果不需要限幅，可以指定为 DiscreteIntegrator<T>
+ * @tparam DType 微分器类型，默认为静态多态的 D<T>；虚函数接口的 pid::PID 中为 pid::D<T>
  * @note   例如：pid::PID<float, DiscreteIntegrator<float>> pid_controller{1.23, 0.54, 0.5, 100, 0.01};
  */
-template <typename T, typename IntegratorType = I<T>>
-class PID : public DiscreteControllerBase<T>
+template <typename T, typename IntegratorType = I<T>, typename DType = D<T>>
+class PID : public StaticControllerBase<PID<T, IntegratorType, DType>, T>
 {
+private:
+    using StaticControllerBase<PID<T, IntegratorType, DType>, T>::kBlockBufferSize;
+
 public:
-    T Kp; // 比例系数，可以直接修改
+    CoefficientType<T> Kp; // 比例系数，可以直接修改
     IntegratorType i_controller;
-    D<T> d_controller;
+    DType d_controller;
 
-    PID(T Kp, T Ki, T Kd, T Kn, T Ts)
+    /**
+     * @brief 一组完整的参数
+     * @note IntegratorType 为 DiscreteIntegratorSaturation 时 i 中也包括积分限幅值
+     */
+    struct Coefficients {
+        CoefficientType<T> Kp;
+        typename IntegratorType::Coefficients i;
+        typename DType::Coefficients d;
+    };
+
+    PID(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts)
         : Kp{Kp}, i_controller{Ki, Ts}, d_controller{Kd, Kn, Ts} {};
 
     /**
@@ -205,25 +350,78 @@ public:
      * @param input 输入
      * @return T 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
+        CONTROL_SYSTEM_PROBE_TIME("pid::PID::Step");
         return Kp * input + i_controller.Step(input) + d_controller.Step(input);
     }
 
-    void SetParam(T Kp, T Ki, T Kd, T Kn, T Ts)
+    void StepBlock(const T *input, T *output, size_t n)
     {
-        this->Kp = Kp;
+        T i_output[kBlockBufferSize];
+        T d_output[kBlockBufferSize];
+
+        for (size_t begin = 0; begin < n; begin += kBlockBufferSize) {
+            auto length = std::min(n - begin, kBlockBufferSize);
+
+            i_controller.StepBlock(input + begin, i_output, length);
+            d_controller.StepBlock(input + begin, d_output, length);
+
+            for (size_t i = 0; i < length; i++) {
+                output[begin + i] = Kp * input[begin + i] + i_output[i] + d_output[i];
+            }
+        }
+    }
+
+    void SetParam(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts)
+    {
+        this->Kp = CoefficientType<T>(Kp);
         i_controller.SetParam(Ki, Ts);
         d_controller.SetParam(Kd, Kn, Ts);
     }
 
-    void SetParam(T Kp, T Ki, T Kd, T Kn)
+    void SetParam(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Kd, ParamType<T> Kn)
     {
-        this->Kp = Kp;
+        this->Kp = CoefficientType<T>(Kp);
         i_controller.SetParam(Ki);
         d_controller.SetParam(Kd, Kn);
     }
 
+    /**
+     * @brief 由参数算出一组系数，可以在其他线程中调用
+     * @note 只适用于没有限幅的积分器（DiscreteIntegrator<T>）；默认的 I<T> 要用下面带积分限幅的版本，否则编译不通过
+     */
+    static Coefficients MakeCoefficients(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts)
+    {
+        return {CoefficientType<T>(Kp), IntegratorType::MakeCoefficients(Ki, Ts), DType::MakeCoefficients(Kd, Kn, Ts)};
+    }
+
+    /**
+     * @brief 由参数和积分限幅算出一组系数，可以在其他线程中调用
+     * @note SetCoefficients() 会整组替换积分限幅，不改变限幅时传入当前的 pid_controller.i_controller.saturation
+     */
+    static Coefficients MakeCoefficients(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts,
+                                         const Saturation<T, T> &i_saturation)
+    {
+        return {CoefficientType<T>(Kp), IntegratorType::MakeCoefficients(Ki, Ts, i_saturation), DType::MakeCoefficients(Kd, Kn, Ts)};
+    }
+
+    /**
+     * @brief 一次性替换所有系数，内部状态保留
+     *
+     */
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        Kp = coefficients.Kp;
+        i_controller.SetCoefficients(coefficients.i);
+        d_controller.SetCoefficients(coefficients.d);
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {Kp, i_controller.GetCoefficients(), d_controller.GetCoefficients()};
+    }
+
     /**
      * @brief 重置控制器状态
      *
@@ -243,13 +441,21 @@ public:
  * @note   例如：pid::PI<float, DiscreteIntegrator<float>> pi_controller{1.23, 0.54, 0.01};
  */
 template <typename T, typename IntegratorType = I<T>>
-class PI : public DiscreteControllerBase<T>
+class PI : public StaticControllerBase<PI<T, IntegratorType>, T>
 {
+private:
+    using StaticControllerBase<PI<T, IntegratorType>, T>::kBlockBufferSize;
+
 public:
-    T Kp; // 比例系数，可以直接修改
+    CoefficientType<T> Kp; // 比例系数，可以直接修改
     IntegratorType i_controller;
 
-    PI(T Kp, T Ki, T Ts)
+    struct Coefficients {
+        CoefficientType<T> Kp;
+        typename IntegratorType::Coefficients i;
+    };
+
+    PI(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Ts)
         : Kp{Kp}, i_controller{Ki, Ts} {};
 
     /**
@@ -258,11 +464,52 @@ public:
      * @param input 输入
      * @return T 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
+        CONTROL_SYSTEM_PROBE_TIME("pid::PI::Step");
         return Kp * input + i_controller.Step(input);
     }
 
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        T i_output[kBlockBufferSize];
+
+        for (size_t begin = 0; begin < n; begin += kBlockBufferSize) {
+            auto length = std::min(n - begin, kBlockBufferSize);
+
+            i_controller.StepBlock(input + begin, i_output, length);
+
+            for (size_t i = 0; i < length; i++) {
+                output[begin + i] = Kp * input[begin + i] + i_output[i];
+            }
+        }
+    }
+
+    /**
+     * @brief 由参数算出一组系数，与 PID::MakeCoefficients() 相同，默认的 I<T> 要给出积分限幅
+     *
+     */
+    static Coefficients MakeCoefficients(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Ts)
+    {
+        return {CoefficientType<T>(Kp), IntegratorType::MakeCoefficients(Ki, Ts)};
+    }
+
+    static Coefficients MakeCoefficients(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Ts, const Saturation<T, T> &i_saturation)
+    {
+        return {CoefficientType<T>(Kp), IntegratorType::MakeCoefficients(Ki, Ts, i_saturation)};
+    }
+
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        Kp = coefficients.Kp;
+        i_controller.SetCoefficients(coefficients.i);
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {Kp, i_controller.GetCoefficients()};
+    }
+
     /**
      * @brief 重置控制器状态
      *
@@ -273,14 +520,22 @@ public:
     }
 };
 
-template <typename T>
-class PD : public DiscreteControllerBase<T>
+template <typename T, typename DType = D<T>>
+class PD : public StaticControllerBase<PD<T, DType>, T>
 {
+private:
+    using StaticControllerBase<PD<T, DType>, T>::kBlockBufferSize;
+
 public:
-    T Kp; // 比例系数，可以直接修改
-    D<T> d_controller;
+    CoefficientType<T> Kp; // 比例系数，可以直接修改
+    DType d_controller;
+
+    struct Coefficients {
+        CoefficientType<T> Kp;
+        typename DType::Coefficients d;
+    };
 
-    PD(T Kp, T Kd, T Kn, T Ts)
+    PD(ParamType<T> Kp, ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts)
         : Kp{Kp}, d_controller{Kd, Kn, Ts} {};
 
     /**
@@ -289,11 +544,43 @@ public:
      * @param input 输入
      * @return T 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
+        CONTROL_SYSTEM_PROBE_TIME("pid::PD::Step");
         return Kp * input + d_controller.Step(input);
     }
 
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        T d_output[kBlockBufferSize];
+
+        for (size_t begin = 0; begin < n; begin += kBlockBufferSize) {
+            auto length = std::min(n - begin, kBlockBufferSize);
+
+            d_controller.StepBlock(input + begin, d_output, length);
+
+            for (size_t i = 0; i < length; i++) {
+                output[begin + i] = Kp * input[begin + i] + d_output[i];
+            }
+        }
+    }
+
+    static Coefficients MakeCoefficients(ParamType<T> Kp, ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts)
+    {
+        return {CoefficientType<T>(Kp), DType::MakeCoefficients(Kd, Kn, Ts)};
+    }
+
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        Kp = coefficients.Kp;
+        d_controller.SetCoefficients(coefficients.d);
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {Kp, d_controller.GetCoefficients()};
+    }
+
     /**
      * @brief 重置控制器状态
      *
@@ -304,18 +591,23 @@ public:
     }
 };
 
-template <typename T>
-class PID_AntiWindup : public DiscreteControllerBase<T>
+template <typename T, typename DType = D<T>>
+class PID_AntiWindup : public StaticControllerBase<PID_AntiWindup<T, DType>, T>
 {
+private:
+    using StaticControllerBase<PID_AntiWindup<T, DType>, T>::kBlockBufferSize;
+
 public:
-    T Kp; // 比例系数，可以直接修改
-    T Ki; // 积分系数，可以直接修改
-    T Kb; // 反算系数，可以直接修改
-    D<T> d_controller;
+    CoefficientType<T> Kp; // 比例系数，可以直接修改
+    CoefficientType<T> Ki; // 积分系数，可以直接修改
+    CoefficientType<T> Kb; // 反算系数，可以直接修改
+    DType d_controller;
     Saturation<T, T> output_saturation; // 输出限幅
 
 private:
-    DiscreteIntegrator<T> integrator;
+    control_system::static_dispatch::DiscreteIntegrator<T> integrator;
+
+    CONTROL_SYSTEM_PROBE_STREAK_MEMBER(output_saturated_); // 开启插桩时记录输出连续饱和的步数
 
 public:
     /**
@@ -330,30 +622,110 @@ public:
      * @param output_min 输出饱和下限
      * @param output_max 输出饱和上限
      */
-    PID_AntiWindup(T Kp, T Ki, T Kd, T Kn, T Ts, T Kb, T output_min, T output_max)
+    PID_AntiWindup(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts, ParamType<T> Kb,
+                   T output_min, T output_max)
         : Kp{Kp}, Ki{Ki}, Kb{Kb}, d_controller{Kd, Kn, Ts}, output_saturation{output_min, output_max}, integrator{1, Ts}
     {
         ResetState();
     }
 
+    struct Coefficients {
+        CoefficientType<T> Kp, Ki, Kb;
+        typename DType::Coefficients d;
+        Saturation<T, T> output_saturation;
+        typename control_system::static_dispatch::DiscreteIntegrator<T>::Coefficients integrator;
+    };
+
+    /**
+     * @brief 由参数算出一组系数，可以在其他线程中调用
+     *
+     */
+    static Coefficients MakeCoefficients(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Kd, ParamType<T> Kn, ParamType<T> Ts,
+                                         ParamType<T> Kb, T output_min, T output_max)
+    {
+        return {CoefficientType<T>(Kp), CoefficientType<T>(Ki), CoefficientType<T>(Kb), DType::MakeCoefficients(Kd, Kn, Ts), {output_min, output_max},
+                control_system::static_dispatch::DiscreteIntegrator<T>::MakeCoefficients(1, Ts)};
+    }
+
+    /**
+     * @brief 一次性替换所有系数，内部状态保留
+     *
+     */
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        Kp                = coefficients.Kp;
+        Ki                = coefficients.Ki;
+        Kb                = coefficients.Kb;
+        output_saturation = coefficients.output_saturation;
+        d_controller.SetCoefficients(coefficients.d);
+        integrator.SetCoefficients(coefficients.integrator);
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {Kp, Ki, Kb, d_controller.GetCoefficients(), output_saturation, integrator.GetCoefficients()};
+    }
+
     /**
      * @brief 走一个采样周期
      *
      * @param input 输入
      * @return T 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
+        CONTROL_SYSTEM_PROBE_TIME("pid::PID_AntiWindup::Step");
         auto p = Kp * input;
         auto d = d_controller.Step(input);
 
-        auto preSat  = integrator.GetStateOutput() + p + d;
+        auto preSat  = T(integrator.GetStateOutput()) + p + d;
         auto postSat = output_saturation(preSat);
 
+        CONTROL_SYSTEM_PROBE_STREAK("pid::PID_AntiWindup output saturated", output_saturated_, postSat != preSat);
+
         auto i_output = integrator.Step(input * Ki + (postSat - preSat) * Kb);
         return output_saturation(i_output + p + d);
     }
 
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        T d_output[kBlockBufferSize];
+
+        auto kp  = Kp;
+        auto ki  = Ki;
+        auto kb  = Kb;
+        auto sat = output_saturation;
+        auto c   = integrator.GetInputCoefficient();
+        auto x   = integrator.GetStateOutput();
+
+        for (size_t begin = 0; begin < n; begin += kBlockBufferSize) {
+            auto length = std::min(n - begin, kBlockBufferSize);
+
+            // 微分项只依赖输入，可以先整段算出来
+            d_controller.StepBlock(input + begin, d_output, length);
+
+            for (size_t i = 0; i < length; i++) {
+                auto in = input[begin + i];
+                auto p  = kp * in;
+                auto d  = d_output[i];
+
+                auto preSat  = T(x) + p + d;
+                auto postSat = sat(preSat);
+
+                CONTROL_SYSTEM_PROBE_STREAK("pid::PID_AntiWindup output saturated", output_saturated_, postSat != preSat);
+
+                // 与 DiscreteIntegrator::Step() 相同
+                auto temp     = c * StateType<T>(in * ki + (postSat - preSat) * kb);
+                auto i_output = x + temp;
+                x             = i_output + temp;
+
+                output[begin + i] = sat(T(i_output) + p + d);
+            }
+        }
+
+        integrator.SetStateOutput(x);
+    }
+
     /**
      * @brief 重置控制器状态
      *
@@ -366,16 +738,18 @@ public:
 };
 
 template <typename T>
-class PI_AntiWindup : public DiscreteControllerBase<T>
+class PI_AntiWindup : public StaticControllerBase<PI_AntiWindup<T>, T>
 {
 public:
-    T Kp;                               // 比例系数，可以直接修改
-    T Ki;                               // 积分系数，可以直接修改
-    T Kb;                               // 反算系数，可以直接修改
+    CoefficientType<T> Kp;              // 比例系数，可以直接修改
+    CoefficientType<T> Ki;              // 积分系数，可以直接修改
+    CoefficientType<T> Kb;              // 反算系数，可以直接修改
     Saturation<T, T> output_saturation; // 输出限幅
 
 private:
-    DiscreteIntegrator<T> integrator;
+    control_system::static_dispatch::DiscreteIntegrator<T> integrator;
+
+    CONTROL_SYSTEM_PROBE_STREAK_MEMBER(output_saturated_); // 开启插桩时记录输出连续饱和的步数
 
 public:
     /**
@@ -388,29 +762,88 @@ public:
      * @param output_min 输出饱和下限
      * @param output_max 输出饱和上限
      */
-    PI_AntiWindup(T Kp, T Ki, T Ts, T Kb, T output_min, T output_max)
+    PI_AntiWindup(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Ts, ParamType<T> Kb, T output_min, T output_max)
         : Kp{Kp}, Ki{Ki}, Kb{Kb}, output_saturation{output_min, output_max}, integrator{1, Ts}
     {
         ResetState();
     }
 
+    struct Coefficients {
+        CoefficientType<T> Kp, Ki, Kb;
+        Saturation<T, T> output_saturation;
+        typename control_system::static_dispatch::DiscreteIntegrator<T>::Coefficients integrator;
+    };
+
+    static Coefficients MakeCoefficients(ParamType<T> Kp, ParamType<T> Ki, ParamType<T> Ts, ParamType<T> Kb, T output_min,
+                                         T output_max)
+    {
+        return {CoefficientType<T>(Kp), CoefficientType<T>(Ki), CoefficientType<T>(Kb), {output_min, output_max},
+                control_system::static_dispatch::DiscreteIntegrator<T>::MakeCoefficients(1, Ts)};
+    }
+
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        Kp                = coefficients.Kp;
+        Ki                = coefficients.Ki;
+        Kb                = coefficients.Kb;
+        output_saturation = coefficients.output_saturation;
+        integrator.SetCoefficients(coefficients.integrator);
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {Kp, Ki, Kb, output_saturation, integrator.GetCoefficients()};
+    }
+
     /**
      * @brief 走一个采样周期
      *
      * @param input 输入
      * @return T 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
+        CONTROL_SYSTEM_PROBE_TIME("pid::PI_AntiWindup::Step");
         auto p = Kp * input;
 
-        auto preSat  = integrator.GetStateOutput() + p;
+        auto preSat  = T(integrator.GetStateOutput()) + p;
         auto postSat = output_saturation(preSat);
 
+        CONTROL_SYSTEM_PROBE_STREAK("pid::PI_AntiWindup output saturated", output_saturated_, postSat != preSat);
+
         auto i_output = integrator.Step(input * Ki + (postSat - preSat) * Kb);
         return output_saturation(i_output + p);
     }
 
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        auto kp  = Kp;
+        auto ki  = Ki;
+        auto kb  = Kb;
+        auto sat = output_saturation;
+        auto c   = integrator.GetInputCoefficient();
+        auto x   = integrator.GetStateOutput();
+
+        for (size_t i = 0; i < n; i++) {
+            auto in = input[i];
+            auto p  = kp * in;
+
+            auto preSat  = T(x) + p;
+            auto postSat = sat(preSat);
+
+            CONTROL_SYSTEM_PROBE_STREAK("pid::PI_AntiWindup output saturated", output_saturated_, postSat != preSat);
+
+            // 与 DiscreteIntegrator::Step() 相同
+            auto temp     = c * StateType<T>(in * ki + (postSat - preSat) * kb);
+            auto i_output = x + temp;
+            x             = i_output + temp;
+
+            output[i] = sat(T(i_output) + p);
+        }
+
+        integrator.SetStateOutput(x);
+    }
+
     /**
      * @brief 重置控制器状态
      *
@@ -421,6 +854,68 @@ public:
     }
 };
 
+} // namespace static_dispatch
+
+// 以下为虚函数接口的版本，用法与 static_dispatch 中的同名控制器相同
+// 组合控制器中的积分器、微分器（i_controller、d_controller）也是虚函数接口的类型，可以当作 DiscreteControllerBase<T> 使用
+
+template <typename T>
+class P : public DynamicController<static_dispatch::P<T>, P<T>>
+{
+public:
+    using DynamicController<static_dispatch::P<T>, P<T>>::DynamicController;
+};
+
+/**
+ * @brief 积分控制器
+ * @note 直接使用了 DiscreteIntegratorSaturation
+ *
+ */
+template <typename T>
+using I = DiscreteIntegratorSaturation<T>;
+
+template <typename T>
+class D : public DynamicController<static_dispatch::D<T>, D<T>>
+{
+public:
+    using DynamicController<static_dispatch::D<T>, D<T>>::DynamicController;
+};
+
+template <typename T, typename IntegratorType = I<T>>
+class PID : public DynamicController<static_dispatch::PID<T, IntegratorType, D<T>>, PID<T, IntegratorType>>
+{
+public:
+    using DynamicController<static_dispatch::PID<T, IntegratorType, D<T>>, PID<T, IntegratorType>>::DynamicController;
+};
+
+template <typename T, typename IntegratorType = I<T>>
+class PI : public DynamicController<static_dispatch::PI<T, IntegratorType>, PI<T, IntegratorType>>
+{
+public:
+    using DynamicController<static_dispatch::PI<T, IntegratorType>, PI<T, IntegratorType>>::DynamicController;
+};
+
+template <typename T>
+class PD : public DynamicController<static_dispatch::PD<T, D<T>>, PD<T>>
+{
+public:
+    using DynamicController<static_dispatch::PD<T, D<T>>, PD<T>>::DynamicController;
+};
+
+template <typename T>
+class PID_AntiWindup : public DynamicController<static_dispatch::PID_AntiWindup<T, D<T>>, PID_AntiWindup<T>>
+{
+public:
+    using DynamicController<static_dispatch::PID_AntiWindup<T, D<T>>, PID_AntiWindup<T>>::DynamicController;
+};
+
+template <typename T>
+class PI_AntiWindup : public DynamicController<static_dispatch::PI_AntiWindup<T>, PI_AntiWindup<T>>
+{
+public:
+    using DynamicController<static_dispatch::PI_AntiWindup<T>, PI_AntiWindup<T>>::DynamicController;
+};
+
 } // namespace pid
 
 } // namespace control_system
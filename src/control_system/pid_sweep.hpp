@@ -0,0 +1,460 @@
+/**
+ * @file pid_sweep.hpp
+ * @author X. Y.
+ * @brief 抗饱和 PID 参数的多线程网格搜索和蒙特卡洛搜索
+ * @version 0.1
+ * @date 2023-08-30
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 在参数空间（Kp、Ki、Kd、Kn、Kb、输出限幅）中按网格或随机地取大量候选参数，
+ * 对每组参数在若干个对象样本（对象的不确定性）上做阶跃响应仿真，取各指标的最坏值作为这组参数的代价：
+ * - 每 batch_size 组参数为一批，一批参数作为 PIDBank_AntiWindup 的各个通道，用 ClosedLoopSimulation 同步仿真
+ * - 工作线程用一个原子计数器领取下一批，不加锁
+ * - 随机参数由每一批各自的随机数序列生成（由 seed 和批号决定），对象样本在开始时由 seed 生成一次、所有参数共用，
+ *   因此结果与线程数和调度顺序无关，可以复现
+ * - 每个线程各自维护统计和 Pareto 前沿（IAE、超调量、调节时间都越小越好），不共享任何可写的数据；
+ *   新进入本线程前沿的候选通过 SpscRing 交给调用 Run() 的线程，由它合并成全局的 Pareto 前沿，
+ *   并在有候选进入全局前沿时立即调用回调函数（之后它可能又被更好的候选淘汰）
+ * - 发散的候选（IAE 不是有限值）只计数，不参与比较
+ *
+ * 使用示例：
+ * pid::SweepOptions<float> options;
+ * options.space.Kp      = {0.1, 10, 20, true}; // 对数间隔的 20 个值
+ * options.space.Ki      = {0.1, 100, 20, true};
+ * options.Ts            = 0.001;
+ * options.steps         = 3000;
+ * options.plant_samples = 8;
+ * options.plant_sampler = [](std::mt19937_64 &rng) { ... return ZTf<float>(num, den); };
+ * auto result = pid::PIDSweep<float>(options).Run([](const pid::SweepCandidate<float> &c) { printf(...); });
+ *
+ */
+
+#pragma once
+
+#include "pid_bank.hpp"
+#include "z_tf.hpp"
+#include "z_tf_bank.hpp"
+#include "closed_loop.hpp"
+#include "spsc_ring.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace control_system
+{
+
+namespace pid
+{
+
+/**
+ * @brief 一个参数的取值范围
+ *
+ */
+template <typename T>
+struct SweepRange {
+    T min            = 0;
+    T max            = 0;
+    size_t count     = 1;     // 网格搜索时的取值个数，为 1 时取 min
+    bool logarithmic = false; // 是否按对数均匀分布（min 和 max 必须为正）
+
+    /**
+     * @brief 网格上的第 i 个值
+     *
+     */
+    T GridValue(size_t i) const
+    {
+        if (count <= 1) return min;
+        const T t = T(i) / T(count - 1);
+        return logarithmic ? min * std::pow(max / min, t) : min + (max - min) * t;
+    }
+
+    /**
+     * @brief 由 [0, 1) 中的均匀随机数 u 得到随机值
+     *
+     */
+    T RandomValue(T u) const
+    {
+        return logarithmic ? min * std::pow(max / min, u) : min + (max - min) * u;
+    }
+};
+
+/**
+ * @brief 参数空间，含义与 PID_AntiWindup 的构造函数相同
+ *
+ */
+template <typename T>
+struct SweepSpace {
+    SweepRange<T> Kp{1, 1};
+    SweepRange<T> Ki{0, 0};
+    SweepRange<T> Kd{0, 0};
+    SweepRange<T> Kn{100, 100};
+    SweepRange<T> Kb{1, 1};
+    SweepRange<T> output_min{-std::numeric_limits<T>::max(), -std::numeric_limits<T>::max()};
+    SweepRange<T> output_max{std::numeric_limits<T>::max(), std::numeric_limits<T>::max()};
+
+    /**
+     * @brief 网格上的点数
+     *
+     */
+    size_t GridSize() const
+    {
+        return Kp.count * Ki.count * Kd.count * Kn.count * Kb.count * output_min.count * output_max.count;
+    }
+};
+
+/**
+ * @brief 一组候选参数及其代价（各对象样本中的最坏值）
+ *
+ */
+template <typename T>
+struct SweepCandidate {
+    size_t index = 0; // 第几组参数，网格搜索时即网格上的序号
+    T Kp = 0, Ki = 0, Kd = 0, Kn = 0, Kb = 0, output_min = 0, output_max = 0;
+    T iae = 0, ise = 0, overshoot = 0, settling_time = 0;
+
+    /**
+     * @brief 在 IAE、超调量、调节时间上都不差于 other，且至少一项更好
+     *
+     */
+    bool Dominates(const SweepCandidate &other) const
+    {
+        const bool no_worse = iae <= other.iae && overshoot <= other.overshoot && settling_time <= other.settling_time;
+        const bool better   = iae < other.iae || overshoot < other.overshoot || settling_time < other.settling_time;
+        return no_worse && better;
+    }
+};
+
+/**
+ * @brief 搜索的选项
+ *
+ */
+template <typename T>
+struct SweepOptions {
+    SweepSpace<T> space;
+
+    bool random         = false; // false 为网格搜索，true 为在参数空间中随机取 random_count 组参数
+    size_t random_count = 0;
+
+    T Ts                 = 0.001; // 采样周期
+    size_t steps         = 1000;  // 每次仿真的周期数
+    T reference          = 1;     // 阶跃的幅值
+    T settling_tolerance = 0.02;  // 调节时间的容差带（相对于阶跃的幅值）
+
+    // 对象的不确定性：开始时用 plant_sampler 生成 plant_samples 个对象，每组参数都在所有对象上仿真
+    size_t plant_samples = 1;
+    std::function<control_system::static_dispatch::ZTf<T>(std::mt19937_64 &)> plant_sampler;
+
+    size_t batch_size = 64; // 每批的参数组数（PIDBank_AntiWindup 的通道数）
+    size_t threads    = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t seed     = 0;
+
+    bool flush_denormals = true; // 工作线程中把非规格化浮点数当作 0（见 ScopedFlushDenormals），快很多
+};
+
+/**
+ * @brief 搜索结果
+ *
+ */
+template <typename T>
+struct SweepResult {
+    size_t evaluated = 0;                  // 仿真过的参数组数
+    size_t unstable  = 0;                  // 发散的参数组数
+    SweepCandidate<T> best_iae;            // IAE 最小的一组
+    std::vector<SweepCandidate<T>> pareto; // Pareto 前沿，按 IAE 从小到大排列
+};
+
+/**
+ * @brief 把 candidate 加入 Pareto 前沿，并删除被它支配的候选
+ *
+ * @return 是否加入（被前沿中的某个候选支配，或与之代价相同而序号更大时不加入）
+ */
+template <typename T>
+bool InsertPareto(std::vector<SweepCandidate<T>> &front, const SweepCandidate<T> &candidate)
+{
+    for (auto &c : front) {
+        if (c.Dominates(candidate)) return false;
+
+        // 代价完全相同时保留序号小的，使结果与合并的顺序无关
+        if (c.iae == candidate.iae && c.overshoot == candidate.overshoot && c.settling_time == candidate.settling_time) {
+            if (candidate.index >= c.index) return false;
+            c = candidate;
+            return true;
+        }
+    }
+
+    front.erase(std::remove_if(front.begin(), front.end(),
+                               [&](const SweepCandidate<T> &c) { return candidate.Dominates(c); }),
+                front.end());
+    front.push_back(candidate);
+    return true;
+}
+
+/**
+ * @brief 抗饱和 PID 参数搜索
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ */
+template <typename T>
+class PIDSweep
+{
+public:
+    using Callback = std::function<void(const SweepCandidate<T> &)>;
+
+private:
+    static constexpr size_t kCacheLineSize = 64;
+    static constexpr size_t kRingSize      = 1024;
+
+    // 每个线程独占的数据
+    struct alignas(kCacheLineSize) Worker {
+        std::thread thread;
+        SpscRing<SweepCandidate<T>> ring{kRingSize}; // 新进入本线程前沿的候选
+        std::atomic<bool> done{false};
+
+        size_t evaluated = 0;
+        size_t unstable  = 0;
+        bool has_best    = false;
+        SweepCandidate<T> best_iae;
+        std::vector<SweepCandidate<T>> pareto;
+    };
+
+    SweepOptions<T> options_;
+    std::vector<control_system::static_dispatch::ZTf<T>> plants_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_batch_{0};
+
+    size_t CandidateCount() const
+    {
+        return options_.random ? options_.random_count : options_.space.GridSize();
+    }
+
+    static uint64_t SplitMix64(uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // 较大的一个，NaN（发散）视为最大
+    static T Worst(T a, T b)
+    {
+        return std::isnan(b) || b > a ? b : a;
+    }
+
+    /**
+     * @brief 第 index 组参数
+     *
+     * @param rng 本批的随机数序列（只在随机搜索时使用）
+     */
+    SweepCandidate<T> MakeCandidate(size_t index, std::mt19937_64 &rng) const
+    {
+        const auto &space = options_.space;
+        const SweepRange<T> *ranges[] = {&space.Kp, &space.Ki, &space.Kd, &space.Kn,
+                                         &space.Kb, &space.output_min, &space.output_max};
+        T values[7];
+
+        if (options_.random) {
+            std::uniform_real_distribution<T> uniform(0, 1);
+            for (size_t p = 0; p < 7; p++) {
+                values[p] = ranges[p]->RandomValue(uniform(rng));
+            }
+        } else {
+            // 混合进制：Kp 变化最快
+            size_t rest = index;
+            for (size_t p = 0; p < 7; p++) {
+                values[p] = ranges[p]->GridValue(rest % ranges[p]->count);
+                rest /= ranges[p]->count;
+            }
+        }
+
+        SweepCandidate<T> candidate;
+        candidate.index      = index;
+        candidate.Kp         = values[0];
+        candidate.Ki         = values[1];
+        candidate.Kd         = values[2];
+        candidate.Kn         = values[3];
+        candidate.Kb         = values[4];
+        candidate.output_min = values[5];
+        candidate.output_max = values[6];
+        return candidate;
+    }
+
+    void Work(Worker &worker)
+    {
+        std::unique_ptr<ScopedFlushDenormals> flush_denormals;
+        if (options_.flush_denormals) flush_denormals.reset(new ScopedFlushDenormals());
+
+        const size_t total      = CandidateCount();
+        const size_t batch_size = std::max<size_t>(options_.batch_size, 1);
+        const size_t batches    = (total + batch_size - 1) / batch_size;
+
+        PIDBank_AntiWindup<T> controllers(batch_size);
+        std::vector<ZTfBank<T>> plants;
+        for (const auto &plant : plants_) {
+            plants.emplace_back(plant, batch_size);
+        }
+
+        ClosedLoopSimulation<T> simulation(batch_size, options_.Ts, options_.settling_tolerance);
+        std::vector<T> reference(options_.steps, options_.reference);
+        ClosedLoopSignals<T> signals;
+        signals.reference        = reference.data();
+        signals.shared_reference = true;
+
+        std::vector<SweepCandidate<T>> candidates(batch_size);
+
+        for (size_t batch = next_batch_.fetch_add(1, std::memory_order_relaxed); batch < batches;
+             batch = next_batch_.fetch_add(1, std::memory_order_relaxed)) {
+            std::mt19937_64 rng(SplitMix64(options_.seed ^ SplitMix64(batch)));
+
+            // 最后一批不满时，多出的通道重复最后一组参数，结果不使用
+            const size_t begin = batch * batch_size;
+            const size_t count = std::min(batch_size, total - begin);
+            for (size_t lane = 0; lane < batch_size; lane++) {
+                auto &c = candidates[lane];
+                c       = MakeCandidate(begin + std::min(lane, count - 1), rng);
+                controllers.SetParam(lane, c.Kp, c.Ki, c.Kd, c.Kn, options_.Ts, c.Kb, c.output_min, c.output_max);
+            }
+
+            for (auto &plant : plants) {
+                simulation.Run(controllers, plant, signals, options_.steps);
+                const auto &metrics = simulation.GetMetrics();
+                for (size_t lane = 0; lane < count; lane++) {
+                    auto &c         = candidates[lane];
+                    c.iae           = Worst(c.iae, metrics.iae[lane]);
+                    c.ise           = Worst(c.ise, metrics.ise[lane]);
+                    c.overshoot     = Worst(c.overshoot, metrics.overshoot[lane]);
+                    c.settling_time = Worst(c.settling_time, metrics.settling_time[lane]);
+                }
+            }
+
+            for (size_t lane = 0; lane < count; lane++) {
+                const auto &c = candidates[lane];
+                worker.evaluated++;
+                if (!std::isfinite(c.iae)) {
+                    worker.unstable++;
+                    continue;
+                }
+
+                if (!worker.has_best || c.iae < worker.best_iae.iae) {
+                    worker.best_iae = c;
+                    worker.has_best = true;
+                }
+                if (InsertPareto(worker.pareto, c)) {
+                    while (!worker.ring.TryPush(c)) {
+                        std::this_thread::yield(); // 调用 Run() 的线程来不及取时等待，不丢弃
+                    }
+                }
+            }
+        }
+
+        worker.done.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief 取出各线程新的前沿候选，合并到全局前沿
+     *
+     * @return 是否取到了候选
+     */
+    bool Merge(std::vector<SweepCandidate<T>> &front, const Callback &callback)
+    {
+        SweepCandidate<T> buffer[64];
+        bool any = false;
+        for (auto &worker : workers_) {
+            size_t n;
+            while ((n = worker->ring.Pop(buffer, 64)) != 0) {
+                any = true;
+                for (size_t i = 0; i < n; i++) {
+                    if (InsertPareto(front, buffer[i]) && callback) callback(buffer[i]);
+                }
+            }
+        }
+        return any;
+    }
+
+public:
+    explicit PIDSweep(const SweepOptions<T> &options)
+        : options_(options)
+    {
+        assert(options_.plant_sampler);
+        assert(options_.plant_samples > 0);
+
+        std::mt19937_64 rng(SplitMix64(options_.seed));
+        for (size_t i = 0; i < options_.plant_samples; i++) {
+            plants_.push_back(options_.plant_sampler(rng));
+        }
+    }
+
+    /**
+     * @brief 运行搜索，所有参数都仿真完后返回
+     *
+     * @param on_pareto 有候选进入全局 Pareto 前沿时在调用 Run() 的线程中调用（可以为空）
+     */
+    SweepResult<T> Run(const Callback &on_pareto = nullptr)
+    {
+        next_batch_.store(0, std::memory_order_relaxed);
+        workers_.clear();
+        for (size_t i = 0; i < std::max<size_t>(options_.threads, 1); i++) {
+            workers_.emplace_back(new Worker());
+        }
+        for (auto &worker : workers_) {
+            worker->thread = std::thread(&PIDSweep::Work, this, std::ref(*worker));
+        }
+
+        // 调用的线程负责合并，直到所有线程结束且没有剩余的候选
+        std::vector<SweepCandidate<T>> front;
+        while (true) {
+            const bool all_done = std::all_of(workers_.begin(), workers_.end(), [](const std::unique_ptr<Worker> &w) {
+                return w->done.load(std::memory_order_acquire);
+            });
+            const bool any = Merge(front, on_pareto);
+            if (all_done && !any) break;
+            if (!any) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        SweepResult<T> result;
+        bool has_best = false;
+        for (auto &worker : workers_) {
+            worker->thread.join();
+            result.evaluated += worker->evaluated;
+            result.unstable += worker->unstable;
+
+            const auto &best = worker->best_iae;
+            if (worker->has_best &&
+                (!has_best || best.iae < result.best_iae.iae || (best.iae == result.best_iae.iae && best.index < result.best_iae.index))) {
+                result.best_iae = best;
+                has_best        = true;
+            }
+        }
+
+        std::sort(front.begin(), front.end(), [](const SweepCandidate<T> &a, const SweepCandidate<T> &b) {
+            return a.iae < b.iae || (a.iae == b.iae && a.index < b.index);
+        });
+        result.pareto = std::move(front);
+        return result;
+    }
+
+    /**
+     * @brief 开始时生成的对象样本
+     *
+     */
+    const std::vector<control_system::static_dispatch::ZTf<T>> &GetPlants() const
+    {
+        return plants_;
+    }
+};
+
+} // namespace pid
+
+} // namespace control_system
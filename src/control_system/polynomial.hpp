@@ -0,0 +1,291 @@
+/**
+ * @file polynomial.hpp
+ * @author X. Y.
+ * @brief 多项式运算（乘法、加法、求值、求根）
+ * @version 0.1
+ * @date 2023-07-28
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 多项式的系数按降幂排列，与 Matlab 相同，例如 {1, -0.333, -0.667} 表示 z^2 - 0.333 z - 0.667
+ * 这些函数只在初始化时使用（例如分解传递函数、合并传递函数），不追求速度
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+namespace control_system
+{
+
+/**
+ * @brief 多项式乘法（卷积）
+ *
+ */
+template <typename T>
+std::vector<T> PolyMultiply(const std::vector<T> &a, const std::vector<T> &b)
+{
+    if (a.empty() || b.empty()) return {};
+
+    std::vector<T> result(a.size() + b.size() - 1, T(0));
+    for (size_t i = 0; i < a.size(); i++) {
+        for (size_t j = 0; j < b.size(); j++) {
+            result[i + j] += a[i] * b[j];
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 多项式加法（低次项对齐）
+ *
+ */
+template <typename T>
+std::vector<T> PolyAdd(const std::vector<T> &a, const std::vector<T> &b)
+{
+    const auto &longer  = a.size() >= b.size() ? a : b;
+    const auto &shorter = a.size() >= b.size() ? b : a;
+
+    std::vector<T> result = longer;
+    auto offset           = longer.size() - shorter.size();
+    for (size_t i = 0; i < shorter.size(); i++) {
+        result[offset + i] += shorter[i];
+    }
+    return result;
+}
+
+/**
+ * @brief 多项式乘以常数
+ *
+ */
+template <typename T>
+std::vector<T> PolyScale(std::vector<T> a, T k)
+{
+    for (auto &c : a) {
+        c *= k;
+    }
+    return a;
+}
+
+/**
+ * @brief 去掉多项式最高次的 0 系数（至少保留一个系数）
+ *
+ */
+template <typename T>
+std::vector<T> PolyTrim(const std::vector<T> &a)
+{
+    size_t first = 0;
+    while (first + 1 < a.size() && a[first] == T(0)) {
+        first++;
+    }
+    return std::vector<T>(a.begin() + first, a.end());
+}
+
+/**
+ * @brief 用秦九韶（Horner）算法求多项式的值
+ *
+ */
+template <typename T, typename X>
+X PolyEval(const std::vector<T> &a, X x)
+{
+    X result = 0;
+    for (const auto &c : a) {
+        result = result * x + c;
+    }
+    return result;
+}
+
+/**
+ * @brief 由根构造首一多项式
+ *
+ */
+inline std::vector<std::complex<double>> PolyFromRoots(const std::vector<std::complex<double>> &roots)
+{
+    std::vector<std::complex<double>> result{1.0};
+    for (const auto &r : roots) {
+        result = PolyMultiply(result, std::vector<std::complex<double>>{1.0, -r});
+    }
+    return result;
+}
+
+namespace detail
+{
+
+/**
+ * @brief 多项式在 x 处的 Taylor 系数 t[j] = p^(j)(x) / j!，j = 0 ... count - 1（反复做综合除法）
+ *
+ */
+template <typename T>
+std::vector<T> PolyTaylor(std::vector<T> a, T x, size_t count)
+{
+    std::vector<T> t;
+    for (size_t j = 0; j < count && !a.empty(); j++) {
+        for (size_t i = 1; i < a.size(); i++) {
+            a[i] += a[i - 1] * x;
+        }
+        t.push_back(a.back());
+        a.pop_back();
+    }
+    t.resize(count, T(0));
+    return t;
+}
+
+/**
+ * @brief 把数值上的重根合并为一个根
+ *
+ * m 重根在浮点数下只能求到约 eps^(1/m) 的精度（例如 (z+1)^8 的 8 个根误差约 1e-2），但它是 p^(m-1) 的单根，是良态的
+ * 对每个根附近的一簇根，从多到少尝试 m 个：从重心出发对 p^(m-1) 做牛顿迭代，
+ * 若多项式在结果处的 0 ... m-1 阶 Taylor 系数都在舍入误差的量级内，就认为是 m 重根，这一簇都换成这个值
+ *
+ * @param c 首一多项式的系数（降幂）
+ * @param z 所有根，原地修改
+ */
+inline void MergeRootClusters(const std::vector<std::complex<double>> &c, std::vector<std::complex<double>> &z)
+{
+    using complex = std::complex<double>;
+
+    constexpr double kClusterRadius = 0.25;  // 相对于 max(1, |z|)
+    constexpr double kTolerance     = 1e-12; // Taylor 系数相对于舍入误差界的阈值
+
+    const auto n = z.size();
+    std::vector<double> magnitude(c.size());
+    for (size_t i = 0; i < c.size(); i++) {
+        magnitude[i] = std::abs(c[i]);
+    }
+
+    std::vector<bool> merged(n, false);
+    for (size_t k = 0; k < n; k++) {
+        if (merged[k]) continue;
+
+        // 附近还没有合并的根，按距离排列（包括自己）
+        std::vector<size_t> nearby;
+        for (size_t j = 0; j < n; j++) {
+            if (!merged[j] && std::abs(z[j] - z[k]) <= kClusterRadius * std::max(1.0, std::abs(z[k]))) {
+                nearby.push_back(j);
+            }
+        }
+        if (nearby.size() < 2) continue;
+        std::sort(nearby.begin(), nearby.end(), [&](size_t x, size_t y) { return std::abs(z[x] - z[k]) < std::abs(z[y] - z[k]); });
+
+        for (size_t m = nearby.size(); m >= 2; m--) {
+            complex center = 0;
+            for (size_t i = 0; i < m; i++) {
+                center += z[nearby[i]];
+            }
+            center /= double(m);
+
+            // m 重根是 p^(m-1) 的单根：p^(m-1)(center + w) / (m-1)! = t[m-1] + m t[m] w + ...，用牛顿迭代从重心出发求出
+            auto t = PolyTaylor(c, center, m + 1);
+            for (int iteration = 0; iteration < 50 && t[m] != complex(0); iteration++) {
+                auto step = t[m - 1] / (double(m) * t[m]);
+                center -= step;
+                t = PolyTaylor(c, center, m + 1);
+                if (std::abs(step) <= 1e-16 * std::max(1.0, std::abs(center))) break;
+            }
+
+            auto bound = PolyTaylor(magnitude, std::abs(center), m);
+
+            bool multiple = std::abs(center - z[k]) <= kClusterRadius * std::max(1.0, std::abs(z[k]));
+            for (size_t j = 0; j < m && multiple; j++) {
+                multiple = std::abs(t[j]) <= kTolerance * bound[j];
+            }
+            if (!multiple) continue;
+
+            for (size_t i = 0; i < m; i++) {
+                z[nearby[i]]      = center;
+                merged[nearby[i]] = true;
+            }
+            break;
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief 求多项式的所有复数根（Aberth-Ehrlich 迭代）
+ * @note 数值上的重根（例如 Tustin 变换得到的 (z+1)^n）合并为同一个值，见 detail::MergeRootClusters()
+ *
+ * @param a 多项式系数（降幂），最高次的 0 系数会被忽略
+ * @return 所有根，个数等于多项式的次数
+ */
+inline std::vector<std::complex<double>> PolyRoots(const std::vector<double> &a)
+{
+    using complex = std::complex<double>;
+
+    auto p = PolyTrim(a);
+    if (p.size() <= 1) return {};
+
+    std::vector<complex> roots;
+
+    // 常数项为 0 的部分对应 z = 0 的根，直接取出，不参与迭代
+    while (p.size() > 1 && p.back() == 0) {
+        roots.push_back(0);
+        p.pop_back();
+    }
+
+    auto n = p.size() - 1;
+    if (n == 0) return roots;
+
+    // 化为首一多项式，并求出导数
+    std::vector<complex> c(p.size()), dc(n);
+    for (size_t i = 0; i <= n; i++) {
+        c[i] = p[i] / p[0];
+    }
+    for (size_t i = 0; i < n; i++) {
+        dc[i] = c[i] * double(n - i);
+    }
+
+    // 初值取在包含所有根的圆上（Cauchy 上界），角度错开以免对称
+    double radius = 0;
+    for (size_t i = 1; i <= n; i++) {
+        radius = std::max(radius, std::abs(c[i]));
+    }
+    radius += 1;
+
+    const double pi = std::acos(-1.0);
+
+    std::vector<complex> z(n);
+    for (size_t k = 0; k < n; k++) {
+        z[k] = std::polar(radius, 2 * pi * k / n + 0.4);
+    }
+
+    for (int iteration = 0; iteration < 500; iteration++) {
+        double max_step = 0;
+        for (size_t k = 0; k < n; k++) {
+            auto value = PolyEval(c, z[k]);
+            if (value == complex(0)) continue;
+
+            auto ratio = value / PolyEval(dc, z[k]);
+            complex sum = 0;
+            for (size_t j = 0; j < n; j++) {
+                if (j != k) sum += 1.0 / (z[k] - z[j]);
+            }
+
+            auto step = ratio / (1.0 - ratio * sum);
+            z[k] -= step;
+            max_step = std::max(max_step, std::abs(step) / std::max(1.0, std::abs(z[k])));
+        }
+
+        if (max_step < 1e-15) break;
+    }
+
+    detail::MergeRootClusters(c, z);
+
+    // 实系数多项式的根：虚部极小的视为实根
+    for (auto &r : z) {
+        if (std::abs(r.imag()) <= 1e-9 * std::max(1.0, std::abs(r))) {
+            r = r.real();
+        }
+    }
+
+    roots.insert(roots.end(), z.begin(), z.end());
+    return roots;
+}
+
+} // namespace control_system
@@ -0,0 +1,142 @@
+/**
+ * @file rate_transition.hpp
+ * @author X. Y.
+ * @brief 不同采样周期之间传递数据的模块
+ * @version 0.1
+ * @date 2023-08-12
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 按照 Simulink 中的 Rate Transition 模块设计：
+ * - RateTransition：在慢速率的采样时刻锁存输入，两次锁存之间输出保持不变
+ *   快 -> 慢时相当于零阶保持（慢回路每次看到的是本周期开始时快回路的最新输出）
+ *   慢 -> 快时相当于延迟一个慢周期（快回路看到的是慢回路上一个周期的输出，慢回路的计算可以跨越多个快周期）
+ *   锁存由 MultiRateScheduler 在慢速率组的每个采样时刻、这一拍的所有任务执行之前完成，也可以自己调用 Update()
+ * - DoubleBuffer：两个线程之间无锁地传递最新值，读者总能读到某一次完整写入的值
+ *
+ * 使用示例：
+ * control_system::RateTransition<float> speed_reference;   // 速度环（慢） -> 电流环（快）
+ * speed_reference.Write(speed_controller.Step(error));     // 慢回路中写
+ * auto reference = speed_reference.Read();                 // 快回路中读
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <type_traits>
+
+namespace control_system
+{
+
+/**
+ * @brief 速率转换（零阶保持 / 单位延迟）
+ *
+ * @tparam T 数据类型
+ */
+template <typename T>
+class RateTransition
+{
+private:
+    T input_;  // 最近一次写入的值
+    T output_; // 上一次锁存的值
+
+public:
+    RateTransition(T initial_value = T{})
+        : input_{initial_value}, output_{initial_value} {};
+
+    /**
+     * @brief 写入（在产生数据的回路中调用）
+     *
+     */
+    void Write(const T &value)
+    {
+        input_ = value;
+    }
+
+    /**
+     * @brief 读出上一次锁存的值（在使用数据的回路中调用）
+     *
+     */
+    const T &Read() const
+    {
+        return output_;
+    }
+
+    /**
+     * @brief 锁存：在慢速率组的采样时刻调用
+     *
+     */
+    void Update()
+    {
+        output_ = input_;
+    }
+
+    /**
+     * @brief 把输入和输出都恢复为 value
+     *
+     */
+    void ResetState(T value = T{})
+    {
+        input_  = value;
+        output_ = value;
+    }
+};
+
+/**
+ * @brief 单写单读、无锁的双缓冲，用于在不同线程中运行的回路之间传递数据
+ * @note 写者每次写入另一个缓冲区再发布；读者读的过程中如果该缓冲区被改写（写者连续写了两次），就重新读
+ *
+ * @tparam T 数据类型，必须可以平凡拷贝
+ */
+template <typename T>
+class DoubleBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "DoubleBuffer 只能用于可以平凡拷贝的类型");
+
+private:
+    std::array<T, 2> buffers_;
+    std::array<std::atomic<unsigned>, 2> versions_{}; // 奇数表示正在写
+    std::atomic<unsigned> published_{0};              // 最近写完的缓冲区
+
+public:
+    DoubleBuffer(T initial_value = T{})
+        : buffers_{initial_value, initial_value} {};
+
+    /**
+     * @brief 写入（只能在一个线程中调用）
+     *
+     */
+    void Write(const T &value)
+    {
+        unsigned index = 1 - published_.load(std::memory_order_relaxed);
+
+        versions_[index].fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        buffers_[index] = value;
+        versions_[index].fetch_add(1, std::memory_order_release);
+
+        published_.store(index, std::memory_order_release);
+    }
+
+    /**
+     * @brief 读出最近一次完整写入的值（只能在一个线程中调用）
+     *
+     */
+    T Read() const
+    {
+        while (true) {
+            unsigned index  = published_.load(std::memory_order_acquire);
+            unsigned before = versions_[index].load(std::memory_order_acquire);
+
+            T value = buffers_[index];
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            unsigned after = versions_[index].load(std::memory_order_relaxed);
+            if (before == after && before % 2 == 0) return value;
+        }
+    }
+};
+
+} // namespace control_system
@@ -0,0 +1,545 @@
+/**
+ * @file replay.hpp
+ * @author X. Y.
+ * @brief 离线回放：用内存映射的信号文件驱动控制器或框图
+ * @version 0.1
+ * @date 2023-08-26
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 用录制好的传感器数据离线验证控制器参数：
+ * - SignalFile 是一个内存映射（mmap）的二进制信号文件，每个通道的数据连续存放（按列），
+ *   控制器的 StepBlock() 直接读写映射的内存，不解析、不拷贝
+ * - ReplayFiles() 把一个控制器（拷贝给每个通道）作用于若干个文件的每个通道，输出写入同样格式的文件；
+ *   每个（文件, 通道）是一个任务，由 ParallelExecutor 分到多个线程上执行
+ * - 很长的单个通道可以按时间分片（shard_samples），每片先用前面 warmup_samples 个输入预热控制器的状态；
+ *   只有控制器的记忆会衰减（如 FIR、稳定的 IIR 滤波器）且预热足够长时，分片的结果才与不分片的结果近似相等，
+ *   含积分器的控制器不应分片
+ * - ReplayDiagramFiles() 用于多输入多输出的框图，每个文件的各个通道依次作为框图的各个输入；框图的 StepBlock()
+ *   直接读写映射的各个通道，每个（文件, 分片）是一个任务，分片的规则与 ReplayFiles() 相同
+ *
+ * 文件格式（本机字节序）：文件头 SignalFileHeader（64 字节），之后是各通道的数据，
+ * 第 i 个通道从 64 + i * channel_stride 字节处开始，channel_stride 为 sample_count 个值的字节数对齐到 64 字节
+ *
+ * 只支持 POSIX 系统（Linux、macOS）
+ *
+ * 使用示例：
+ * control_system::WriteSignalFile<float>("log.signal", {channel0, channel1}); // 由已有数据生成信号文件
+ * control_system::ZTf<float> candidate({0.1}, {1, -0.9});
+ * control_system::ReplayFiles<float>(candidate, {"log.signal"}, {"log_out.signal"});
+ * control_system::SignalFile<float> result;
+ * result.Open("log_out.signal");
+ * const float *y = result.Channel(0);
+ *
+ */
+
+#pragma once
+
+#include "parallel_executor.hpp"
+#include "block_diagram.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "replay.hpp 只支持 POSIX 系统"
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace control_system
+{
+
+/**
+ * @brief 一个内存映射的文件
+ *
+ */
+class MappedFile
+{
+private:
+    void *data_    = nullptr;
+    size_t size_   = 0;
+    bool writable_ = false;
+
+public:
+    MappedFile(){};
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept
+        : data_{other.data_}, size_{other.size_}, writable_{other.writable_}
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    MappedFile &operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other) {
+            Close();
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+            std::swap(writable_, other.writable_);
+        }
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    /**
+     * @brief 以只读方式映射一个已有的文件
+     *
+     */
+    bool OpenRead(const std::string &path)
+    {
+        Close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat status;
+        if (::fstat(fd, &status) != 0 || status.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void *data = ::mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // 映射建立后即可关闭文件描述符
+        if (data == MAP_FAILED) return false;
+
+        data_     = data;
+        size_     = status.st_size;
+        writable_ = false;
+        ::madvise(data_, size_, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    /**
+     * @brief 创建（或清空）一个大小为 size 字节的文件，以读写方式映射
+     *
+     */
+    bool Create(const std::string &path, size_t size)
+    {
+        Close();
+        assert(size > 0);
+
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+
+        if (::ftruncate(fd, size) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) return false;
+
+        data_     = data;
+        size_     = size;
+        writable_ = true;
+        ::madvise(data_, size_, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    /**
+     * @brief 把修改过的页写回磁盘（不调用时由系统在之后写回）
+     *
+     */
+    void Sync()
+    {
+        if (data_ != nullptr && writable_) ::msync(data_, size_, MS_SYNC);
+    }
+
+    void Close()
+    {
+        if (data_ == nullptr) return;
+
+        ::munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    /**
+     * @brief 提示系统预读 [address, address + size) 所在的页，address 可以是映射内的任意位置
+     *
+     */
+    static void WillNeed(const void *address, size_t size)
+    {
+        static const uintptr_t kPageSize = ::sysconf(_SC_PAGESIZE);
+        if (size == 0) return;
+
+        const auto begin = reinterpret_cast<uintptr_t>(address) & ~(kPageSize - 1);
+        const auto end   = reinterpret_cast<uintptr_t>(address) + size;
+        ::madvise(reinterpret_cast<void *>(begin), end - begin, MADV_WILLNEED);
+    }
+
+    bool IsOpen() const
+    {
+        return data_ != nullptr;
+    }
+
+    const void *Data() const
+    {
+        return data_;
+    }
+
+    void *Data()
+    {
+        return data_;
+    }
+
+    size_t Size() const
+    {
+        return size_;
+    }
+};
+
+constexpr char kSignalFileMagic[8]    = {'C', 'S', 'S', 'I', 'G', 'N', 'A', 'L'};
+constexpr uint32_t kSignalFileVersion = 1;
+
+struct SignalFileHeader {
+    char magic[8];           // kSignalFileMagic
+    uint32_t version;        // kSignalFileVersion
+    uint32_t value_size;     // 每个值的字节数
+    uint32_t is_floating;    // 值是否为浮点数
+    uint32_t channel_count;  // 通道数
+    uint64_t sample_count;   // 每个通道的采样数
+    uint64_t channel_stride; // 相邻两个通道的起始位置相差的字节数
+    uint64_t reserved[3];
+};
+
+static_assert(sizeof(SignalFileHeader) == 64, "SignalFileHeader 应为 64 字节");
+
+/**
+ * @brief 内存映射的信号文件
+ *
+ * @tparam T 值的类型
+ */
+template <typename T>
+class SignalFile
+{
+    static_assert(std::is_arithmetic<T>::value, "T 应为算术类型");
+
+private:
+    MappedFile file_;
+
+    const SignalFileHeader &Header() const
+    {
+        return *static_cast<const SignalFileHeader *>(file_.Data());
+    }
+
+    static size_t ChannelStride(size_t sample_count)
+    {
+        return (sample_count * sizeof(T) + 63) & ~size_t(63);
+    }
+
+public:
+    /**
+     * @brief 以只读方式打开
+     *
+     * @return 文件无法打开、格式或值的类型不符时返回 false
+     */
+    bool Open(const std::string &path)
+    {
+        if (!file_.OpenRead(path)) return false;
+
+        bool valid = file_.Size() >= sizeof(SignalFileHeader);
+        if (valid) {
+            const auto &header = Header();
+            valid = std::memcmp(header.magic, kSignalFileMagic, sizeof(header.magic)) == 0 &&
+                    header.version == kSignalFileVersion && header.value_size == sizeof(T) &&
+                    bool(header.is_floating) == std::is_floating_point<T>::value &&
+                    header.channel_stride >= header.sample_count * sizeof(T) &&
+                    file_.Size() >= sizeof(SignalFileHeader) + header.channel_count * header.channel_stride;
+        }
+
+        if (!valid) file_.Close();
+        return valid;
+    }
+
+    /**
+     * @brief 创建一个新文件，以读写方式打开，数据初始为 0
+     *
+     */
+    bool Create(const std::string &path, size_t channel_count, size_t sample_count)
+    {
+        const size_t stride = ChannelStride(sample_count);
+        if (!file_.Create(path, sizeof(SignalFileHeader) + channel_count * stride)) return false;
+
+        SignalFileHeader header{};
+        std::memcpy(header.magic, kSignalFileMagic, sizeof(header.magic));
+        header.version        = kSignalFileVersion;
+        header.value_size     = sizeof(T);
+        header.is_floating    = std::is_floating_point<T>::value;
+        header.channel_count  = static_cast<uint32_t>(channel_count);
+        header.sample_count   = sample_count;
+        header.channel_stride = stride;
+        std::memcpy(file_.Data(), &header, sizeof(header));
+        return true;
+    }
+
+    void Sync()
+    {
+        file_.Sync();
+    }
+
+    void Close()
+    {
+        file_.Close();
+    }
+
+    bool IsOpen() const
+    {
+        return file_.IsOpen();
+    }
+
+    size_t ChannelCount() const
+    {
+        return IsOpen() ? Header().channel_count : 0;
+    }
+
+    size_t SampleCount() const
+    {
+        return IsOpen() ? Header().sample_count : 0;
+    }
+
+    /**
+     * @brief 第 i 个通道的数据，长度为 SampleCount()，按 64 字节对齐
+     *
+     */
+    const T *Channel(size_t i) const
+    {
+        assert(i < ChannelCount());
+        return reinterpret_cast<const T *>(static_cast<const char *>(file_.Data()) + sizeof(SignalFileHeader) +
+                                           i * Header().channel_stride);
+    }
+
+    /**
+     * @brief 第 i 个通道的数据（可写），只能用于 Create() 打开的文件
+     *
+     */
+    T *Channel(size_t i)
+    {
+        assert(i < ChannelCount());
+        return reinterpret_cast<T *>(static_cast<char *>(file_.Data()) + sizeof(SignalFileHeader) +
+                                     i * Header().channel_stride);
+    }
+};
+
+/**
+ * @brief 把若干个等长的通道写成一个信号文件
+ *
+ */
+template <typename T>
+bool WriteSignalFile(const std::string &path, const std::vector<std::vector<T>> &channels)
+{
+    const size_t sample_count = channels.empty() ? 0 : channels[0].size();
+    assert(std::all_of(channels.begin(), channels.end(),
+                       [&](const std::vector<T> &channel) { return channel.size() == sample_count; }));
+
+    SignalFile<T> file;
+    if (!file.Create(path, channels.size(), sample_count)) return false;
+    for (size_t i = 0; i < channels.size(); i++) {
+        std::copy(channels[i].begin(), channels[i].end(), file.Channel(i));
+    }
+    return true;
+}
+
+/**
+ * @brief 回放的选项
+ *
+ */
+struct ReplayOptions {
+    size_t threads        = std::max(1u, std::thread::hardware_concurrency()); // 线程数（包括调用的线程）
+    size_t block_size     = 1 << 16; // 每次 StepBlock() 的采样数，处理一块时预读下一块
+    size_t shard_samples  = 0;       // 按时间分片时每片的采样数，0 为不分片
+    size_t warmup_samples = 0;       // 每片（第一片除外）之前用于预热的采样数
+    bool sync             = false;   // 返回前是否把输出文件写回磁盘
+};
+
+/**
+ * @brief 用控制器处理一段连续的数据，每次 StepBlock() 一块，同时预读下一块
+ *
+ */
+template <typename Controller, typename T>
+void ReplayBlock(Controller &controller, const T *input, T *output, size_t n, size_t block_size)
+{
+    block_size = std::max<size_t>(block_size, 1);
+    for (size_t begin = 0; begin < n; begin += block_size) {
+        const size_t count = std::min(block_size, n - begin);
+        if (begin + count < n) {
+            MappedFile::WillNeed(input + begin + count, std::min(block_size, n - begin - count) * sizeof(T));
+        }
+        controller.StepBlock(input + begin, output + begin, count);
+    }
+}
+
+/**
+ * @brief 把控制器 prototype 分别作用于每个输入文件的每个通道，结果写入对应的输出文件（通道数和采样数与输入相同）
+ *
+ * @tparam T 值的类型，与文件中的一致
+ * @param prototype 每个任务使用它的一份拷贝（包括其当前状态）
+ * @return 有文件无法打开或创建时返回 false，此时不进行任何计算；先打开并检查所有输入文件，都没有问题才创建输出文件
+ */
+template <typename T, typename Controller>
+bool ReplayFiles(const Controller &prototype, const std::vector<std::string> &input_paths,
+                 const std::vector<std::string> &output_paths, const ReplayOptions &options = {})
+{
+    assert(input_paths.size() == output_paths.size());
+
+    std::vector<SignalFile<T>> inputs(input_paths.size()), outputs(output_paths.size());
+    for (size_t f = 0; f < input_paths.size(); f++) {
+        if (!inputs[f].Open(input_paths[f])) return false;
+    }
+    for (size_t f = 0; f < output_paths.size(); f++) {
+        if (!outputs[f].Create(output_paths[f], inputs[f].ChannelCount(), inputs[f].SampleCount())) return false;
+    }
+
+    ParallelExecutor executor(options.threads, 1);
+    for (size_t f = 0; f < inputs.size(); f++) {
+        const size_t n     = inputs[f].SampleCount();
+        const size_t shard = options.shard_samples == 0 ? std::max<size_t>(n, 1) : options.shard_samples;
+
+        for (size_t c = 0; c < inputs[f].ChannelCount(); c++) {
+            const T *input = inputs[f].Channel(c);
+            T *output      = outputs[f].Channel(c);
+
+            for (size_t begin = 0; begin < n; begin += shard) {
+                const size_t count = std::min(shard, n - begin);
+                executor.AddTask([&prototype, &options, input, output, begin, count] {
+                    Controller controller = prototype;
+
+                    // 预热：用分片之前的输入走一遍，结果丢弃
+                    const size_t warmup = std::min(options.warmup_samples, begin);
+                    if (warmup != 0) {
+                        std::vector<T> scratch(std::min(warmup, std::max<size_t>(options.block_size, 1)));
+                        for (size_t i = begin - warmup; i < begin; i += scratch.size()) {
+                            controller.StepBlock(input + i, scratch.data(), std::min(scratch.size(), begin - i));
+                        }
+                    }
+
+                    ReplayBlock(controller, input + begin, output + begin, count, options.block_size);
+                });
+            }
+        }
+    }
+    executor.RunTick();
+
+    if (options.sync) {
+        for (auto &output : outputs) {
+            output.Sync();
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 用框图处理若干个文件，每个文件的第 i 个通道为框图的第 i 个输入，
+ *        输出文件的第 i 个通道为框图的第 i 个输出
+ *
+ * @param build 在一个空的框图上搭建框图（不需要调用 Compile()），每个（文件, 分片）调用一次，都在调用的线程中
+ * @return 有文件无法打开或创建、通道数与框图的输入个数不符、框图有代数环时返回 false；
+ *         先搭建所有框图、检查所有输入文件，都没有问题才创建输出文件
+ */
+template <typename T>
+bool ReplayDiagramFiles(const std::function<void(BlockDiagram<T> &)> &build, const std::vector<std::string> &input_paths,
+                        const std::vector<std::string> &output_paths, const ReplayOptions &options = {})
+{
+    assert(input_paths.size() == output_paths.size());
+
+    struct Shard {
+        size_t file, begin, count;
+        std::unique_ptr<BlockDiagram<T>> diagram;
+    };
+
+    std::vector<Shard> shards;
+    std::vector<SignalFile<T>> inputs(input_paths.size()), outputs(output_paths.size());
+    for (size_t f = 0; f < input_paths.size(); f++) {
+        if (!inputs[f].Open(input_paths[f])) return false;
+
+        const size_t n     = inputs[f].SampleCount();
+        const size_t shard = options.shard_samples == 0 ? std::max<size_t>(n, 1) : options.shard_samples;
+        for (size_t begin = 0; begin == 0 || begin < n; begin += shard) {
+            std::unique_ptr<BlockDiagram<T>> diagram(new BlockDiagram<T>());
+            build(*diagram);
+            if (!diagram->Compile() || inputs[f].ChannelCount() != diagram->InputCount()) return false;
+            shards.push_back({f, begin, std::min(shard, n - begin), std::move(diagram)});
+        }
+    }
+    for (size_t f = 0; f < output_paths.size(); f++) {
+        const auto &diagram = *std::find_if(shards.begin(), shards.end(), [f](const Shard &shard) { return shard.file == f; })->diagram;
+        if (!outputs[f].Create(output_paths[f], diagram.OutputCount(), inputs[f].SampleCount())) return false;
+    }
+
+    ParallelExecutor executor(options.threads, 1);
+    for (auto &shard : shards) {
+        executor.AddTask([&inputs, &outputs, &options, &shard] {
+            auto &diagram         = *shard.diagram;
+            const auto &input     = inputs[shard.file];
+            auto &output          = outputs[shard.file];
+            const size_t n_input  = input.ChannelCount();
+            const size_t n_output = output.ChannelCount();
+            const size_t block    = std::max<size_t>(options.block_size, 1);
+
+            std::vector<const T *> input_channels(n_input);
+            std::vector<T *> output_channels(n_output);
+
+            // 预热：用分片之前的输入走一遍，结果丢弃
+            const size_t warmup = std::min(options.warmup_samples, shard.begin);
+            if (warmup != 0) {
+                std::vector<std::vector<T>> scratch(n_output, std::vector<T>(std::min(warmup, block)));
+                for (size_t c = 0; c < n_output; c++) {
+                    output_channels[c] = scratch[c].data();
+                }
+                for (size_t i = shard.begin - warmup; i < shard.begin; i += block) {
+                    for (size_t c = 0; c < n_input; c++) {
+                        input_channels[c] = input.Channel(c) + i;
+                    }
+                    diagram.StepBlock(input_channels.data(), output_channels.data(), std::min(block, shard.begin - i));
+                }
+            }
+
+            // 每次 StepBlock() 一块，同时预读各个输入通道的下一块
+            const size_t end = shard.begin + shard.count;
+            for (size_t begin = shard.begin; begin < end; begin += block) {
+                const size_t count = std::min(block, end - begin);
+                for (size_t c = 0; c < n_input; c++) {
+                    input_channels[c] = input.Channel(c) + begin;
+                    if (begin + count < end) {
+                        MappedFile::WillNeed(input_channels[c] + count, std::min(block, end - begin - count) * sizeof(T));
+                    }
+                }
+                for (size_t c = 0; c < n_output; c++) {
+                    output_channels[c] = output.Channel(c) + begin;
+                }
+                diagram.StepBlock(input_channels.data(), output_channels.data(), count);
+            }
+        });
+    }
+    executor.RunTick();
+
+    if (options.sync) {
+        for (auto &output : outputs) {
+            output.Sync();
+        }
+    }
+    return true;
+}
+
+} // namespace control_system
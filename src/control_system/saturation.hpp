@@ -2,15 +2,18 @@
  * @file saturation.hpp
  * @author X. Y.
  * @brief 限幅函数
- * @version 0.1
+ * @version 0.2
  * @date 2023-07-05
  *
  * @copyright Copyright (c) 2023
  *
+ * 开启插桩（CONTROL_SYSTEM_INSTRUMENTATION >= 1）时统计调用次数和实际限幅的次数，见 instrumentation.hpp
+ *
  */
 
 #pragma once
 
+#include "instrumentation.hpp"
 #include <limits>
 
 namespace control_system
@@ -78,6 +81,8 @@ public:
     template <typename T>
     T operator()(T value) const
     {
+        CONTROL_SYSTEM_PROBE_HIT("Saturation", is_enable_ && (value > max_ || value < min_));
+
         if (is_enable_) {
             if (value > max_) return max_;
             if (value < min_) return min_;
@@ -0,0 +1,454 @@
+/**
+ * @file sos_filter.hpp
+ * @author X. Y.
+ * @brief 二阶节级联（biquad）形式的 Z 传递函数
+ * @version 0.1
+ * @date 2023-07-28
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 高阶传递函数直接用 ZTf 实现时，多项式系数对舍入误差非常敏感，往往必须使用 double
+ * SosFilter 把传递函数分解为若干个二阶节（转置直接 II 型）的级联，每一节只有 5 个系数，
+ * 用 float 也能保持稳定和精度，阶数较高时也比 ZTf 快
+ *
+ * 每一节的形式与 Matlab 的 sos 矩阵相同：
+ *   (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+ *
+ * 使用示例：
+ * control_system::SosFilter<float> filter({66, -124, 58}, {1, -0.333, -0.667}); // 与 ZTf 的参数相同
+ * auto sos = control_system::Tf2Sos(num, den);                                   // 也可以只做分解，类似 Matlab 的 tf2sos
+ *
+ */
+
+#pragma once
+
+#include "discrete_controller_base.hpp"
+#include "instrumentation.hpp"
+#include "polynomial.hpp"
+#include "z_tf.hpp"
+#include <vector>
+#include <complex>
+#include <cassert>
+#include <cstddef>
+#include <algorithm>
+
+namespace control_system
+{
+
+/**
+ * @brief 二阶节的系数：(b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+ *
+ */
+template <typename T>
+struct SosSection {
+    T b0, b1, b2;
+    T a1, a2;
+};
+
+/**
+ * @brief 二阶节级联的系数：gain * section[0] * section[1] * ...
+ *
+ */
+template <typename T>
+struct SosCoefficients {
+    std::vector<SosSection<T>> sections;
+    T gain = 1;
+};
+
+namespace detail
+{
+
+/**
+ * @brief 一组极点或零点：一对共轭复根、一个或两个实根
+ *
+ */
+struct RootGroup {
+    std::vector<std::complex<double>> roots;
+};
+
+/**
+ * @brief 把实系数多项式的根分成共轭复根对和实根
+ *
+ */
+inline void SplitRoots(const std::vector<std::complex<double>> &roots,
+                       std::vector<std::complex<double>> &complex_roots, // 只保留虚部为正的一个
+                       std::vector<double> &real_roots)
+{
+    std::vector<std::complex<double>> upper, lower;
+    for (const auto &r : roots) {
+        if (r.imag() > 0) {
+            upper.push_back(r);
+        } else if (r.imag() < 0) {
+            lower.push_back(r);
+        } else {
+            real_roots.push_back(r.real());
+        }
+    }
+
+    // 每个上半平面的根找一个最接近其共轭的下半平面的根配对，配不上的当作实根
+    for (const auto &u : upper) {
+        auto best = std::min_element(lower.begin(), lower.end(), [&](const auto &a, const auto &b) {
+            return std::abs(a - std::conj(u)) < std::abs(b - std::conj(u));
+        });
+
+        if (best != lower.end()) {
+            complex_roots.push_back((u + std::conj(*best)) / 2.0);
+            lower.erase(best);
+        } else {
+            real_roots.push_back(u.real());
+        }
+    }
+
+    for (const auto &l : lower) {
+        real_roots.push_back(l.real());
+    }
+}
+
+/**
+ * @brief 由至多两个根得到 1 + c1 x^-1 + c2 x^-2 形式的系数，缺少的根视为在无穷远处（即一个 z^-1 因子）
+ *
+ * @param roots 有限根
+ * @param slots 这一节的根的个数（1 或 2），有限根不足时用无穷远处的根补足
+ * @param c 输出 c0, c1, c2
+ */
+inline void SectionPolynomial(const std::vector<std::complex<double>> &roots, size_t slots, double c[3])
+{
+    auto poly = PolyFromRoots(roots); // 首一，长度为 roots.size() + 1
+
+    // 无穷远处的根对应 z^-1 因子，即系数整体右移
+    size_t shift = slots - roots.size();
+    c[0] = c[1] = c[2] = 0;
+    for (size_t i = 0; i < poly.size(); i++) {
+        c[i + shift] = poly[i].real();
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief 把 Z 传递函数分解为二阶节的级联（类似 Matlab 的 tf2sos）
+ *
+ * 离单位圆最近的极点与离它最近的零点放在同一节，极点越靠近单位圆的节越靠后，与 Matlab 默认的排列方式相同
+ *
+ * @param num 分子（降幂），与 ZTf 的参数相同
+ * @param den 分母（降幂），与 ZTf 的参数相同
+ * @note 分子阶数不能大于分母，否则是非因果系统
+ */
+template <typename T>
+SosCoefficients<T> Tf2Sos(const std::vector<T> &num, const std::vector<T> &den)
+{
+    using complex = std::complex<double>;
+
+    assert(!den.empty() && den.at(0) != 0);
+    assert(num.size() <= den.size()); // 分子阶数不能大于分母，否则是非因果系统
+
+    // 与 ZTf::Init() 相同，分子往前面补 0 到与分母等长，此后两者都可以看成 z^-1 的多项式
+    auto order = den.size() - 1;
+    std::vector<double> b(den.size() - num.size(), 0.0), a(den.begin(), den.end());
+    b.insert(b.end(), num.begin(), num.end());
+
+    SosCoefficients<T> result;
+
+    // 分子前面的 0 对应 z^-1 因子（无穷远处的零点）
+    size_t leading_zeros = 0;
+    while (leading_zeros < b.size() && b[leading_zeros] == 0) {
+        leading_zeros++;
+    }
+
+    if (leading_zeros == b.size()) {
+        // 分子为 0，输出恒为 0
+        result.gain = 0;
+        result.sections.assign((order + 1) / 2, SosSection<T>{1, 0, 0, 0, 0});
+        return result;
+    }
+
+    result.gain = static_cast<T>(b[leading_zeros] / a[0]);
+
+    std::vector<complex> complex_poles, complex_zeros;
+    std::vector<double> real_poles, real_zeros;
+    detail::SplitRoots(PolyRoots(a), complex_poles, real_poles);
+    detail::SplitRoots(PolyRoots(std::vector<double>(b.begin() + leading_zeros, b.end())), complex_zeros, real_zeros);
+    size_t infinite_zeros = leading_zeros;
+
+    // 实极点按离单位圆的距离排序，两两组成一节
+    auto distance_to_unit_circle = [](complex p) { return std::abs(1 - std::abs(p)); };
+    std::sort(real_poles.begin(), real_poles.end(), [&](double x, double y) {
+        return distance_to_unit_circle(x) < distance_to_unit_circle(y);
+    });
+
+    std::vector<detail::RootGroup> pole_groups;
+    for (const auto &p : complex_poles) {
+        pole_groups.push_back({{p, std::conj(p)}});
+    }
+    for (size_t i = 0; i + 1 < real_poles.size(); i += 2) {
+        pole_groups.push_back({{real_poles[i], real_poles[i + 1]}});
+    }
+    std::sort(pole_groups.begin(), pole_groups.end(), [&](const auto &x, const auto &y) {
+        return distance_to_unit_circle(x.roots[0]) < distance_to_unit_circle(y.roots[0]);
+    });
+
+    // 奇数阶时剩下一个实极点单独成一节，先给它挑一个实零点（或无穷远处的零点）
+    // 这样剩下的实零点和无穷远零点的总数一定是偶数，后面每节都能配满两个零点
+    std::vector<std::pair<detail::RootGroup, std::vector<complex>>> sections; // 极点和有限零点
+    std::vector<size_t> section_slots;
+
+    auto take_nearest_real_zero = [&](complex p, std::vector<complex> &zeros) {
+        if (!real_zeros.empty()) {
+            auto best = std::min_element(real_zeros.begin(), real_zeros.end(), [&](double x, double y) {
+                return std::abs(complex(x) - p) < std::abs(complex(y) - p);
+            });
+            zeros.push_back(*best);
+            real_zeros.erase(best);
+        } else {
+            assert(infinite_zeros > 0);
+            infinite_zeros--;
+        }
+    };
+
+    std::pair<detail::RootGroup, std::vector<complex>> single_section;
+    bool has_single_section = real_poles.size() % 2 == 1;
+    if (has_single_section) {
+        single_section.first.roots.push_back(real_poles.back());
+        take_nearest_real_zero(real_poles.back(), single_section.second);
+    }
+
+    for (const auto &group : pole_groups) {
+        auto p = group.roots[0];
+        std::vector<complex> zeros;
+
+        // 候选一：最近的一对共轭复零点
+        auto best_complex = std::min_element(complex_zeros.begin(), complex_zeros.end(), [&](complex x, complex y) {
+            return std::abs(x - p) < std::abs(y - p);
+        });
+
+        // 候选二：两个实零点（或无穷远零点），只要最近的那个实零点比复零点更近就用它
+        bool use_complex = best_complex != complex_zeros.end();
+        if (use_complex && !real_zeros.empty()) {
+            auto nearest_real = *std::min_element(real_zeros.begin(), real_zeros.end(), [&](double x, double y) {
+                return std::abs(complex(x) - p) < std::abs(complex(y) - p);
+            });
+            use_complex = std::abs(*best_complex - p) <= std::abs(complex(nearest_real) - p);
+        }
+        if (use_complex) {
+            zeros.push_back(*best_complex);
+            zeros.push_back(std::conj(*best_complex));
+            complex_zeros.erase(best_complex);
+        } else {
+            take_nearest_real_zero(p, zeros);
+            take_nearest_real_zero(p, zeros);
+        }
+
+        sections.push_back({group, zeros});
+        section_slots.push_back(2);
+    }
+
+    if (has_single_section) {
+        sections.push_back(single_section);
+        section_slots.push_back(1);
+    }
+
+    // 上面是按极点离单位圆由近到远排列的，反过来使离单位圆最近的极点在最后一节
+    for (size_t i = sections.size(); i-- > 0;) {
+        double bc[3], ac[3];
+        detail::SectionPolynomial(sections[i].second, section_slots[i], bc);
+        detail::SectionPolynomial(sections[i].first.roots, section_slots[i], ac);
+
+        result.sections.push_back({static_cast<T>(bc[0]), static_cast<T>(bc[1]), static_cast<T>(bc[2]),
+                                   static_cast<T>(ac[1]), static_cast<T>(ac[2])});
+    }
+
+    if (order == 0) {
+        result.sections.push_back({1, 0, 0, 0, 0});
+    }
+
+    return result;
+}
+
+namespace static_dispatch
+{
+
+/**
+ * @brief 二阶节级联形式的 Z 传递函数
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ */
+template <typename T>
+class SosFilter : public StaticControllerBase<SosFilter<T>, T>
+{
+private:
+    typedef struct
+    {
+        T z1;
+        T z2;
+    } state_t;
+
+    std::vector<SosSection<T>> sections_;
+    std::vector<state_t> states_;
+    T gain_ = 1;
+
+public:
+    using Coefficients = SosCoefficients<T>;
+
+    /**
+     * @brief 创建空的二阶节级联
+     * @note 之后必须调用 Init() 才能调用 Step()
+     */
+    SosFilter(){};
+
+    /**
+     * @brief 由二阶节系数创建
+     *
+     */
+    SosFilter(const SosCoefficients<T> &sos)
+    {
+        Init(sos);
+    }
+
+    /**
+     * @brief 由 Z 传函的分子和分母创建，参数与 ZTf 相同
+     *
+     * @param num 分子
+     * @param den 分母
+     * @note 分子阶数不能大于分母，否则是非因果系统
+     */
+    SosFilter(const std::vector<T> &num, const std::vector<T> &den)
+    {
+        Init(Tf2Sos(num, den));
+    }
+
+    /**
+     * @brief 由已经初始化的 ZTf 创建（只使用它的系数）
+     *
+     */
+    SosFilter(const ZTf<T> &ztf)
+    {
+        std::vector<T> den;
+        for (const auto &c : ztf.GetOutputCoefficients()) {
+            den.push_back(-c);
+        }
+        Init(Tf2Sos(ztf.GetInputCoefficients(), den));
+    }
+
+    /**
+     * @brief 初始化或重新指定二阶节系数
+     *
+     */
+    void Init(const SosCoefficients<T> &sos)
+    {
+        sections_ = sos.sections;
+        gain_     = sos.gain;
+        states_.resize(sections_.size());
+        ResetState();
+    }
+
+    /**
+     * @brief 走一个周期
+     *
+     * @param input 输入
+     * @return 输出
+     */
+    T Step(T input)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("SosFilter::Step");
+        T x = gain_ * input;
+
+        for (size_t i = 0; i < sections_.size(); i++) {
+            const auto &c = sections_[i];
+            auto &s       = states_[i];
+
+            // 转置直接 II 型
+            T y  = c.b0 * x + s.z1;
+            s.z1 = c.b1 * x - c.a1 * y + s.z2;
+            s.z2 = c.b2 * x - c.a2 * y;
+            x    = y;
+        }
+
+        return x;
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        // 逐个采样依次通过各节：相邻两节之间没有数据依赖的部分可以流水并行，比逐节处理整个数据块更快
+        const SosSection<T> *sections = sections_.data();
+        state_t *states               = states_.data();
+        const size_t count            = sections_.size();
+        const T gain                  = gain_;
+
+        for (size_t k = 0; k < n; k++) {
+            T x = gain * input[k];
+
+            for (size_t i = 0; i < count; i++) {
+                const auto &c = sections[i];
+                auto &s       = states[i];
+
+                T y  = c.b0 * x + s.z1;
+                s.z1 = c.b1 * x - c.a1 * y + s.z2;
+                s.z2 = c.b2 * x - c.a2 * y;
+                x    = y;
+            }
+
+            output[k] = x;
+        }
+    }
+
+    /**
+     * @brief 重置内部状态
+     *
+     */
+    void ResetState()
+    {
+        std::fill(states_.begin(), states_.end(), state_t{0, 0});
+    }
+
+    const std::vector<SosSection<T>> &GetSections() const
+    {
+        return sections_;
+    }
+
+    T GetGain() const
+    {
+        return gain_;
+    }
+
+    /**
+     * @brief 由分子和分母算出一组系数，可以在其他线程中调用
+     *
+     */
+    static Coefficients MakeCoefficients(const std::vector<T> &num, const std::vector<T> &den)
+    {
+        return Tf2Sos(num, den);
+    }
+
+    /**
+     * @brief 一次性替换所有系数，内部状态保留
+     * @note 节数必须与当前相同，只拷贝数据，不分配内存；改变节数请用 Init()
+     */
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        assert(coefficients.sections.size() == sections_.size());
+
+        std::copy(coefficients.sections.begin(), coefficients.sections.end(), sections_.begin());
+        gain_ = coefficients.gain;
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {sections_, gain_};
+    }
+};
+
+} // namespace static_dispatch
+
+/**
+ * @brief 二阶节级联形式的 Z 传递函数（虚函数接口）
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ */
+template <typename T>
+class SosFilter : public DynamicController<static_dispatch::SosFilter<T>, SosFilter<T>>
+{
+public:
+    using DynamicController<static_dispatch::SosFilter<T>, SosFilter<T>>::DynamicController;
+};
+
+} // namespace control_system
@@ -0,0 +1,133 @@
+/**
+ * @file spsc_ring.hpp
+ * @author X. Y.
+ * @brief 单生产者单消费者的无锁环形缓冲区
+ * @version 0.1
+ * @date 2023-08-24
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 一个线程只调用 TryPush()，另一个线程只调用 Pop()：
+ * - 满了 TryPush() 立即返回 false，不会等待，适合在控制线程中使用
+ * - 写位置和读位置各占一个缓存行，各自还缓存了一份对方的位置，只有看起来满了（空了）时才去读对方的缓存行
+ * - 容量为 2 的幂，取下标只需要按位与
+ *
+ * 使用示例：
+ * control_system::SpscRing<float> ring(1024);
+ * ring.TryPush(1.0f);                // 生产者线程
+ * float buffer[64];
+ * size_t n = ring.Pop(buffer, 64);   // 消费者线程
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+#include <cstddef>
+
+namespace control_system
+{
+
+template <typename T>
+class SpscRing
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing 只能用于可以平凡拷贝的类型");
+
+public:
+    static constexpr size_t kCacheLineSize = 64;
+
+private:
+    std::vector<T> buffer_;
+    size_t mask_;
+
+    // 生产者的缓存行
+    alignas(kCacheLineSize) std::atomic<size_t> head_{0}; // 下一个写入的位置
+    size_t cached_tail_ = 0;
+
+    // 消费者的缓存行
+    alignas(kCacheLineSize) std::atomic<size_t> tail_{0}; // 下一个读出的位置
+    size_t cached_head_ = 0;
+
+    static size_t RoundUpPowerOfTwo(size_t n)
+    {
+        size_t power = 1;
+        while (power < n) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+public:
+    /**
+     * @brief 创建环形缓冲区
+     *
+     * @param capacity 容量，向上取整为 2 的幂
+     */
+    explicit SpscRing(size_t capacity)
+        : buffer_(RoundUpPowerOfTwo(std::max<size_t>(capacity, 2))), mask_{buffer_.size() - 1} {};
+
+    SpscRing(const SpscRing &)            = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    /**
+     * @brief 写入一个元素（生产者线程）
+     *
+     * @return 缓冲区已满时返回 false，元素被丢弃
+     */
+    bool TryPush(const T &value)
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ == buffer_.size()) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ == buffer_.size()) return false;
+        }
+
+        buffer_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 读出至多 max_count 个元素（消费者线程）
+     *
+     * @return 读出的个数
+     */
+    size_t Pop(T *output, size_t max_count)
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (cached_head_ - tail < max_count) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+        }
+
+        const size_t count = std::min(cached_head_ - tail, max_count);
+
+        // 最多分两段拷贝
+        const size_t begin = tail & mask_;
+        const size_t first = std::min(count, buffer_.size() - begin);
+        std::copy(buffer_.begin() + begin, buffer_.begin() + begin + first, output);
+        std::copy(buffer_.begin(), buffer_.begin() + (count - first), output + first);
+
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t Capacity() const
+    {
+        return buffer_.size();
+    }
+
+    /**
+     * @brief 当前的元素个数，在其他线程中调用时只是一个近似值
+     *
+     */
+    size_t Size() const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+};
+
+} // namespace control_system
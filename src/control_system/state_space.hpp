@@ -0,0 +1,360 @@
+/**
+ * @file state_space.hpp
+ * @author X. Y.
+ * @brief 离散状态空间模型
+ * @version 0.1
+ * @date 2023-08-01
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 按照 Simulink 中的 Discrete State-Space 模块设计：
+ *   x[k+1] = A x[k] + B u[k]
+ *   y[k]   = C x[k] + D u[k]
+ *
+ * 状态数、输入数、输出数都在编译期确定，矩阵存放在 std::array 中
+ * 矩阵按列存放，矩阵乘向量写成“列乘标量再累加”的形式，最内层循环是对连续内存的逐元素乘加，编译器可以直接向量化
+ *
+ * 使用示例：
+ * // 2 个状态、1 个输入、2 个输出
+ * control_system::StateSpace<float, 2, 1, 2> ss({{{1, 0.01}, {0, 1}}}, {{{0}, {0.01}}}, {{{1, 0}, {0, 1}}}, {{{0}, {0}}});
+ * float u = 1, y[2];
+ * ss.Step(&u, y);
+ *
+ * // 单输入单输出，由 Z 传函的分子分母得到（与 Matlab 的 tf2ss 相同的可控标准型）
+ * control_system::SisoStateSpace<float, 2> siso({66, -124, 58}, {1, -0.333, -0.667});
+ * siso.Step(1);
+ *
+ */
+
+#pragma once
+
+#include "discrete_controller_base.hpp"
+#include "instrumentation.hpp"
+#include "z_tf.hpp"
+#include <array>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+
+namespace control_system
+{
+
+/**
+ * @brief 离散状态空间模型
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ * @tparam NX 状态数
+ * @tparam NU 输入数
+ * @tparam NY 输出数
+ */
+template <typename T, size_t NX, size_t NU, size_t NY>
+class StateSpace
+{
+public:
+    // 按行给出的矩阵，例如 MatrixA[i][j] 为 A 的第 i 行第 j 列
+    using MatrixA = std::array<std::array<T, NX>, NX>;
+    using MatrixB = std::array<std::array<T, NU>, NX>;
+    using MatrixC = std::array<std::array<T, NX>, NY>;
+    using MatrixD = std::array<std::array<T, NU>, NY>;
+
+    using State  = std::array<T, NX>;
+    using Input  = std::array<T, NU>;
+    using Output = std::array<T, NY>;
+
+private:
+    // 内部按列存放，例如 a_[j] 为 A 的第 j 列
+    std::array<std::array<T, NX>, NX> a_{};
+    std::array<std::array<T, NX>, NU> b_{};
+    std::array<std::array<T, NY>, NX> c_{};
+    std::array<std::array<T, NY>, NU> d_{};
+
+    State x_{};
+
+    /**
+     * @brief result += M v，其中 M 按列存放
+     *
+     */
+    template <size_t Rows, size_t Cols>
+    static void MultiplyAdd(const std::array<std::array<T, Rows>, Cols> &m, const T *v, T *result)
+    {
+        for (size_t j = 0; j < Cols; j++) {
+            const T vj = v[j];
+            for (size_t i = 0; i < Rows; i++) {
+                result[i] += m[j][i] * vj;
+            }
+        }
+    }
+
+    template <size_t Rows, size_t Cols>
+    static void Transpose(const std::array<std::array<T, Cols>, Rows> &rows, std::array<std::array<T, Rows>, Cols> &columns)
+    {
+        for (size_t i = 0; i < Rows; i++) {
+            for (size_t j = 0; j < Cols; j++) {
+                columns[j][i] = rows[i][j];
+            }
+        }
+    }
+
+    static void StepImpl(const StateSpace &ss, State &x, const T *input, T *output)
+    {
+        Output y{};
+        MultiplyAdd(ss.c_, x.data(), y.data());
+        MultiplyAdd(ss.d_, input, y.data());
+
+        State next{};
+        MultiplyAdd(ss.a_, x.data(), next.data());
+        MultiplyAdd(ss.b_, input, next.data());
+
+        x = next;
+        for (size_t i = 0; i < NY; i++) {
+            output[i] = y[i];
+        }
+    }
+
+public:
+    /**
+     * @brief 创建所有矩阵都为 0 的状态空间模型
+     *
+     */
+    StateSpace(){};
+
+    /**
+     * @brief 创建状态空间模型
+     *
+     * @param A 状态矩阵（按行给出）
+     * @param B 输入矩阵（按行给出）
+     * @param C 输出矩阵（按行给出）
+     * @param D 直通矩阵（按行给出）
+     */
+    StateSpace(const MatrixA &A, const MatrixB &B, const MatrixC &C, const MatrixD &D)
+    {
+        Init(A, B, C, D);
+    }
+
+    /**
+     * @brief 初始化或重新指定矩阵，并重置状态
+     *
+     */
+    void Init(const MatrixA &A, const MatrixB &B, const MatrixC &C, const MatrixD &D)
+    {
+        Transpose(A, a_);
+        Transpose(B, b_);
+        Transpose(C, c_);
+        Transpose(D, d_);
+        ResetState();
+    }
+
+    /**
+     * @brief 由 Z 传函的分子分母得到单输入单输出的状态空间模型（与 Matlab 的 tf2ss 相同的可控标准型）
+     *
+     * @param num 分子
+     * @param den 分母，长度必须为 NX + 1
+     * @note 分子阶数不能大于分母，否则是非因果系统
+     */
+    static StateSpace Tf2Ss(const std::vector<T> &num, const std::vector<T> &den)
+    {
+        static_assert(NU == 1 && NY == 1, "Tf2Ss() 只能用于单输入单输出系统");
+        assert(den.size() == NX + 1);
+        assert(den.at(0) != 0);
+        assert(num.size() <= den.size()); // 分子阶数不能大于分母，否则是非因果系统
+
+        // 与 ZTf::Init() 相同，分子往前面补 0，并除以分母首项
+        std::vector<T> b(den.size() - num.size(), 0), a(den.size());
+        b.insert(b.end(), num.begin(), num.end());
+        for (size_t i = 0; i < den.size(); i++) {
+            a[i] = den[i] / den[0];
+            b[i] = b[i] / den[0];
+        }
+
+        MatrixA A{};
+        MatrixB B{};
+        MatrixC C{};
+        MatrixD D{};
+
+        for (size_t j = 0; j < NX; j++) {
+            A[0][j] = -a[j + 1];
+            C[0][j] = b[j + 1] - b[0] * a[j + 1];
+        }
+        for (size_t i = 1; i < NX; i++) {
+            A[i][i - 1] = 1;
+        }
+        if constexpr (NX > 0) {
+            B[0][0] = 1;
+        }
+        D[0][0] = b[0];
+
+        return StateSpace(A, B, C, D);
+    }
+
+    /**
+     * @brief 走一个周期
+     *
+     * @param input 输入，长度为 NU
+     * @param output 输出，长度为 NY
+     */
+    void Step(const T *input, T *output)
+    {
+        StepImpl(*this, x_, input, output);
+    }
+
+    /**
+     * @brief 走一个周期
+     *
+     * @param input 输入
+     * @return 输出
+     */
+    Output Step(const Input &input)
+    {
+        Output output;
+        StepImpl(*this, x_, input.data(), output.data());
+        return output;
+    }
+
+    /**
+     * @brief 连续走 n 个周期
+     *
+     * @param input 输入，按时间顺序排列，第 k 个周期的输入为 input[k * NU] ... input[k * NU + NU - 1]
+     * @param output 输出，按时间顺序排列，第 k 个周期的输出为 output[k * NY] ... output[k * NY + NY - 1]
+     * @param n 周期数
+     * @note 状态保留在成员变量中：把状态拷贝到局部变量反而会让编译器在每个周期之间插入额外的向量重排，实测更慢
+     */
+    void StepBatch(const T *input, T *output, size_t n)
+    {
+        for (size_t k = 0; k < n; k++) {
+            StepImpl(*this, x_, input + k * NU, output + k * NY);
+        }
+    }
+
+    /**
+     * @brief 重置状态为 0
+     *
+     */
+    void ResetState()
+    {
+        x_.fill(0);
+    }
+
+    const State &GetState() const
+    {
+        return x_;
+    }
+
+    /**
+     * @brief 各矩阵（按行给出，与 Init() 的参数相同）
+     *
+     */
+    MatrixA GetA() const
+    {
+        MatrixA A;
+        Transpose(a_, A);
+        return A;
+    }
+
+    MatrixB GetB() const
+    {
+        MatrixB B;
+        Transpose(b_, B);
+        return B;
+    }
+
+    MatrixC GetC() const
+    {
+        MatrixC C;
+        Transpose(c_, C);
+        return C;
+    }
+
+    MatrixD GetD() const
+    {
+        MatrixD D;
+        Transpose(d_, D);
+        return D;
+    }
+
+    void SetState(const State &x)
+    {
+        x_ = x;
+    }
+};
+
+namespace static_dispatch
+{
+
+/**
+ * @brief 单输入单输出的离散状态空间模型，可以当作控制器使用
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ * @tparam NX 状态数
+ */
+template <typename T, size_t NX>
+class SisoStateSpace : public StateSpace<T, NX, 1, 1>, public StaticControllerBase<SisoStateSpace<T, NX>, T>
+{
+private:
+    using Base = StateSpace<T, NX, 1, 1>;
+
+public:
+    using Base::Base;
+    using Base::Step;
+
+    SisoStateSpace(){};
+
+    SisoStateSpace(const Base &ss)
+        : Base{ss} {};
+
+    /**
+     * @brief 由 Z 传函的分子分母创建（可控标准型）
+     *
+     * @param num 分子
+     * @param den 分母，长度必须为 NX + 1
+     */
+    SisoStateSpace(const std::vector<T> &num, const std::vector<T> &den)
+        : Base{Base::Tf2Ss(num, den)} {};
+
+    /**
+     * @brief 由已经初始化的 ZTf 创建（只使用它的系数）
+     *
+     */
+    SisoStateSpace(const ZTf<T> &ztf)
+    {
+        std::vector<T> den;
+        for (const auto &c : ztf.GetOutputCoefficients()) {
+            den.push_back(-c);
+        }
+        static_cast<Base &>(*this) = Base::Tf2Ss(ztf.GetInputCoefficients(), den);
+    }
+
+    T Step(T input)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("SisoStateSpace::Step");
+        T output;
+        Base::Step(&input, &output);
+        return output;
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        Base::StepBatch(input, output, n);
+    }
+
+    void ResetState()
+    {
+        Base::ResetState();
+    }
+};
+
+} // namespace static_dispatch
+
+/**
+ * @brief 单输入单输出的离散状态空间模型（虚函数接口）
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ * @tparam NX 状态数
+ */
+template <typename T, size_t NX>
+class SisoStateSpace : public DynamicController<static_dispatch::SisoStateSpace<T, NX>, SisoStateSpace<T, NX>>
+{
+public:
+    using DynamicController<static_dispatch::SisoStateSpace<T, NX>, SisoStateSpace<T, NX>>::DynamicController;
+};
+
+} // namespace control_system
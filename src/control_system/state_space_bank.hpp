@@ -0,0 +1,180 @@
+/**
+ * @file state_space_bank.hpp
+ * @author X. Y.
+ * @brief 多通道单输入单输出离散状态空间模型
+ * @version 0.1
+ * @date 2023-08-28
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 与 ZTfBank 类似：同一个状态空间模型同时作用在很多个通道上，所有通道共用一组矩阵，
+ * 各通道的状态按“结构数组”存放，第 i 个状态的所有通道连续存放在一行中，每个周期的运算都是对连续内存的逐元素乘加
+ * 每个通道的运算顺序与 SisoStateSpace::Step() 相同，结果逐位相同
+ *
+ * 使用示例：
+ * control_system::SisoStateSpace<float, 2> plant({0.01, 0.008}, {1, -1.7, 0.72});
+ * control_system::SisoStateSpaceBank<float, 2> bank(plant, 256); // 256 个通道
+ * bank.Step(input, output);                                       // input 和 output 的长度都是 256
+ *
+ */
+
+#pragma once
+
+#include "state_space.hpp"
+#include <array>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <algorithm>
+
+namespace control_system
+{
+
+/**
+ * @brief 多通道单输入单输出离散状态空间模型
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ * @tparam NX 状态数
+ */
+template <typename T, size_t NX>
+class SisoStateSpaceBank
+{
+private:
+    // 每次处理的通道数，一段的中间结果放在栈上的数组里
+    static constexpr size_t kTileSize = 64;
+
+    // 每行的长度向上取整到这个数，使每行的起始地址对齐到 SIMD 宽度
+    static constexpr size_t kRowAlign = 16;
+
+    std::array<std::array<T, NX>, NX> a_{}; // 按行存放
+    std::array<T, NX> b_{}, c_{};
+    T d_ = 0;
+
+    std::vector<T> x_; // NX 行，每行 stride_ 个通道
+
+    size_t channels_ = 0;
+    size_t stride_   = 0;
+
+public:
+    /**
+     * @brief 创建空的多通道状态空间模型
+     * @note 之后必须调用 Init() 才能调用 Step()
+     */
+    SisoStateSpaceBank(){};
+
+    /**
+     * @brief 创建多通道状态空间模型
+     *
+     * @param ss 提供矩阵的状态空间模型（只使用它的矩阵，不使用它的状态）
+     * @param channels 通道数
+     */
+    SisoStateSpaceBank(const StateSpace<T, NX, 1, 1> &ss, size_t channels)
+    {
+        Init(ss, channels);
+    }
+
+    /**
+     * @brief 初始化或重新指定矩阵和通道数，并重置状态
+     *
+     */
+    void Init(const StateSpace<T, NX, 1, 1> &ss, size_t channels)
+    {
+        const auto A = ss.GetA();
+        const auto B = ss.GetB();
+        const auto C = ss.GetC();
+        for (size_t i = 0; i < NX; i++) {
+            a_[i] = A[i];
+            b_[i] = B[i][0];
+            c_[i] = C[0][i];
+        }
+        d_ = ss.GetD()[0][0];
+
+        channels_ = channels;
+        stride_   = (channels + kRowAlign - 1) / kRowAlign * kRowAlign;
+        x_.assign(NX * stride_, 0);
+    }
+
+    /**
+     * @brief 所有通道走一个周期
+     *
+     * @param input 各通道的输入，长度为 Channels()
+     * @param output 各通道的输出，长度为 Channels()，可以与 input 是同一个数组
+     */
+    void Step(const T *input, T *output)
+    {
+        T u[kTileSize], y[kTileSize];
+        T next[NX > 0 ? NX : 1][kTileSize];
+
+        for (size_t begin = 0; begin < channels_; begin += kTileSize) {
+            auto length = std::min(channels_ - begin, kTileSize);
+
+            for (size_t c = 0; c < length; c++) {
+                u[c] = input[begin + c];
+                y[c] = 0;
+            }
+
+            // y = C x + D u，与 StateSpace::StepImpl() 的运算顺序相同
+            for (size_t j = 0; j < NX; j++) {
+                const T cj = c_[j];
+                const T *x = x_.data() + j * stride_ + begin;
+                for (size_t c = 0; c < length; c++) {
+                    y[c] += cj * x[c];
+                }
+            }
+            for (size_t c = 0; c < length; c++) {
+                y[c] += d_ * u[c];
+            }
+
+            // x = A x + B u
+            for (size_t i = 0; i < NX; i++) {
+                for (size_t c = 0; c < length; c++) {
+                    next[i][c] = 0;
+                }
+                for (size_t j = 0; j < NX; j++) {
+                    const T aij = a_[i][j];
+                    const T *x  = x_.data() + j * stride_ + begin;
+                    for (size_t c = 0; c < length; c++) {
+                        next[i][c] += aij * x[c];
+                    }
+                }
+                const T bi = b_[i];
+                for (size_t c = 0; c < length; c++) {
+                    next[i][c] += bi * u[c];
+                }
+            }
+
+            for (size_t i = 0; i < NX; i++) {
+                std::copy(next[i], next[i] + length, x_.data() + i * stride_ + begin);
+            }
+            std::copy(y, y + length, output + begin);
+        }
+    }
+
+    /**
+     * @brief 重置所有通道的状态
+     *
+     */
+    void ResetState()
+    {
+        std::fill(x_.begin(), x_.end(), 0);
+    }
+
+    /**
+     * @brief 只重置某一个通道的状态
+     *
+     */
+    void ResetState(size_t channel)
+    {
+        assert(channel < channels_);
+        for (size_t i = 0; i < NX; i++) {
+            x_[i * stride_ + channel] = 0;
+        }
+    }
+
+    size_t Channels() const
+    {
+        return channels_;
+    }
+};
+
+} // namespace control_system
@@ -0,0 +1,244 @@
+/**
+ * @file static_z_tf.hpp
+ * @author X. Y.
+ * @brief 编译期固定阶数的 Z 传递函数
+ * @version 0.2
+ * @date 2023-07-20
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 与 ZTf 的用法相同，但阶数在编译期确定：
+ * 系数和历史数据都存放在 std::array 中，Step() 在编译期完全展开，没有循环和运行时的阶数判断
+ * 为了缩短相邻两次 Step() 之间的数据依赖，求和顺序与 ZTf 不同，因此结果与 ZTf 只在舍入误差范围内相同
+ *
+ * 使用示例：
+ * control_system::StaticZTf<float, 2> ztf({66, -124, 58}, {1, -0.333, -0.667}); // 2 阶传递函数
+ *
+ */
+
+#pragma once
+
+#include "discrete_controller_base.hpp"
+#include "instrumentation.hpp"
+#include <array>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+namespace control_system
+{
+
+namespace static_dispatch
+{
+
+/**
+ * @brief 固定阶数的 Z 传递函数
+ *
+ * @tparam T 数据类型，例如 float 或 double，也可以是定点数（fixed_point.hpp），此时分子分母为 double
+ * @tparam N 系统阶数（等于分母阶数）
+ */
+template <typename T, size_t N>
+class StaticZTf : public StaticControllerBase<StaticZTf<T, N>, T>
+{
+public:
+    using CoefficientArray = std::array<CoefficientType<T>, N + 1>;
+
+    /**
+     * @brief 一组完整的系数
+     *
+     */
+    struct Coefficients {
+        CoefficientArray input_c, output_c;
+    };
+
+private:
+    using History = std::array<T, N>;
+
+    CoefficientArray input_c_{}, output_c_{}; // 输入系数 i0, i1, ... 和输出系数 o0, o1, ...
+    History last_inputs_{}, last_outputs_{}; // 历史输入和历史输出，从新到旧排列
+
+    template <size_t... I>
+    static T Accumulate(const CoefficientArray &input_c, const CoefficientArray &output_c,
+                        const History &last_inputs, const History &last_outputs,
+                        T input, std::index_sequence<I...>)
+    {
+        // 输入项与输出项分开累加，历史数据从旧到新加，上一次的输出 last_outputs[0] 最后才加上，
+        // 这样相邻两次 Step() 之间的数据依赖只有一次乘法和一次加法，其余部分可以提前并行计算
+        T input_sum  = input_c[N] * last_inputs[N - 1];
+        T output_sum = 0;
+        ((input_sum += input_c[N - 1 - I] * last_inputs[N - 2 - I]), ...);
+        ((output_sum += output_c[N - I] * last_outputs[N - 1 - I]), ...);
+        return ((input_sum + input_c[0] * input) + output_sum) + output_c[1] * last_outputs[0];
+    }
+
+    template <size_t... I>
+    static void Shift(History &last_inputs, History &last_outputs, std::index_sequence<I...>)
+    {
+        // 从最旧的数据开始，依次往后挪一格
+        ((last_inputs[N - 1 - I] = last_inputs[N - 2 - I], last_outputs[N - 1 - I] = last_outputs[N - 2 - I]), ...);
+    }
+
+    static T StepImpl(const CoefficientArray &input_c, const CoefficientArray &output_c,
+                      History &last_inputs, History &last_outputs, T input)
+    {
+        T output;
+
+        if constexpr (N == 0) {
+            output = input_c[0] * input;
+        } else {
+            output = Accumulate(input_c, output_c, last_inputs, last_outputs, input, std::make_index_sequence<N - 1>{});
+
+            Shift(last_inputs, last_outputs, std::make_index_sequence<N - 1>{});
+            last_inputs[0]  = input;
+            last_outputs[0] = output;
+        }
+
+        return output;
+    }
+
+public:
+    /**
+     * @brief 创建空的 Z 传函
+     * @note 由于没有分子和分母，之后必须调用 Init() 指定分子和分母才能调用 Step()
+     */
+    StaticZTf(){};
+
+    /**
+     * @brief 创建一个 Z 传函
+     *
+     * @param num 分子
+     * @param den 分母，长度必须为 N + 1
+     * @note 分子阶数不能大于分母，否则是非因果系统
+     */
+    StaticZTf(const std::vector<ParamType<T>> &num, const std::vector<ParamType<T>> &den)
+    {
+        Init(num, den);
+    }
+
+    /**
+     * @brief 初始化 Z 传函或重新指定 Z 传函的表达式
+     *
+     * @param num 分子
+     * @param den 分母，长度必须为 N + 1
+     * @note 分子阶数不能大于分母，否则是非因果系统
+     */
+    void Init(const std::vector<ParamType<T>> &num, const std::vector<ParamType<T>> &den)
+    {
+        SetCoefficients(MakeCoefficients(num, den));
+        ResetState();
+    }
+
+    /**
+     * @brief 由分子和分母算出一组系数，可以在其他线程中调用
+     *
+     * @param num 分子
+     * @param den 分母，长度必须为 N + 1
+     */
+    static Coefficients MakeCoefficients(const std::vector<ParamType<T>> &num, const std::vector<ParamType<T>> &den)
+    {
+        assert(den.size() == N + 1); // 分母阶数必须与模板参数一致
+        assert(den.at(0) != 0);
+
+        int size_diff = den.size() - num.size(); // 分母维数与分子维数之差
+        assert(size_diff >= 0);                  // 分子阶数不能大于分母，否则是非因果系统
+
+        Coefficients coefficients{};
+
+        // 如果分子阶数小于分母，就往前面补一些 0
+        for (int i = 0; i < size_diff; i++) {
+            coefficients.input_c.at(i) = CoefficientType<T>(0);
+        }
+
+        // 剩下的输入系数
+        for (size_t i = size_diff; i < N + 1; i++) {
+            coefficients.input_c.at(i) = CoefficientType<T>(num.at(i - size_diff) / den.at(0));
+        }
+
+        // 输出系数
+        for (size_t i = 0; i < N + 1; i++) {
+            coefficients.output_c.at(i) = CoefficientType<T>(-den.at(i) / den.at(0));
+        }
+
+        return coefficients;
+    }
+
+    /**
+     * @brief 一次性替换所有系数，内部状态保留
+     *
+     */
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        input_c_  = coefficients.input_c;
+        output_c_ = coefficients.output_c;
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {input_c_, output_c_};
+    }
+
+    /**
+     * @brief 走一个周期
+     *
+     * @param input 输入
+     * @return 输出
+     */
+    T Step(T input)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("StaticZTf::Step");
+        return StepImpl(input_c_, output_c_, last_inputs_, last_outputs_, input);
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        // 拷贝到局部变量中，编译器才能在整个数据块内把它们放在寄存器里
+        const auto input_c  = input_c_;
+        const auto output_c = output_c_;
+        auto last_inputs    = last_inputs_;
+        auto last_outputs   = last_outputs_;
+
+        for (size_t i = 0; i < n; i++) {
+            output[i] = StepImpl(input_c, output_c, last_inputs, last_outputs, input[i]);
+        }
+
+        last_inputs_  = last_inputs;
+        last_outputs_ = last_outputs;
+    }
+
+    /**
+     * @brief 重置内部状态
+     *
+     */
+    void ResetState()
+    {
+        last_inputs_.fill(0);
+        last_outputs_.fill(0);
+    }
+
+    /**
+     * @brief 系统阶数
+     *
+     */
+    static constexpr size_t Order()
+    {
+        return N;
+    }
+};
+
+} // namespace static_dispatch
+
+/**
+ * @brief 固定阶数的 Z 传递函数（虚函数接口）
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ * @tparam N 系统阶数（等于分母阶数）
+ */
+template <typename T, size_t N>
+class StaticZTf : public DynamicController<static_dispatch::StaticZTf<T, N>, StaticZTf<T, N>>
+{
+public:
+    using DynamicController<static_dispatch::StaticZTf<T, N>, StaticZTf<T, N>>::DynamicController;
+};
+
+} // namespace control_system
@@ -0,0 +1,504 @@
+/**
+ * @file trace_recorder.hpp
+ * @author X. Y.
+ * @brief 信号记录：控制线程无锁写入，后台线程按列写入二进制文件
+ * @version 0.1
+ * @date 2023-08-24
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * - TraceChannel 是一个通道，每条记录由一个 tick（采样序号或时间戳）和 N 个值组成，大小固定
+ *   每个控制线程使用自己的通道（单生产者），Record() 只是写入一个 SpscRing，缓冲区满时丢弃这条记录并计数，从不等待
+ * - TraceWriter 持有一个后台线程，定期把各通道中的记录取出，转置为按列存放的块，写入各自的文件
+ * - LoadTrace() 把文件读回内存
+ *
+ * 文件格式（本机字节序）：
+ * - 文件头 TraceFileHeader（32 字节），之后是各列的名称，以 '\0' 分隔，补零到 8 字节对齐，共 names_size 字节
+ * - 之后是若干个块，每块为块头 TraceBlockHeader（32 字节）、count 个 uint64_t 的 tick、
+ *   然后依次是每一列的 count 个值，每一列补零到 8 字节对齐
+ * - 块头中的 dropped 是写这个块时该通道累计丢弃的记录数；关闭文件时再写一个 count 为 0 的块，记录最终的丢弃数
+ *
+ * 每写一块都检查 fwrite() 和 fflush() 的结果。写文件失败（例如磁盘已满）后，这个文件不再写入，之后取出的记录都计为丢失，
+ * 用 TraceWriter::HasWriteError() 和 GetLost() 查询。这样的文件最后一块可能不完整，LoadTrace() 返回 false，
+ * 但 data 中保留了之前完整的各块
+ *
+ * 使用示例：
+ * control_system::TraceChannel<float, 3> channel({"input", "output", "integrator"});
+ * control_system::TraceWriter writer;
+ * writer.Add(channel, "pid.trace");
+ * writer.Start();
+ * for (uint64_t tick = 0;; tick++) {                 // 控制线程
+ *     auto output = pid_controller.Step(input);
+ *     channel.Record(tick, input, output, pid_controller.i_controller.GetStateOutput());
+ * }
+ * writer.Stop();                                      // 写出剩余的记录并关闭文件
+ *
+ */
+
+#pragma once
+
+#include "spsc_ring.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace control_system
+{
+
+constexpr char kTraceFileMagic[8] = {'C', 'S', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr uint32_t kTraceFileVersion = 1;
+constexpr uint32_t kTraceBlockMagic  = 0x4B425343; // "CSBK"
+
+struct TraceFileHeader {
+    char magic[8];          // kTraceFileMagic
+    uint32_t version;       // kTraceFileVersion
+    uint32_t value_size;    // 每个值的字节数
+    uint32_t is_floating;   // 值是否为浮点数
+    uint32_t column_count;  // 值的列数（不含 tick）
+    uint32_t names_size;    // 列名部分的字节数（已对齐到 8 字节）
+    uint32_t reserved;
+};
+
+struct TraceBlockHeader {
+    uint32_t magic;         // kTraceBlockMagic
+    uint32_t count;         // 本块的记录数
+    uint64_t first_tick;    // 本块第一条记录的 tick
+    uint64_t dropped;       // 写本块时累计丢弃的记录数
+    uint64_t payload_size;  // 块头之后的字节数
+};
+
+static_assert(sizeof(TraceFileHeader) == 32, "TraceFileHeader 应为 32 字节");
+static_assert(sizeof(TraceBlockHeader) == 32, "TraceBlockHeader 应为 32 字节");
+
+inline constexpr size_t TraceAlign8(size_t size)
+{
+    return (size + 7) & ~size_t(7);
+}
+
+/**
+ * @brief 一个记录通道，由一个线程写入，由 TraceWriter 的后台线程读出
+ *
+ * @tparam T 值的类型
+ * @tparam N 每条记录的值的个数
+ */
+template <typename T, size_t N>
+class TraceChannel
+{
+    static_assert(std::is_arithmetic<T>::value, "T 应为算术类型");
+
+public:
+    struct Sample {
+        uint64_t tick;
+        std::array<T, N> values;
+    };
+
+private:
+    SpscRing<Sample> ring_;
+    std::array<std::string, N> names_;
+    // 只由写入的线程修改，其他线程可以随时读
+    std::atomic<uint64_t> recorded_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+public:
+    /**
+     * @brief 创建记录通道
+     *
+     * @param names 各列的名称
+     * @param capacity 缓冲区能容纳的记录数，应大于后台线程两次写文件之间的记录数
+     */
+    explicit TraceChannel(const std::array<std::string, N> &names, size_t capacity = 1 << 14)
+        : ring_(capacity), names_(names) {};
+
+    /**
+     * @brief 记录一条数据，只能在一个线程中调用
+     *
+     * @return 缓冲区已满时返回 false，这条记录被丢弃并计数
+     */
+    bool Push(const Sample &sample)
+    {
+        if (ring_.TryPush(sample)) {
+            recorded_.store(recorded_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    template <typename... Values>
+    bool Record(uint64_t tick, Values... values)
+    {
+        static_assert(sizeof...(Values) == N, "值的个数应等于 N");
+        return Push(Sample{tick, {{static_cast<T>(values)...}}});
+    }
+
+    /**
+     * @brief 取出至多 max_count 条记录，只能在一个线程中调用（通常为 TraceWriter 的后台线程）
+     *
+     */
+    size_t Drain(Sample *output, size_t max_count)
+    {
+        return ring_.Pop(output, max_count);
+    }
+
+    uint64_t GetRecorded() const
+    {
+        return recorded_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t GetDropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    const std::array<std::string, N> &GetNames() const
+    {
+        return names_;
+    }
+};
+
+/**
+ * @brief 后台线程，把各个通道中的记录写入文件
+ *
+ */
+class TraceWriter
+{
+private:
+    class SinkBase
+    {
+    protected:
+        // 只由写文件的线程修改，其他线程可以随时读
+        std::atomic<uint64_t> lost_{0};    // 已经从通道中取出、但没能写入文件的记录数
+        std::atomic<bool> write_error_{false};
+
+    public:
+        virtual ~SinkBase() = default;
+        virtual size_t Flush() = 0; // 写出一块，返回记录数（包括写文件失败或文件已关闭而丢失的）
+        virtual void Close()   = 0;
+
+        uint64_t GetLost() const
+        {
+            return lost_.load(std::memory_order_relaxed);
+        }
+
+        bool HasWriteError() const
+        {
+            return write_error_.load(std::memory_order_relaxed);
+        }
+    };
+
+    template <typename T, size_t N>
+    class Sink : public SinkBase
+    {
+    private:
+        using Sample = typename TraceChannel<T, N>::Sample;
+
+        TraceChannel<T, N> &channel_;
+        FILE *file_;
+        std::vector<Sample> samples_;
+        std::vector<unsigned char> block_;
+
+        /**
+         * @brief 写入并立即 fflush()，失败时记录错误，之后不再写这个文件
+         *
+         */
+        bool Write(const void *data, size_t size)
+        {
+            if (write_error_.load(std::memory_order_relaxed)) return false;
+            if (std::fwrite(data, 1, size, file_) == size && std::fflush(file_) == 0) return true;
+
+            write_error_.store(true, std::memory_order_relaxed);
+            return false;
+        }
+
+    public:
+        Sink(TraceChannel<T, N> &channel, FILE *file, size_t block_size)
+            : channel_{channel}, file_{file}, samples_(block_size)
+        {
+            const auto &names = channel_.GetNames();
+            std::vector<char> name_bytes;
+            for (const auto &name : names) {
+                name_bytes.insert(name_bytes.end(), name.begin(), name.end());
+                name_bytes.push_back('\0');
+            }
+            name_bytes.resize(TraceAlign8(name_bytes.size()), '\0');
+
+            TraceFileHeader header{};
+            std::memcpy(header.magic, kTraceFileMagic, sizeof(header.magic));
+            header.version      = kTraceFileVersion;
+            header.value_size   = sizeof(T);
+            header.is_floating  = std::is_floating_point<T>::value;
+            header.column_count = N;
+            header.names_size   = static_cast<uint32_t>(name_bytes.size());
+            if (std::fwrite(&header, sizeof(header), 1, file_) == 1) {
+                Write(name_bytes.data(), name_bytes.size());
+            } else {
+                write_error_.store(true, std::memory_order_relaxed);
+            }
+
+            const size_t column_size = TraceAlign8(block_size * sizeof(T));
+            block_.resize(sizeof(TraceBlockHeader) + block_size * sizeof(uint64_t) + N * column_size);
+        }
+
+        ~Sink() override
+        {
+            Close();
+        }
+
+        size_t Flush() override
+        {
+            const size_t count = channel_.Drain(samples_.data(), samples_.size());
+            if (count == 0) return 0;
+            // 文件已经关闭（Stop() 之后又有记录）或写入失败：取出的记录算作丢失
+            if (file_ == nullptr || HasWriteError()) {
+                lost_.store(GetLost() + count, std::memory_order_relaxed);
+                return count;
+            }
+
+            // 转置为按列存放
+            const size_t column_size = TraceAlign8(count * sizeof(T));
+            TraceBlockHeader header{};
+            header.magic        = kTraceBlockMagic;
+            header.count        = static_cast<uint32_t>(count);
+            header.first_tick   = samples_[0].tick;
+            header.dropped      = channel_.GetDropped();
+            header.payload_size = count * sizeof(uint64_t) + N * column_size;
+
+            auto *out = block_.data();
+            std::memcpy(out, &header, sizeof(header));
+            out += sizeof(header);
+            for (size_t i = 0; i < count; i++) {
+                std::memcpy(out + i * sizeof(uint64_t), &samples_[i].tick, sizeof(uint64_t));
+            }
+            out += count * sizeof(uint64_t);
+            for (size_t column = 0; column < N; column++) {
+                for (size_t i = 0; i < count; i++) {
+                    std::memcpy(out + i * sizeof(T), &samples_[i].values[column], sizeof(T));
+                }
+                std::memset(out + count * sizeof(T), 0, column_size - count * sizeof(T));
+                out += column_size;
+            }
+
+            if (!Write(block_.data(), out - block_.data())) {
+                lost_.store(GetLost() + count, std::memory_order_relaxed);
+            }
+            return count;
+        }
+
+        void Close() override
+        {
+            if (file_ == nullptr) return;
+
+            while (Flush() != 0) {
+            }
+
+            TraceBlockHeader trailer{};
+            trailer.magic   = kTraceBlockMagic;
+            trailer.dropped = channel_.GetDropped();
+            Write(&trailer, sizeof(trailer));
+            if (std::fclose(file_) != 0) {
+                write_error_.store(true, std::memory_order_relaxed);
+            }
+            file_ = nullptr;
+        }
+    };
+
+    std::vector<std::unique_ptr<SinkBase>> sinks_;
+    std::chrono::nanoseconds period_;
+    size_t block_size_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    void Run()
+    {
+        while (running_.load(std::memory_order_acquire)) {
+            // 有通道写满了一整块就马上再取一次，否则等一个周期
+            if (FlushAll() < block_size_) {
+                std::this_thread::sleep_for(period_);
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief 创建写文件的后台线程（调用 Start() 后才开始运行）
+     *
+     * @param period 两次写文件之间的间隔
+     * @param block_size 每块的最大记录数
+     */
+    explicit TraceWriter(std::chrono::nanoseconds period = std::chrono::milliseconds(10), size_t block_size = 4096)
+        : period_{period}, block_size_{block_size} {};
+
+    TraceWriter(const TraceWriter &)            = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    ~TraceWriter()
+    {
+        Stop();
+    }
+
+    /**
+     * @brief 把一个通道写到文件 path，应在 Start() 之前调用
+     *
+     * @return 文件无法打开或无法写入文件头时返回 false
+     */
+    template <typename T, size_t N>
+    bool Add(TraceChannel<T, N> &channel, const std::string &path)
+    {
+        assert(!running_.load());
+
+        FILE *file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) return false;
+
+        std::unique_ptr<Sink<T, N>> sink(new Sink<T, N>(channel, file, block_size_));
+        if (sink->HasWriteError()) return false; // 析构时关闭文件
+
+        sinks_.emplace_back(std::move(sink));
+        return true;
+    }
+
+    /**
+     * @brief 把各通道中现有的记录写一块到文件，返回各通道写出的最大记录数
+     * @note 没有调用 Start() 时，也可以在其他线程中自己定期调用
+     */
+    size_t FlushAll()
+    {
+        size_t max_count = 0;
+        for (auto &sink : sinks_) {
+            max_count = std::max(max_count, sink->Flush());
+        }
+        return max_count;
+    }
+
+    /**
+     * @brief 是否有文件写入失败（例如磁盘已满），失败的文件之后不再写入
+     *
+     */
+    bool HasWriteError() const
+    {
+        for (const auto &sink : sinks_) {
+            if (sink->HasWriteError()) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 因为写文件失败而丢失的记录数，不包括通道缓冲区满时丢弃的记录（TraceChannel::GetDropped()）
+     *
+     */
+    uint64_t GetLost() const
+    {
+        uint64_t lost = 0;
+        for (const auto &sink : sinks_) {
+            lost += sink->GetLost();
+        }
+        return lost;
+    }
+
+    void Start()
+    {
+        if (running_.exchange(true)) return;
+        thread_ = std::thread(&TraceWriter::Run, this);
+    }
+
+    /**
+     * @brief 停止后台线程，写出剩余的记录并关闭所有文件
+     *
+     */
+    void Stop()
+    {
+        if (running_.exchange(false)) {
+            thread_.join();
+        }
+        for (auto &sink : sinks_) {
+            sink->Close();
+        }
+    }
+};
+
+/**
+ * @brief 读回的记录文件
+ *
+ */
+template <typename T>
+struct TraceData {
+    std::vector<std::string> names;
+    std::vector<uint64_t> ticks;
+    std::vector<std::vector<T>> columns; // columns[i][k] 为第 i 列的第 k 条记录
+    uint64_t dropped = 0;                // 累计丢弃的记录数
+};
+
+/**
+ * @brief 读取 TraceWriter 写出的文件
+ *
+ * @return 文件无法打开、格式或值的类型不符、块的长度与记录数不符或不完整时返回 false（data 中保留之前完整的块）
+ */
+template <typename T>
+bool LoadTrace(const std::string &path, TraceData<T> &data)
+{
+    std::unique_ptr<FILE, int (*)(FILE *)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!file) return false;
+
+    TraceFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, file.get()) != 1) return false;
+    if (std::memcmp(header.magic, kTraceFileMagic, sizeof(header.magic)) != 0 || header.version != kTraceFileVersion ||
+        header.value_size != sizeof(T) || bool(header.is_floating) != std::is_floating_point<T>::value) {
+        return false;
+    }
+
+    std::vector<char> name_bytes(header.names_size);
+    if (std::fread(name_bytes.data(), 1, name_bytes.size(), file.get()) != name_bytes.size()) return false;
+
+    data = TraceData<T>{};
+    for (size_t begin = 0; data.names.size() < header.column_count && begin < name_bytes.size();) {
+        data.names.emplace_back(name_bytes.data() + begin);
+        begin += data.names.back().size() + 1;
+    }
+    data.columns.resize(header.column_count);
+
+    TraceBlockHeader block;
+    std::vector<unsigned char> payload;
+    while (std::fread(&block, sizeof(block), 1, file.get()) == 1) {
+        if (block.magic != kTraceBlockMagic) return false;
+        data.dropped = block.dropped;
+
+        // 块的长度必须正好是 count 个 tick 加上每列 count 个值，否则后面按列复制时会越界（用除法比较，避免乘法溢出）
+        const uint64_t tick_size   = uint64_t(block.count) * sizeof(uint64_t);
+        const uint64_t column_size = (uint64_t(block.count) * sizeof(T) + 7) & ~uint64_t(7);
+        if (tick_size > block.payload_size) return false;
+        const uint64_t columns_size = block.payload_size - tick_size;
+        if (header.column_count == 0 ? columns_size != 0
+                                     : (columns_size % header.column_count != 0 || columns_size / header.column_count != column_size)) {
+            return false;
+        }
+
+        payload.resize(block.payload_size);
+        if (std::fread(payload.data(), 1, payload.size(), file.get()) != payload.size()) return false;
+
+        const size_t count = block.count;
+        const auto *in     = payload.data();
+        const size_t old   = data.ticks.size();
+        data.ticks.resize(old + count);
+        std::memcpy(data.ticks.data() + old, in, count * sizeof(uint64_t));
+        in += count * sizeof(uint64_t);
+        for (auto &column : data.columns) {
+            column.resize(old + count);
+            std::memcpy(column.data() + old, in, count * sizeof(T));
+            in += TraceAlign8(count * sizeof(T));
+        }
+    }
+    return true;
+}
+
+} // namespace control_system
@@ -0,0 +1,165 @@
+/**
+ * @file triple_buffer.hpp
+ * @author X. Y.
+ * @brief 在线修改控制器参数：无锁的三缓冲
+ * @version 0.1
+ * @date 2023-08-14
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 调参线程（非实时）直接调用控制器的 SetParam() 或 Init() 时，控制线程可能读到一半新一半旧的参数，
+ * 加锁又会让控制线程等待调参线程。这里的做法是：
+ * - 调参线程用控制器的 MakeCoefficients() 算好一整组系数（包括 UpdateCoefficient() 中的计算），写入三缓冲并发布
+ * - 控制线程在采样周期开始时检查有没有新的一组，有就用 SetCoefficients() 整组替换，只是拷贝，不加锁、不分配内存、不等待
+ * - 内部状态（积分值、历史数据）不变，参数切换发生在两个采样周期之间
+ *
+ * 三个缓冲区分别由写者、读者和 “中间” 占有，发布和取用都只是交换一个下标：
+ * 写者总有一个缓冲区可写，读者总能读到最近一次发布的完整的一组；写者连续发布多次时，读者只看到最后一次
+ *
+ * 使用示例：
+ * control_system::pid::PID<float> pid_controller{1.23, 0.54, 0, 1000, 0.01};
+ * control_system::CoefficientChannel<control_system::pid::PID<float>::Coefficients> channel{pid_controller.GetCoefficients()};
+ *
+ * // 调参线程
+ * channel.Publish(control_system::pid::PID<float>::MakeCoefficients(1.5, 0.6, 0, 1000, 0.01, {-10, 10})); // 最后是积分限幅
+ *
+ * // 控制线程
+ * channel.Apply(pid_controller);
+ * output = pid_controller.Step(input);
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace control_system
+{
+
+/**
+ * @brief 单写单读、无锁的三缓冲
+ * @note 一个线程只调用写者一侧的函数（Back、Publish、Write），另一个线程只调用读者一侧的函数（Update、Front）
+ *
+ * @tparam T 数据类型
+ */
+template <typename T>
+class TripleBuffer
+{
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kDirty     = 0x4; // 中间的缓冲区是新发布的，读者还没有取走
+
+    std::array<T, 3> buffers_;
+
+    alignas(64) std::atomic<uint8_t> middle_{1}; // 低两位为中间缓冲区的下标
+    alignas(64) uint8_t back_  = 0;              // 写者占有
+    alignas(64) uint8_t front_ = 2;              // 读者占有
+
+public:
+    TripleBuffer(const T &initial_value = T{})
+        : buffers_{initial_value, initial_value, initial_value} {};
+
+    TripleBuffer(const TripleBuffer &)            = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    /**
+     * @brief 写者正在写的缓冲区，写完后调用 Publish()
+     *
+     */
+    T &Back()
+    {
+        return buffers_[back_];
+    }
+
+    /**
+     * @brief 发布 Back() 中的数据，之后 Back() 指向另一个缓冲区
+     *
+     */
+    void Publish()
+    {
+        auto previous = middle_.exchange(back_ | kDirty, std::memory_order_acq_rel);
+        back_         = previous & kIndexMask;
+    }
+
+    /**
+     * @brief 写入并发布
+     *
+     */
+    void Write(const T &value)
+    {
+        Back() = value;
+        Publish();
+    }
+
+    /**
+     * @brief 取走最近一次发布的数据
+     *
+     * @return 有新数据时返回 true，此时 Front() 指向新数据
+     */
+    bool Update()
+    {
+        if ((middle_.load(std::memory_order_relaxed) & kDirty) == 0) return false;
+
+        auto previous = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_        = previous & kIndexMask;
+        return true;
+    }
+
+    /**
+     * @brief 读者当前占有的数据，直到下一次 Update() 返回 true 之前都不会被改写
+     *
+     */
+    const T &Front() const
+    {
+        return buffers_[front_];
+    }
+};
+
+/**
+ * @brief 把一组系数从调参线程传给控制线程
+ *
+ * @tparam Coefficients 控制器的系数类型，例如 pid::PID<float>::Coefficients
+ */
+template <typename Coefficients>
+class CoefficientChannel
+{
+private:
+    TripleBuffer<Coefficients> buffer_;
+
+public:
+    /**
+     * @brief 创建通道
+     *
+     * @param initial 初始系数，通常为控制器的 GetCoefficients()。
+     *                ZTf、SosFilter 的系数中有 std::vector，三个缓冲区都先按它分配好，之后发布同样阶数的系数时不再分配内存
+     */
+    explicit CoefficientChannel(const Coefficients &initial = Coefficients{})
+        : buffer_{initial} {};
+
+    /**
+     * @brief 发布一组新系数（在调参线程中调用）
+     *
+     */
+    void Publish(const Coefficients &coefficients)
+    {
+        buffer_.Write(coefficients);
+    }
+
+    /**
+     * @brief 如果有新系数，就替换到 controller 中（在控制线程中，每个采样周期开始时调用）
+     *
+     * @return 替换了系数时返回 true
+     */
+    template <typename Controller>
+    bool Apply(Controller &controller)
+    {
+        if (!buffer_.Update()) return false;
+
+        controller.SetCoefficients(buffer_.Front());
+        return true;
+    }
+};
+
+} // namespace control_system
@@ -0,0 +1,612 @@
+/**
+ * @file variable_ts.hpp
+ * @author X. Y.
+ * @brief 采样周期可变的控制器
+ * @version 0.1
+ * @date 2023-09-04
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 实际的控制周期常有抖动（例如总线周期 ±15%），而 D、ZTf 的系数都是按固定的 Ts 算好的，积分项和微分项会随抖动漂移
+ * 这里的控制器多了一个 Step(input, dt)，每次传入实测的周期：
+ * - 积分器（VariableTsIntegrator）记住上一步的输入，按梯形在这一周期上积分，系数 Ki * dt / 2 只需一次乘法，不量化；
+ *   固定周期的 DiscreteIntegrator 不保存上一步的输入，Step() 和 StepBlock() 没有额外的开销
+ * - 微分器和由 s 传递函数双线性变换（Tustin）得到的 ZTf，系数要做除法或 O(n²) 的运算，
+ *   把 dt 按 dt_resolution 量化后查一个小的直接映射缓存（TsCoefficientCache），抖动的范围内通常都能命中，只在未命中时计算
+ * - dt 等于 Ts，或量化后与 Ts 相同时，走与固定周期的控制器完全相同的路径（逐位相同）
+ * - dt 不是正数（包括 NaN）时按名义周期 Ts 计算；比 dt_resolution 还小的正数按 dt_resolution 计算，
+ *   过大的 dt 也有上限，Release 下也不会算出 NaN 系数
+ * - Step(input) 和 StepBlock() 仍按固定的 Ts 运行
+ *
+ * 使用示例：
+ * control_system::pid::VariableTsPID<float> pid_controller{1.23, 0.54, 0.01, 100, 0.001}; // 名义周期 1 ms
+ * output = pid_controller.Step(error, measured_dt);                                    // 每个周期传入实测的 dt
+ *
+ * control_system::VariableTsZTf<float> filter({1}, {0.01, 1}, 0.001); // 1 / (0.01 s + 1)，名义周期 1 ms
+ * output = filter.Step(input, measured_dt);
+ *
+ */
+
+#pragma once
+
+#include "discrete_controller_base.hpp"
+#include "instrumentation.hpp"
+#include "discrete_integrator.hpp"
+#include "pid_controller.hpp"
+#include "z_tf.hpp"
+#include <array>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace control_system
+{
+
+/**
+ * @brief 按量化后的采样周期缓存的系数，直接映射，没有分配
+ *
+ * @tparam T 数据类型
+ * @tparam Coefficients 一组系数
+ * @tparam Size 缓存的组数，必须是 2 的幂
+ */
+template <typename T, typename Coefficients, size_t Size = 64>
+class TsCoefficientCache
+{
+private:
+    static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Size must be a power of 2");
+
+    static constexpr int64_t kEmpty  = std::numeric_limits<int64_t>::min();
+    static constexpr int64_t kMaxKey = int64_t(1) << 52; // 再大 double 就不能精确表示了
+
+    T resolution_, inverse_resolution_;
+    std::array<int64_t, Size> keys_;
+    std::array<Coefficients, Size> entries_;
+    size_t misses_ = 0;
+
+public:
+    /**
+     * @brief 创建缓存
+     *
+     * @param resolution 采样周期的量化间隔（秒）
+     * @param prototype 每一组系数的初值，系数中有 vector 时应预先分配好长度，之后计算系数时不再分配
+     */
+    explicit TsCoefficientCache(T resolution, const Coefficients &prototype = Coefficients{})
+        : resolution_{resolution}, inverse_resolution_{1 / resolution}
+    {
+        assert(resolution > 0);
+        entries_.fill(prototype);
+        Clear();
+    }
+
+    /**
+     * @brief 量化后的采样周期为 Key(dt) * resolution
+     * @note 结果限制在 [1, 2^52] 内：dt 小于 resolution / 2（包括 0、负数和 NaN）时为 1，量化后的周期不会为 0
+     */
+    int64_t Key(T dt) const
+    {
+        const T scaled = dt * inverse_resolution_;
+        if (!(scaled >= 1)) return 1;
+        if (!(scaled < T(kMaxKey))) return kMaxKey;
+        return std::llround(scaled);
+    }
+
+    /**
+     * @brief 取出 key 对应的系数，未命中时调用 make(量化后的采样周期, 系数) 在缓存中计算
+     *
+     */
+    template <typename Make>
+    const Coefficients &Get(int64_t key, Make &&make)
+    {
+        const size_t slot = size_t(key) & (Size - 1);
+        if (keys_[slot] != key) {
+            make(T(key) * resolution_, entries_[slot]);
+            keys_[slot] = key;
+            misses_++;
+        }
+        return entries_[slot];
+    }
+
+    /**
+     * @brief 清空缓存，参数改变时调用
+     *
+     */
+    void Clear()
+    {
+        keys_.fill(kEmpty);
+    }
+
+    /**
+     * @brief 未命中的次数
+     *
+     */
+    size_t GetMisses() const
+    {
+        return misses_;
+    }
+
+    T GetResolution() const
+    {
+        return resolution_;
+    }
+};
+
+namespace static_dispatch
+{
+
+/**
+ * @brief 采样周期可变的积分器，Step(input) 和 StepBlock() 与 Integrator 逐位相同
+ *
+ * Step(input, dt) 按梯形在这一周期上积分：y[k] = y[k-1] + Ki * dt / 2 * (u[k-1] + u[k])
+ * Integrator 的状态 x_ 中已经按 Ts 加上了 u[k-1] 的一半，先减掉，再按 dt 加上 u[k-1] 和 u[k] 的梯形。
+ * 两个输入分别乘以系数再相加，定点数时不会因为 u[k-1] + u[k] 在信号的类型中饱和而出错
+ *
+ * @tparam Integrator DiscreteIntegrator<T> 或 DiscreteIntegratorSaturation<T>（此时结果按积分限幅）
+ */
+template <typename Integrator>
+class VariableTsIntegratorBase : public Integrator
+{
+private:
+    using T = typename Integrator::ValueType;
+
+    static constexpr bool kSaturated = std::is_base_of<DiscreteIntegratorSaturation<T>, Integrator>::value;
+
+    T last_input_ = 0; // 上一步的输入 u[k-1]
+
+public:
+    using Integrator::Integrator;
+
+    VariableTsIntegratorBase(const Integrator &integrator)
+        : Integrator{integrator} {};
+
+    T Step(T input)
+    {
+        last_input_ = input;
+        return Integrator::Step(input);
+    }
+
+    /**
+     * @brief 以实测的采样周期 dt 走一个周期（上一个输入与这一个输入之间的间隔为 dt）
+     *
+     * @param input 输入
+     * @param dt 这一周期的长度（秒），不是正数（包括 NaN）时按名义周期
+     * @return T 输出
+     */
+    T Step(T input, ParamType<T> dt)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("VariableTsIntegrator::Step(dt)");
+        if (!(dt > 0) || dt == this->Ts) return Step(input); // 无效的 dt 按名义周期
+
+        const auto c    = this->input_coefficient_;
+        const auto c_dt = CoefficientType<T>(this->Ki * dt / 2);
+        const auto last = StateType<T>(last_input_);
+        const auto u    = StateType<T>(input);
+
+        StateType<T> y = this->x_ - c * last + c_dt * last + c_dt * u;
+        if constexpr (kSaturated) {
+            const auto unsaturated = y;
+            y                      = this->saturation(unsaturated);
+            CONTROL_SYSTEM_PROBE_STREAK("DiscreteIntegratorSaturation saturated", this->saturated_, y != unsaturated);
+        }
+
+        this->x_    = y + c * u;
+        last_input_ = input;
+        return T(y);
+    }
+
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        if (n == 0) return;
+        const T last = input[n - 1]; // input 可以与 output 是同一个数组
+        Integrator::StepBlock(input, output, n);
+        last_input_ = last;
+    }
+
+    void ResetState()
+    {
+        Integrator::ResetState();
+        last_input_ = 0;
+    }
+};
+
+template <typename T>
+using VariableTsIntegrator = VariableTsIntegratorBase<DiscreteIntegrator<T>>;
+
+template <typename T>
+using VariableTsIntegratorSaturation = VariableTsIntegratorBase<DiscreteIntegratorSaturation<T>>;
+
+} // namespace static_dispatch
+
+/**
+ * @brief 采样周期可变的积分器（虚函数接口）
+ *
+ */
+template <typename T>
+class VariableTsIntegrator : public DynamicController<static_dispatch::VariableTsIntegrator<T>, VariableTsIntegrator<T>>
+{
+public:
+    using DynamicController<static_dispatch::VariableTsIntegrator<T>, VariableTsIntegrator<T>>::DynamicController;
+};
+
+/**
+ * @brief 采样周期可变的带限幅的积分器（虚函数接口）
+ *
+ */
+template <typename T>
+class VariableTsIntegratorSaturation : public DynamicController<static_dispatch::VariableTsIntegratorSaturation<T>, VariableTsIntegratorSaturation<T>>
+{
+public:
+    using DynamicController<static_dispatch::VariableTsIntegratorSaturation<T>, VariableTsIntegratorSaturation<T>>::DynamicController;
+};
+
+namespace pid
+{
+
+namespace static_dispatch
+{
+
+/**
+ * @brief 采样周期可变的微分器
+ *
+ * @tparam T 数据类型
+ * @tparam CacheSize 系数缓存的组数
+ */
+template <typename T, size_t CacheSize = 64>
+class VariableTsD : public D<T>
+{
+private:
+    using D<T>::Kd;
+    using D<T>::Kn;
+    using D<T>::Ts;
+    using D<T>::last_input_;
+    using D<T>::last_output_;
+
+    struct Pair {
+        T input_coefficient;
+        T output_coefficient;
+    };
+
+    TsCoefficientCache<T, Pair, CacheSize> cache_;
+    int64_t nominal_key_;
+
+public:
+    /**
+     * @brief 采样周期可变的微分器
+     *
+     * @param Kd 微分系数
+     * @param Kn 滤波器系数
+     * @param Ts 名义采样周期（秒）
+     * @param dt_resolution 实测周期的量化间隔，默认为 Ts / 64
+     */
+    VariableTsD(T Kd, T Kn, T Ts, T dt_resolution = 0)
+        : D<T>{Kd, Kn, Ts}, cache_{dt_resolution > 0 ? dt_resolution : Ts / 64}, nominal_key_{cache_.Key(Ts)} {};
+
+    using D<T>::Step;
+
+    /**
+     * @brief 以实测的采样周期 dt 走一个周期
+     *
+     * @param input 输入
+     * @param dt 这一周期的长度（秒），不是正数（包括 NaN）时按名义周期
+     * @return T 输出
+     */
+    T Step(T input, T dt)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("pid::VariableTsD::Step(dt)");
+        const auto key = cache_.Key(dt);
+        if (!(dt > 0) || dt == Ts || key == nominal_key_) return D<T>::Step(input); // 无效的 dt 按名义周期
+
+        const auto &c = cache_.Get(key, [this](T quantized_dt, Pair &out) {
+            const T inverse_den = 1 / (2 + Kn * quantized_dt);
+            out = {2 * Kd * Kn * inverse_den, (2 - Kn * quantized_dt) * inverse_den};
+        });
+
+        last_output_ = c.input_coefficient * (input - last_input_) + c.output_coefficient * last_output_;
+        last_input_  = input;
+        return last_output_;
+    }
+
+    void SetParam(T Kd, T Kn, T Ts)
+    {
+        D<T>::SetParam(Kd, Kn, Ts);
+        nominal_key_ = cache_.Key(Ts);
+        cache_.Clear();
+    }
+
+    void SetParam(T Kd, T Kn)
+    {
+        D<T>::SetParam(Kd, Kn);
+        cache_.Clear();
+    }
+
+    void SetCoefficients(const typename D<T>::Coefficients &coefficients)
+    {
+        D<T>::SetCoefficients(coefficients);
+        nominal_key_ = cache_.Key(Ts);
+        cache_.Clear();
+    }
+
+    size_t GetCacheMisses() const
+    {
+        return cache_.GetMisses();
+    }
+};
+
+/**
+ * @brief 采样周期可变的 PID 控制器，Step(input) 与同样参数的 pid::PID 逐位相同
+ *
+ * @tparam T 运算数据类型
+ * @tparam IntegratorType 积分器类型，默认为带限幅的 VariableTsIntegratorSaturation<T>，也可以是 VariableTsIntegrator<T>
+ */
+template <typename T, typename IntegratorType = control_system::static_dispatch::VariableTsIntegratorSaturation<T>>
+class VariableTsPID : public StaticControllerBase<VariableTsPID<T, IntegratorType>, T>
+{
+public:
+    T Kp; // 比例系数，可以直接修改
+    IntegratorType i_controller;
+    VariableTsD<T> d_controller;
+
+    using Coefficients = typename PID<T, IntegratorType>::Coefficients;
+
+    /**
+     * @brief 采样周期可变的 PID 控制器
+     *
+     * @param Ts 名义采样周期（秒）
+     * @param dt_resolution 微分器系数缓存的量化间隔，默认为 Ts / 64
+     */
+    VariableTsPID(T Kp, T Ki, T Kd, T Kn, T Ts, T dt_resolution = 0)
+        : Kp{Kp}, i_controller{Ki, Ts}, d_controller{Kd, Kn, Ts, dt_resolution} {};
+
+    T Step(T input)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("pid::VariableTsPID::Step");
+        return Kp * input + i_controller.Step(input) + d_controller.Step(input);
+    }
+
+    /**
+     * @brief 以实测的采样周期 dt 走一个周期
+     *
+     * @param input 输入
+     * @param dt 这一周期的长度（秒），不是正数（包括 NaN）时按名义周期
+     * @return T 输出
+     */
+    T Step(T input, T dt)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("pid::VariableTsPID::Step(dt)");
+        if (!(dt > 0)) return Step(input); // 无效的 dt 按名义周期
+        return Kp * input + i_controller.Step(input, dt) + d_controller.Step(input, dt);
+    }
+
+    void SetParam(T Kp, T Ki, T Kd, T Kn, T Ts)
+    {
+        this->Kp = Kp;
+        i_controller.SetParam(Ki, Ts);
+        d_controller.SetParam(Kd, Kn, Ts);
+    }
+
+    void SetParam(T Kp, T Ki, T Kd, T Kn)
+    {
+        this->Kp = Kp;
+        i_controller.SetParam(Ki);
+        d_controller.SetParam(Kd, Kn);
+    }
+
+    static Coefficients MakeCoefficients(T Kp, T Ki, T Kd, T Kn, T Ts)
+    {
+        return PID<T, IntegratorType>::MakeCoefficients(Kp, Ki, Kd, Kn, Ts);
+    }
+
+    static Coefficients MakeCoefficients(T Kp, T Ki, T Kd, T Kn, T Ts, const Saturation<T, T> &i_saturation)
+    {
+        return PID<T, IntegratorType>::MakeCoefficients(Kp, Ki, Kd, Kn, Ts, i_saturation);
+    }
+
+    /**
+     * @brief 一次性替换所有系数，内部状态保留，微分器的系数缓存清空
+     *
+     */
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        Kp = coefficients.Kp;
+        i_controller.SetCoefficients(coefficients.i);
+        d_controller.SetCoefficients(coefficients.d);
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {Kp, i_controller.GetCoefficients(), d_controller.GetCoefficients()};
+    }
+
+    void ResetState()
+    {
+        i_controller.ResetState();
+        d_controller.ResetState();
+    }
+};
+
+} // namespace static_dispatch
+
+template <typename T, size_t CacheSize = 64>
+class VariableTsD : public DynamicController<static_dispatch::VariableTsD<T, CacheSize>, VariableTsD<T, CacheSize>>
+{
+public:
+    using DynamicController<static_dispatch::VariableTsD<T, CacheSize>, VariableTsD<T, CacheSize>>::DynamicController;
+};
+
+template <typename T, typename IntegratorType = control_system::static_dispatch::VariableTsIntegratorSaturation<T>>
+class VariableTsPID : public DynamicController<static_dispatch::VariableTsPID<T, IntegratorType>, VariableTsPID<T, IntegratorType>>
+{
+public:
+    using DynamicController<static_dispatch::VariableTsPID<T, IntegratorType>, VariableTsPID<T, IntegratorType>>::DynamicController;
+};
+
+} // namespace pid
+
+namespace static_dispatch
+{
+
+/**
+ * @brief 由 s 传递函数经双线性变换得到的 ZTf，采样周期可变
+ *
+ * 双线性变换 s = 2/dt (z-1)/(z+1) 对 s 多项式的系数是线性的：分母为 n 阶时，
+ * b_j s^(n-j) 变为 b_j (2/dt)^(n-j) (z-1)^(n-j) (z+1)^j，其中 (z-1)^(n-j) (z+1)^j 的系数与 dt 无关，构造时算好，
+ * 之后每组系数只需 O(n²) 次乘加和一次除法
+ *
+ * @tparam T 数据类型
+ * @tparam CacheSize 系数缓存的组数
+ */
+template <typename T, size_t CacheSize = 64>
+class VariableTsZTf : public ZTf<T>
+{
+private:
+    using Coefficients = typename ZTf<T>::Coefficients;
+
+    std::vector<T> num_, den_;     // s 多项式，降幂排列，分子补到与分母相同长度
+    std::vector<T> tustin_;        // (n+1) x (n+1)，第 j 列为 (z-1)^(n-j) (z+1)^j 的系数
+    std::vector<T> scale_;         // 计算系数时的临时数组
+    T Ts_ = 0;
+
+    TsCoefficientCache<T, Coefficients, CacheSize> cache_;
+    int64_t nominal_key_ = 0;
+
+    /**
+     * @brief 采样周期为 dt 时的系数，写入 out（长度已经是 n + 1），不分配内存
+     *
+     */
+    void Discretize(T dt, Coefficients &out)
+    {
+        const size_t size = den_.size();
+        const T k         = 2 / dt;
+
+        // scale_[j] = (2/dt)^(n-j)
+        T power = 1;
+        for (size_t j = size; j-- > 0;) {
+            scale_[j] = power;
+            power *= k;
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            T num = 0, den = 0;
+            for (size_t j = 0; j < size; j++) {
+                const T p = tustin_[i * size + j] * scale_[j];
+                num += p * num_[j];
+                den += p * den_[j];
+            }
+            out.input_c[i]  = num;
+            out.output_c[i] = den;
+        }
+
+        const T inverse_den0 = 1 / out.output_c[0];
+        for (size_t i = 0; i < size; i++) {
+            out.input_c[i] *= inverse_den0;
+            out.output_c[i] *= -inverse_den0;
+        }
+    }
+
+public:
+    /**
+     * @brief 创建采样周期可变的 ZTf
+     *
+     * @param num s 传递函数的分子
+     * @param den s 传递函数的分母
+     * @param Ts 名义采样周期（秒）
+     * @param dt_resolution 实测周期的量化间隔，默认为 Ts / 64
+     * @note 分子阶数不能大于分母
+     */
+    VariableTsZTf(const std::vector<T> &num, const std::vector<T> &den, T Ts, T dt_resolution = 0)
+        : cache_{dt_resolution > 0 ? dt_resolution : Ts / 64, Coefficients{std::vector<T>(den.size()), std::vector<T>(den.size())}}
+    {
+        assert(!den.empty() && den.at(0) != 0);
+        assert(num.size() <= den.size());
+
+        const size_t size = den.size();
+        const size_t n    = size - 1;
+
+        den_ = den;
+        num_.assign(size - num.size(), 0);
+        num_.insert(num_.end(), num.begin(), num.end());
+        scale_.resize(size);
+
+        // 第 j 列：(z-1)^(n-j) (z+1)^j
+        tustin_.assign(size * size, 0);
+        for (size_t j = 0; j < size; j++) {
+            std::vector<T> column{1};
+            for (size_t m = 0; m < n; m++) {
+                const T sign = m < n - j ? -1 : 1;
+                std::vector<T> next(column.size() + 1, 0);
+                for (size_t i = 0; i < column.size(); i++) {
+                    next[i] += column[i];
+                    next[i + 1] += sign * column[i];
+                }
+                column.swap(next);
+            }
+            for (size_t i = 0; i < size; i++) {
+                tustin_[i * size + j] = column[i];
+            }
+        }
+
+        // 固定周期的路径就是一个普通的 ZTf
+        Ts_          = Ts;
+        nominal_key_ = cache_.Key(Ts);
+
+        Coefficients nominal{std::vector<T>(size), std::vector<T>(size)};
+        Discretize(Ts, nominal);
+
+        std::vector<T> den_z(size);
+        for (size_t i = 0; i < size; i++) {
+            den_z[i] = -nominal.output_c[i];
+        }
+        ZTf<T>::Init(nominal.input_c, den_z);
+    }
+
+    using ZTf<T>::Step;
+
+    /**
+     * @brief 以实测的采样周期 dt 走一个周期
+     *
+     * @param input 输入
+     * @param dt 这一周期的长度（秒），不是正数（包括 NaN）时按名义周期
+     * @return T 输出
+     */
+    T Step(T input, T dt)
+    {
+        CONTROL_SYSTEM_PROBE_TIME("VariableTsZTf::Step(dt)");
+        const auto key = cache_.Key(dt);
+        if (!(dt > 0) || dt == Ts_ || key == nominal_key_) return ZTf<T>::Step(input); // 无效的 dt 按名义周期
+
+        const auto &c = cache_.Get(key, [this](T quantized_dt, Coefficients &out) { Discretize(quantized_dt, out); });
+        return this->StepWith(c.input_c.data(), c.output_c.data(), input);
+    }
+
+    // 系数由 s 传递函数决定，不能直接替换
+    void Init(const std::vector<T> &, const std::vector<T> &)      = delete;
+    void SetCoefficients(const typename ZTf<T>::Coefficients &) = delete;
+
+    T GetTs() const
+    {
+        return Ts_;
+    }
+
+    size_t GetCacheMisses() const
+    {
+        return cache_.GetMisses();
+    }
+};
+
+} // namespace static_dispatch
+
+/**
+ * @brief 采样周期可变的 ZTf（虚函数接口）
+ *
+ */
+template <typename T, size_t CacheSize = 64>
+class VariableTsZTf : public DynamicController<static_dispatch::VariableTsZTf<T, CacheSize>, VariableTsZTf<T, CacheSize>>
+{
+public:
+    using DynamicController<static_dispatch::VariableTsZTf<T, CacheSize>, VariableTsZTf<T, CacheSize>>::DynamicController;
+};
+
+} // namespace control_system
@@ -2,7 +2,7 @@
  * @file z_tf.hpp
  * @author X. Y.
  * @brief Z 传递函数
- * @version 0.3
+ * @version 0.6
  * @date 2023-07-13
  *
  * @copyright Copyright (c) 2023
@@ -12,35 +12,79 @@
 #pragma once
 
 #include "discrete_controller_base.hpp"
+#include "instrumentation.hpp"
 #include <vector>
 #include <cassert>
-#include "ring_list.hpp"
+#include <cstddef>
+#include <algorithm>
+#include <utility>
 
 namespace control_system
 {
 
+namespace static_dispatch
+{
+
 /**
  * @brief Z传递函数
  *
- * @tparam T 数据类型，例如 float 或 double
+ * @tparam T 数据类型，例如 float 或 double，也可以是定点数（fixed_point.hpp），此时分子分母为 double
  */
 template <typename T>
-class ZTf : public DiscreteControllerBase<T>
+class ZTf : public StaticControllerBase<ZTf<T>, T>
 {
 private:
-    std::vector<T> input_c_, output_c_; // 输入系数 i0, i1, ... 和输出系数 o0, o1, ...
+    std::vector<CoefficientType<T>> input_c_, output_c_; // 输入系数 i0, i1, ... 和输出系数 o0, o1, ...
 
-    typedef struct
+    // 历史输入和历史输出，各自为双倍长度的镜像数组：
+    // 每个数据同时写在 head_ 和 head_ + history_length_ 两处，
+    // 因此 [head_, head_ + history_length_) 始终是一段连续的、从新到旧排列的历史数据
+    std::vector<T> input_history_, output_history_;
+
+    size_t history_length_ = 0; // 历史数据长度（等于分母阶数）
+    size_t storage_length_ = 1; // 镜像数组的半长，至少为 1，以免 0 阶系统写越界
+    size_t head_           = 0; // 最新数据所在位置
+
+protected:
+    /**
+     * @brief 用给定的一组系数（长度与当前系数相同）走一个周期，历史数据照常更新，供采样周期可变的派生类使用
+     *
+     */
+    T StepWith(const CoefficientType<T> *input_coefficients, const CoefficientType<T> *output_coefficients, T input)
     {
-        T input;
-        T output;
-    } data_t;
+        T output = input_coefficients[0] * input;
+
+        // 系数和历史数据都是连续存储的，这里就是两个点积
+        const CoefficientType<T> *input_c  = input_coefficients + 1;
+        const CoefficientType<T> *output_c = output_coefficients + 1;
+        const T *last_inputs               = input_history_.data() + head_;
+        const T *last_outputs              = output_history_.data() + head_;
+
+        for (size_t i = 0; i < history_length_; i++) {
+            output += input_c[i] * last_inputs[i];
+            output += output_c[i] * last_outputs[i];
+        }
 
-    RingList<data_t> data_list_;
+        // 最旧的数据被新数据覆盖，新数据放在窗口开头
+        head_ = (head_ == 0 ? storage_length_ : head_) - 1;
+
+        input_history_[head_]                    = input;
+        input_history_[head_ + storage_length_]  = input;
+        output_history_[head_]                   = output;
+        output_history_[head_ + storage_length_] = output;
+
+        return output;
+    }
 
-    size_t order_ = 0; // 系统阶数（等于分母阶数）
-    size_t order_m1;   // order_ - 1（提前算好，加快运算速度）
 public:
+    /**
+     * @brief 一组完整的系数
+     *
+     */
+    struct Coefficients {
+        std::vector<CoefficientType<T>> input_c, output_c;
+    };
+
     /**
      * @brief 创建空的 Z 传函
      * @note 由于没有分子和分母，之后必须调用 Init() 指定分子和分母才能调用 Step()
@@ -54,7 +98,7 @@ public:
      * @param den 分母
      * @note 分子阶数不能大于分母，否则是非因果系统
      */
-    ZTf(const std::vector<T> &num, const std::vector<T> &den)
+    ZTf(const std::vector<ParamType<T>> &num, const std::vector<ParamType<T>> &den)
     {
         Init(num, den);
     }
@@ -66,36 +110,74 @@ public:
      * @param den 分母
      * @note 分子阶数不能大于分母，否则是非因果系统
      */
-    void Init(const std::vector<T> &num, const std::vector<T> &den)
+    void Init(const std::vector<ParamType<T>> &num, const std::vector<ParamType<T>> &den)
+    {
+        auto coefficients = MakeCoefficients(num, den);
+        auto order        = den.size();
+
+        history_length_ = order - 1;
+        storage_length_ = history_length_ > 0 ? history_length_ : 1;
+
+        input_c_  = std::move(coefficients.input_c);
+        output_c_ = std::move(coefficients.output_c);
+        input_history_.resize(2 * storage_length_);
+        output_history_.resize(2 * storage_length_);
+
+        ResetState();
+    }
+
+    /**
+     * @brief 由分子和分母算出一组系数，可以在其他线程中调用
+     *
+     * @param num 分子
+     * @param den 分母
+     * @note 分子阶数不能大于分母，否则是非因果系统
+     */
+    static Coefficients MakeCoefficients(const std::vector<ParamType<T>> &num, const std::vector<ParamType<T>> &den)
     {
         assert(den.at(0) != 0);
 
         int size_diff = den.size() - num.size(); // 分母维数与分子维数之差
         assert(size_diff >= 0);                  // 分子阶数不能大于分母，否则是非因果系统
 
-        order_   = den.size();
-        order_m1 = order_ - 1;
+        auto order = den.size();
 
-        input_c_.resize(order_);
-        output_c_.resize(order_);
-        data_list_.resize(order_m1);
+        Coefficients coefficients{std::vector<CoefficientType<T>>(order), std::vector<CoefficientType<T>>(order)};
 
         // 如果分子阶数小于分母，就往前面补一些 0
         for (int i = 0; i < size_diff; i++) {
-            input_c_.at(i) = 0;
+            coefficients.input_c.at(i) = CoefficientType<T>(0);
         }
 
         // 剩下的输入系数
-        for (size_t i = size_diff; i < order_; i++) {
-            input_c_.at(i) = num.at(i - size_diff) / den.at(0);
+        for (size_t i = size_diff; i < order; i++) {
+            coefficients.input_c.at(i) = CoefficientType<T>(num.at(i - size_diff) / den.at(0));
         }
 
         // 输出系数
-        for (size_t i = 0; i < order_; i++) {
-            output_c_.at(i) = -den.at(i) / den.at(0);
+        for (size_t i = 0; i < order; i++) {
+            coefficients.output_c.at(i) = CoefficientType<T>(-den.at(i) / den.at(0));
         }
 
-        ResetState();
+        return coefficients;
+    }
+
+    /**
+     * @brief 一次性替换所有系数，内部状态保留
+     * @note 阶数必须与当前相同，只拷贝数据，不分配内存；改变阶数请用 Init()
+     */
+    void SetCoefficients(const Coefficients &coefficients)
+    {
+        assert(coefficients.input_c.size() == input_c_.size());
+        assert(coefficients.output_c.size() == output_c_.size());
+
+        std::copy(coefficients.input_c.begin(), coefficients.input_c.end(), input_c_.begin());
+        std::copy(coefficients.output_c.begin(), coefficients.output_c.end(), output_c_.begin());
+    }
+
+    Coefficients GetCoefficients() const
+    {
+        return {input_c_, output_c_};
     }
 
     /**
@@ -104,38 +186,117 @@ public:
      * @param input 输入
      * @return 输出
      */
-    T Step(T input) override
+    T Step(T input)
     {
-        assert(order_ != 0);
+        CONTROL_SYSTEM_PROBE_TIME("ZTf::Step");
+        assert(!input_c_.empty());
+        return StepWith(input_c_.data(), output_c_.data(), input);
+    }
 
-        T output = input_c_[0] * input;
+    void StepBlock(const T *input, T *output, size_t n)
+    {
+        assert(!input_c_.empty());
+
+        const CoefficientType<T> c0        = input_c_[0];
+        const CoefficientType<T> *input_c  = input_c_.data() + 1;
+        const CoefficientType<T> *output_c = output_c_.data() + 1;
+        T *input_history                   = input_history_.data();
+        T *output_history                  = output_history_.data();
+        const size_t length                = history_length_;
+        const size_t mirrored              = storage_length_;
+        size_t head                        = head_;
+
+        for (size_t k = 0; k < n; k++) {
+            auto in = input[k];
+            T out   = c0 * in;
 
-        data_t *data = &(data_list_.get());
+            for (size_t i = 0; i < length; i++) {
+                out += input_c[i] * input_history[head + i];
+                out += output_c[i] * output_history[head + i];
+            }
 
-        for (size_t i = 1; i < order_m1; i++) {
-            output += input_c_[i] * data->input;
-            output += output_c_[i] * data->output;
-            data = &(data_list_.spin());
+            head = (head == 0 ? mirrored : head) - 1;
+
+            input_history[head]             = in;
+            input_history[head + mirrored]  = in;
+            output_history[head]            = out;
+            output_history[head + mirrored] = out;
+
+            output[k] = out;
         }
 
-        output += input_c_[order_m1] * data->input;
-        output += output_c_[order_m1] * data->output;
+        head_ = head;
+    }
 
-        // 插入新数据，并把新数据放在链表开头
-        data->input  = input;
-        data->output = output;
+    /**
+     * @brief 输入系数 i0, i1, ...（已除以分母首项，长度等于分母长度）
+     *
+     */
+    const std::vector<CoefficientType<T>> &GetInputCoefficients() const
+    {
+        return input_c_;
+    }
 
-        return output;
+    /**
+     * @brief 输出系数 o0, o1, ...（o0 恒为 -1，不参与运算）
+     *
+     */
+    const std::vector<CoefficientType<T>> &GetOutputCoefficients() const
+    {
+        return output_c_;
+    }
+
+    /**
+     * @brief 历史数据的长度（等于分母阶数）
+     *
+     */
+    size_t GetHistoryLength() const
+    {
+        return history_length_;
+    }
+
+    /**
+     * @brief 输入的历史数据，从新到旧连续排列，长度为 GetHistoryLength()
+     * @note 返回的指针在下一次 Step() 后失效
+     */
+    const T *GetInputHistory() const
+    {
+        return input_history_.data() + head_;
+    }
+
+    /**
+     * @brief 输出的历史数据，从新到旧连续排列，长度为 GetHistoryLength()
+     * @note 返回的指针在下一次 Step() 后失效
+     */
+    const T *GetOutputHistory() const
+    {
+        return output_history_.data() + head_;
     }
 
     /**
      * @brief 重置内部状态
      *
      */
-    void ResetState() override
+    void ResetState()
     {
-        data_list_.fill({0, 0});
+        std::fill(input_history_.begin(), input_history_.end(), 0);
+        std::fill(output_history_.begin(), output_history_.end(), 0);
+        head_ = 0;
     }
 };
 
+} // namespace static_dispatch
+
+/**
+ * @brief Z传递函数（虚函数接口）
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ */
+template <typename T>
+class ZTf : public DynamicController<static_dispatch::ZTf<T>, ZTf<T>>
+{
+public:
+    using DynamicController<static_dispatch::ZTf<T>, ZTf<T>>::DynamicController;
+};
+
 } // namespace control_system
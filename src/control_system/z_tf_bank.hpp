@@ -0,0 +1,208 @@
+/**
+ * @file z_tf_bank.hpp
+ * @author X. Y.
+ * @brief 多通道 Z 传递函数
+ * @version 0.1
+ * @date 2023-07-24
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 同一个 Z 传递函数同时作用在很多个通道上（例如对几百路传感器做同样的陷波滤波）
+ * 所有通道共用一组系数，各通道的状态按“结构数组”存放：第 j 个历史数据的所有通道连续存放在一行中，
+ * 因此每个周期的运算都是对连续内存的逐元素乘加，编译器可以直接生成 SSE/AVX 指令
+ * 每个通道的运算顺序与 ZTf::Step() 相同，结果逐位相同
+ *
+ * 使用示例：
+ * control_system::ZTf<float> ztf({66, -124, 58}, {1, -0.333, -0.667});
+ * control_system::ZTfBank<float> bank(ztf, 256); // 256 个通道
+ * bank.Step(input, output);                       // input 和 output 的长度都是 256
+ *
+ */
+
+#pragma once
+
+#include "z_tf.hpp"
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <algorithm>
+
+namespace control_system
+{
+
+/**
+ * @brief 多通道 Z 传递函数
+ *
+ * @tparam T 数据类型，例如 float 或 double
+ */
+template <typename T>
+class ZTfBank
+{
+private:
+    // 每次处理的通道数。一段内所有历史行都在 L1 缓存中，累加结果放在栈上的数组里
+    static constexpr size_t kTileSize = 64;
+
+    // 每行的长度向上取整到这个数，使每行的起始地址对齐到 SIMD 宽度
+    static constexpr size_t kRowAlign = 16;
+
+    std::vector<T> input_c_, output_c_; // 与 ZTf 相同的系数
+
+    // 历史输入和历史输出，各有 rows_ 行，每行 stride_ 个通道
+    // 第 (head_ + j) % rows_ 行是各通道倒数第 j + 1 个数据
+    std::vector<T> input_history_, output_history_;
+
+    size_t channels_       = 0;
+    size_t stride_         = 0;
+    size_t history_length_ = 0; // 历史数据长度（等于分母阶数）
+    size_t rows_           = 1; // 历史数据行数，至少为 1，这样 0 阶系统也能读回最近一次的输出
+    size_t head_           = 0;
+
+    const T *InputRow(size_t j) const
+    {
+        auto row = head_ + j;
+        if (row >= rows_) row -= rows_;
+        return input_history_.data() + row * stride_;
+    }
+
+    const T *OutputRow(size_t j) const
+    {
+        auto row = head_ + j;
+        if (row >= rows_) row -= rows_;
+        return output_history_.data() + row * stride_;
+    }
+
+public:
+    /**
+     * @brief 创建空的多通道 Z 传函
+     * @note 之后必须调用 Init() 才能调用 Step()
+     */
+    ZTfBank(){};
+
+    /**
+     * @brief 创建多通道 Z 传函
+     *
+     * @param ztf 提供系数的 Z 传函（只使用它的系数，不使用它的状态）
+     * @param channels 通道数
+     */
+    ZTfBank(const static_dispatch::ZTf<T> &ztf, size_t channels)
+    {
+        Init(ztf, channels);
+    }
+
+    /**
+     * @brief 初始化或重新指定系数和通道数
+     *
+     * @param ztf 提供系数的 Z 传函（只使用它的系数，不使用它的状态）
+     * @param channels 通道数
+     */
+    void Init(const static_dispatch::ZTf<T> &ztf, size_t channels)
+    {
+        assert(!ztf.GetInputCoefficients().empty()); // ztf 必须已经初始化
+
+        input_c_  = ztf.GetInputCoefficients();
+        output_c_ = ztf.GetOutputCoefficients();
+
+        channels_       = channels;
+        stride_         = (channels + kRowAlign - 1) / kRowAlign * kRowAlign;
+        history_length_ = input_c_.size() - 1;
+        rows_           = history_length_ > 0 ? history_length_ : 1;
+
+        input_history_.resize(rows_ * stride_);
+        output_history_.resize(rows_ * stride_);
+
+        ResetState();
+    }
+
+    /**
+     * @brief 所有通道走一个周期
+     *
+     * @param input 各通道的输入，长度为 Channels()
+     * @param output 各通道的输出，长度为 Channels()，可以与 input 是同一个数组
+     */
+    void Step(const T *input, T *output)
+    {
+        assert(!input_c_.empty());
+
+        // 最旧的一行在本周期用完之后被新数据覆盖
+        auto new_head = (head_ == 0 ? rows_ : head_) - 1;
+        T *new_input  = input_history_.data() + new_head * stride_;
+        T *new_output = output_history_.data() + new_head * stride_;
+
+        T acc[kTileSize];
+
+        for (size_t begin = 0; begin < channels_; begin += kTileSize) {
+            auto length = std::min(channels_ - begin, kTileSize);
+
+            const T c0 = input_c_[0];
+            for (size_t c = 0; c < length; c++) {
+                acc[c] = c0 * input[begin + c];
+            }
+
+            for (size_t j = 0; j < history_length_; j++) {
+                const T ci       = input_c_[j + 1];
+                const T co       = output_c_[j + 1];
+                const T *inputs  = InputRow(j) + begin;
+                const T *outputs = OutputRow(j) + begin;
+
+                for (size_t c = 0; c < length; c++) {
+                    acc[c] += ci * inputs[c];
+                    acc[c] += co * outputs[c];
+                }
+            }
+
+            for (size_t c = 0; c < length; c++) {
+                new_input[begin + c]  = input[begin + c];
+                new_output[begin + c] = acc[c];
+            }
+
+            for (size_t c = 0; c < length; c++) {
+                output[begin + c] = acc[c];
+            }
+        }
+
+        head_ = new_head;
+    }
+
+    /**
+     * @brief 某个通道最近一次的输出
+     *
+     * @param channel 通道序号
+     */
+    T GetOutput(size_t channel) const
+    {
+        assert(channel < channels_);
+        return OutputRow(0)[channel];
+    }
+
+    /**
+     * @brief 重置所有通道的内部状态
+     *
+     */
+    void ResetState()
+    {
+        std::fill(input_history_.begin(), input_history_.end(), 0);
+        std::fill(output_history_.begin(), output_history_.end(), 0);
+        head_ = 0;
+    }
+
+    /**
+     * @brief 只重置某一个通道的内部状态
+     *
+     * @param channel 通道序号
+     */
+    void ResetState(size_t channel)
+    {
+        assert(channel < channels_);
+        for (size_t j = 0; j < rows_; j++) {
+            input_history_[j * stride_ + channel]  = 0;
+            output_history_[j * stride_ + channel] = 0;
+        }
+    }
+
+    size_t Channels() const
+    {
+        return channels_;
+    }
+};
+
+} // namespace control_system
@@ -3,17 +3,49 @@
 #include "control_system/pid_controller.hpp"
 #include "control_system/saturation.hpp"
 #include "control_system/z_tf.hpp"
+#include "control_system/static_z_tf.hpp"
+#include "control_system/z_tf_bank.hpp"
+#include "control_system/sos_filter.hpp"
+#include "control_system/state_space.hpp"
+#include "control_system/block_algebra.hpp"
+#include "control_system/block_diagram.hpp"
+#include "control_system/parallel_executor.hpp"
+#include "control_system/periodic_scheduler.hpp"
+#include "control_system/multirate_scheduler.hpp"
+#include "control_system/triple_buffer.hpp"
+#include "control_system/gain_scheduled_pid.hpp"
+#include "control_system/lookup_table.hpp"
+#include "control_system/instrumentation.hpp"
+#include "control_system/trace_recorder.hpp"
+#include "control_system/closed_loop.hpp"
+#include "control_system/pid_bank.hpp"
+#include "control_system/state_space_bank.hpp"
+#include "control_system/pid_sweep.hpp"
+#include "control_system/frequency_response.hpp"
+#include "control_system/variable_ts.hpp"
+#include "control_system/fixed_point.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#include "control_system/replay.hpp"
+#endif
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <atomic>
+#include <vector>
+#include <cmath>
+#include <algorithm>
 #include "timer.hpp"
 
 using namespace control_system;
 using namespace std;
 
-template <typename T>
-void StepTest(DiscreteControllerBase<T> &controller, uint32_t loop_time = 10000000)
+// Controller 可以是具体的控制器类型（Step() 可以内联），也可以是 DiscreteControllerBase（每次都是虚函数调用）
+// 这里只是演示和粗略计时，各控制器的详细性能测试见 benchmark/benchmark.cpp
+template <typename Controller>
+void StepTest(Controller &controller, uint32_t loop_time = 10000000)
 {
+    using T = typename Controller::ValueType;
+
     Timer timer;
     timer.Start();
     for (size_t i = 0; i < loop_time; i++) {
@@ -23,6 +55,17 @@ void StepTest(DiscreteControllerBase<T> &controller, uint32_t loop_time = 100000
     auto speed    = loop_time / duration / 1000.0;
     printf("Step(1) for %u times: duration: %g s, speed: %g kps\n", loop_time, duration, speed);
 
+    // 同样的次数，每 1024 个数据调用一次 StepBlock()
+    constexpr size_t block_size = 1024;
+    std::vector<T> input(block_size, 1), output(block_size);
+    timer.Start();
+    for (size_t i = 0; i < loop_time; i += block_size) {
+        controller.StepBlock(input.data(), output.data(), block_size);
+    }
+    duration = timer.GetSecond();
+    speed    = loop_time / duration / 1000.0;
+    printf("StepBlock(1) for %u times: duration: %g s, speed: %g kps\n", loop_time, duration, speed);
+
     printf("Step(1) from %u to %u times:\n", loop_time + 1, loop_time + 11);
     for (size_t i = 0; i < 10; i++) {
         printf("%g\t", controller.Step(1));
@@ -49,8 +92,477 @@ int main(int, char **)
     // 分母为 z^2 - 0.333 z - 0.667
     ZTf<double> ztf({1, 2}, {1, 2, 3, 4, 5});
 
-    printf("==== Old ztf: ====\n");
+    printf("==== ztf (order 4): ====\n");
     StepTest(ztf);
 
+    // 10 阶传递函数，历史数据连续存储后，Step() 的主循环就是两个点积
+    ZTf<double> ztf_order_10({0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01},
+                             {1, -0.5, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+
+    printf("==== ztf (order 10): ====\n");
+    StepTest(ztf_order_10);
+
+    // 同样的 10 阶传递函数，阶数在编译期确定
+    StaticZTf<double, 10> static_ztf_order_10({0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01},
+                                              {1, -0.5, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+
+    printf("==== static ztf (order 10): ====\n");
+    StepTest(static_ztf_order_10);
+
+    // 同样的 10 阶传递函数，分解为 5 个二阶节
+    SosFilter<double> sos_order_10(ztf_order_10);
+
+    printf("==== sos filter (order 10): ====\n");
+    StepTest(sos_order_10);
+
+    // 同样的 10 阶传递函数，转换为可控标准型的状态空间模型
+    SisoStateSpace<double, 10> ss_order_10(ztf_order_10);
+
+    printf("==== state space (order 10): ====\n");
+    StepTest(ss_order_10);
+
+    pid::PID_AntiWindup<float> pid_antiwindup{2, 100, 0.76, 100, 0.01, 1, -5, 5};
+
+    printf("==== pid antiwindup: ====\n");
+    StepTest(pid_antiwindup);
+
+    // 同一个控制器通过基类引用调用，每个周期都是一次虚函数调用
+    DiscreteControllerBase<float> &pid_antiwindup_base = pid_antiwindup;
+
+    printf("==== pid antiwindup (virtual call): ====\n");
+    StepTest(pid_antiwindup_base);
+
+    // 静态多态的版本，没有虚函数表
+    pid::static_dispatch::PID_AntiWindup<float> static_pid_antiwindup{2, 100, 0.76, 100, 0.01, 1, -5, 5};
+
+    printf("==== pid antiwindup (static dispatch): ====\n");
+    StepTest(static_pid_antiwindup);
+
+    // 前置滤波器、PID、输出限幅串联成一个控制器，Step() 整体内联
+    ZTf<float> prefilter({0.2}, {1, -0.8});
+    pid::PID<float> pid_controller{1.23, 0.54, 0.1, 100, 0.01};
+    auto chain = Series(Series(prefilter, pid_controller), Saturation<float, float>{-5, 5});
+
+    printf("==== prefilter -> pid -> saturation: ====\n");
+    StepTest(chain);
+
+
+    // 同一个 10 阶传递函数作用在 256 个通道上
+    constexpr size_t channels = 256;
+    ZTfBank<double> bank(ztf_order_10, channels);
+    std::vector<double> bank_data(channels, 1);
+    uint32_t bank_ticks = 10000000 / channels;
+
+    Timer timer;
+    for (size_t i = 0; i < bank_ticks; i++) {
+        bank.Step(bank_data.data(), bank_data.data());
+    }
+    auto duration = timer.GetSecond();
+    printf("==== ztf bank (order 10, %zu channels): ====\n", channels);
+    printf("Step() for %u ticks: duration: %g s, speed: %g kps (per channel)\n",
+           bank_ticks, duration, bank_ticks * channels / duration / 1000.0);
+
+    // 运行时搭建的框图：500 个模块串成一条链，每个模块还接收前面第二个模块的输出
+    BlockDiagram<float> diagram;
+    size_t last_node = diagram.AddInput();
+    for (size_t i = 0; i < 500; i++) {
+        size_t node;
+        switch (i % 4) {
+            case 0: node = diagram.AddBlock(ZTf<float>({0.2}, {1, -0.8})); break;
+            case 1: node = diagram.AddBlock(pid::PID<float>{1, 0.5, 0.01, 100, 0.01}); break;
+            case 2: node = diagram.AddBlock(DiscreteIntegrator<float>{1, 0.01}); break;
+            default: node = diagram.AddBlock(Saturation<float, float>{-1, 1}); break;
+        }
+        diagram.Connect(last_node, node, 0.5);
+        if (i > 1) diagram.Connect(node - 2, node, 0.1);
+        last_node = node;
+    }
+    diagram.AddOutput(last_node);
+    diagram.Compile();
+
+    uint32_t diagram_ticks = 100000;
+    float diagram_input = 1, diagram_output;
+    timer.Start();
+    for (size_t i = 0; i < diagram_ticks; i++) {
+        diagram.Step(&diagram_input, &diagram_output);
+    }
+    duration = timer.GetSecond();
+    printf("==== block diagram (500 blocks): ====\n");
+    printf("Step() for %u ticks: duration: %g s, %g us per tick\n", diagram_ticks, duration, duration / diagram_ticks * 1e6);
+
+    // 20000 个 PID 控制器，分别用 1 到 N 个线程运行，看多线程的加速比
+    constexpr size_t executor_controllers = 20000;
+    uint32_t executor_ticks               = 200;
+    std::vector<pid::PID<float>> pid_array(executor_controllers, pid::PID<float>{1, 0.5, 0.01, 100, 0.001});
+    std::vector<float> pid_inputs(executor_controllers, 1), pid_outputs(executor_controllers);
+
+    printf("==== parallel executor (%zu pid controllers): ====\n", executor_controllers);
+    size_t max_threads   = std::max(std::thread::hardware_concurrency(), 1u);
+    double single_thread = 0;
+    for (size_t threads = 1; threads <= max_threads; threads++) {
+        ParallelExecutor executor(threads);
+        for (size_t i = 0; i < executor_controllers; i++) {
+            executor.AddController(pid_array[i], &pid_inputs[i], &pid_outputs[i]);
+        }
+
+        timer.Start();
+        for (size_t i = 0; i < executor_ticks; i++) {
+            executor.RunTick();
+        }
+        duration = timer.GetSecond() / executor_ticks;
+        if (threads == 1) single_thread = duration;
+
+        uint64_t stolen = 0;
+        for (const auto &stats : executor.GetStats()) {
+            stolen += stats.stolen_chunks;
+        }
+        printf("%zu threads: %g us per tick, speedup: %g, stolen chunks: %llu\n",
+               threads, duration * 1e6, single_thread / duration, (unsigned long long)stolen);
+    }
+
+    // 1 kHz 的 PID 和 500 Hz 的传递函数，运行 0.2 s，统计延迟、抖动和超时
+    PeriodicScheduler scheduler(50e-6);
+    float scheduled_output = 0;
+    auto pid_task          = scheduler.AddTask([&] { scheduled_output = pid_antiwindup.Step(1); }, 0.001);
+    auto ztf_task          = scheduler.AddTask([&] { ztf_order_10.Step(scheduled_output); }, 0.002);
+    scheduler.Run(0.2);
+
+    printf("==== periodic scheduler (0.2 s): ====\n");
+    for (auto id : {pid_task, ztf_task}) {
+        const auto &stats = scheduler.GetStats(id);
+        printf("task %zu: releases: %llu, missed: %llu, latency mean: %g us, p99: %g us, jitter: %g us, wcet: %g us\n",
+               id, (unsigned long long)stats.releases, (unsigned long long)stats.missed_deadlines,
+               stats.latency.Mean() / 1e3, stats.latency.Percentile(0.99) / 1e3, stats.Jitter() / 1e3,
+               stats.WorstCaseExecutionTime() / 1e3);
+    }
+
+    // 位置环 100 Hz、速度环 1 kHz、电流环 10 kHz 的级联，慢回路只在自己的采样时刻计算
+    pid::PI<float> position_loop{5, 1, 0.01};
+    pid::PI<float> speed_loop{2, 20, 0.001};
+    pid::PI<float> current_loop{0.5, 200, 0.0001};
+    RateTransition<float> speed_reference, current_reference;
+    float position = 0, speed = 0, current = 0, voltage = 0;
+
+    MultiRateScheduler multirate(0.0001);
+    multirate.AddTask([&] { speed_reference.Write(position_loop.Step(1 - position)); }, 0.01);
+    multirate.AddRateTransition(speed_reference, 0.01);
+    multirate.AddTask([&] { current_reference.Write(speed_loop.Step(speed_reference.Read() - speed)); }, 0.001);
+    multirate.AddRateTransition(current_reference, 0.001);
+    multirate.AddTask([&] {
+        voltage = current_loop.Step(current_reference.Read() - current);
+        // 简单的电机模型
+        current += 0.0001 * (voltage - current) * 100;
+        speed += 0.0001 * current * 10;
+        position += 0.0001 * speed;
+    },
+                      0.0001);
+
+    uint32_t multirate_ticks = 1000000;
+    timer.Start();
+    for (size_t i = 0; i < multirate_ticks; i++) {
+        multirate.Tick();
+    }
+    duration = timer.GetSecond();
+    printf("==== multirate cascade (10 kHz / 1 kHz / 100 Hz): ====\n");
+    printf("Tick() for %u ticks: duration: %g s, %g ns per tick, position: %g\n",
+           multirate_ticks, duration, duration / multirate_ticks * 1e9, position);
+
+    // 调参线程不断发布新的 PID 参数，控制线程在每个周期开始时无锁地取用
+    pid::PID<float> tuned_pid{1.23, 0.54, 0.1, 1000, 0.001};
+    tuned_pid.i_controller.saturation.SetMinMax(-100, 100);
+    CoefficientChannel<pid::PID<float>::Coefficients> channel{tuned_pid.GetCoefficients()};
+    std::atomic<bool> tuning{true};
+    uint32_t published = 0;
+
+    std::thread tuner([&] {
+        while (tuning.load(std::memory_order_relaxed)) {
+            float kp = 1 + (published % 100) * 0.01f;
+            channel.Publish(pid::PID<float>::MakeCoefficients(kp, 0.54, 0.1, 1000, 0.001, {-100, 100}));
+            published++;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+
+    uint32_t tuned_steps = 1000000, applied = 0;
+    float tuned_output   = 0;
+    timer.Start();
+    for (size_t i = 0; i < tuned_steps; i++) {
+        applied += channel.Apply(tuned_pid);
+        tuned_output = tuned_pid.Step(1 - tuned_output * 0.001f);
+    }
+    duration = timer.GetSecond();
+    tuning.store(false, std::memory_order_relaxed);
+    tuner.join();
+    channel.Apply(tuned_pid);
+
+    printf("==== coefficient hot-swap: ====\n");
+    printf("Apply() + Step() for %u steps: duration: %g s, %g ns per step, published: %u, applied: %u, final Kp: %g\n",
+           tuned_steps, duration, duration / tuned_steps * 1e9, published, applied, tuned_pid.Kp);
+
+    // 按转速调度的 PI 参数，转速从 0 线性增加到 3000
+    pid::GainScheduledPID<float> scheduled_pid({0, 1000, 3000}, {1.0, 1.5, 2.0}, {10, 15, 30}, {0, 0, 0}, {100, 100, 100}, 0.001);
+    uint32_t scheduled_steps = 1000000;
+    float scheduled_sum      = 0;
+    timer.Start();
+    for (size_t i = 0; i < scheduled_steps; i++) {
+        scheduled_sum += scheduled_pid.Step(0.001f, 3000.0f * i / scheduled_steps);
+    }
+    duration = timer.GetSecond();
+    printf("==== gain scheduled pid: ====\n");
+    printf("Step() for %u steps: duration: %g s, %g ns per step, final Kp: %g, sum: %g\n",
+           scheduled_steps, duration, duration / scheduled_steps * 1e9, scheduled_pid.GetGains().Kp, scheduled_sum);
+
+    // 等间距的一维前馈表和二维的转速-负载表，批量查表
+    std::vector<float> lut_breakpoints, lut_values;
+    for (size_t i = 0; i < 256; i++) {
+        lut_breakpoints.push_back(i * 0.1f);
+        lut_values.push_back(std::sin(i * 0.1f));
+    }
+    LookupTable1D<float> feedforward(lut_breakpoints, lut_values);
+    LookupTable2D<float> speed_load_map({{0, 1000, 2000, 3000}, {0, 50, 100}},
+                                        {0, 1, 2, 3, 1, 2, 3, 4, 2, 3, 4, 5});
+
+    size_t lut_points = 100000;
+    std::vector<float> lut_inputs(lut_points), lut_loads(lut_points), lut_outputs(lut_points);
+    for (size_t i = 0; i < lut_points; i++) {
+        lut_inputs[i] = 25.5f * i / lut_points;
+        lut_loads[i]  = 100.0f * i / lut_points;
+    }
+
+    printf("==== lookup tables (%zu points): ====\n", lut_points);
+    timer.Start();
+    feedforward.StepBlock(lut_inputs.data(), lut_outputs.data(), lut_points);
+    duration = timer.GetSecond();
+    printf("1-D StepBlock(): %g ns per point, evenly spaced: %d, f(1.05): %g\n",
+           duration / lut_points * 1e9, feedforward.GetBreakpoints().IsEvenlySpaced(), feedforward.Step(1.05));
+
+    std::vector<float> lut_speeds(lut_points);
+    for (size_t i = 0; i < lut_points; i++) {
+        lut_speeds[i] = 3000.0f * i / lut_points;
+    }
+    timer.Start();
+    speed_load_map.EvaluateBlock({lut_speeds.data(), lut_loads.data()}, lut_outputs.data(), lut_points);
+    duration = timer.GetSecond();
+    printf("2-D EvaluateBlock(): %g ns per point, map(1500, 25): %g\n",
+           duration / lut_points * 1e9, speed_load_map(1500, 25));
+
+    // 插桩统计，编译时用 -DCONTROL_SYSTEM_INSTRUMENTATION=1 或 2 开启（cmake -DCONTROL_SYSTEM_INSTRUMENTATION=2）
+    printf("==== instrumentation (level %d): ====\n", CONTROL_SYSTEM_INSTRUMENTATION);
+    for (const auto &probe : instrumentation::Snapshot()) {
+        printf("%s: calls: %llu, hit rate: %g, cycles per call: %g, longest streak: %llu\n", probe.name.c_str(),
+               (unsigned long long)probe.calls, probe.HitRate(), probe.CyclesPerCall(), (unsigned long long)probe.max_streak);
+    }
+
+
+    // 信号记录：控制循环中只写入无锁缓冲区，后台线程按列写入文件
+    // 这里的循环没有按周期运行，远快于实际的控制频率，缓冲区写满后的记录会被丢弃并计数
+    pid::PID<float> traced_pid{1.23, 0.54, 0.1, 100, 0.001};
+    ZTf<float> traced_plant({0, 0.01}, {1, -0.99});
+    TraceChannel<float, 5> trace_channel({"reference", "output", "integrator", "derivative", "plant_output"});
+    TraceWriter trace_writer;
+    trace_writer.Add(trace_channel, "pid_trace.bin");
+    trace_writer.Start();
+
+    size_t trace_steps = 1000000;
+    float plant_output = 0;
+    timer.Start();
+    for (size_t i = 0; i < trace_steps; i++) {
+        float reference = (i / 1000) % 2 == 0 ? 1.0f : 0.0f;
+        auto output     = traced_pid.Step(reference - plant_output);
+        plant_output    = traced_plant.Step(output);
+        trace_channel.Record(i, reference, output, traced_pid.i_controller.GetStateOutput(),
+                             traced_pid.d_controller.GetLastOutput(), traced_plant.GetOutputHistory()[0]);
+    }
+    duration = timer.GetSecond();
+    trace_writer.Stop();
+
+    TraceData<float> trace_data;
+    LoadTrace("pid_trace.bin", trace_data);
+    printf("==== signal tracing (%zu steps): ====\n", trace_steps);
+    printf("%g ns per step with recording, recorded: %llu, dropped: %llu, lost: %llu, read back: %zu records, %zu columns\n",
+           duration / trace_steps * 1e9, (unsigned long long)trace_channel.GetRecorded(),
+           (unsigned long long)trace_data.dropped, (unsigned long long)trace_writer.GetLost(), trace_data.ticks.size(),
+           trace_data.columns.size());
+
+
+#if defined(__unix__) || defined(__APPLE__)
+    // 离线回放：信号文件映射到内存，控制器直接在映射的内存上 StepBlock()，每个通道一个任务，多线程执行
+    size_t replay_channels = 4, replay_samples = 1000000;
+    std::vector<std::vector<float>> replay_signals(replay_channels, std::vector<float>(replay_samples));
+    for (size_t c = 0; c < replay_channels; c++) {
+        for (size_t i = 0; i < replay_samples; i++) {
+            replay_signals[c][i] = std::sin(0.001f * (c + 1) * i);
+        }
+    }
+    WriteSignalFile("replay_input.signal", replay_signals);
+
+    timer.Start();
+    bool replayed = ReplayFiles<float>(pid::PID<float>{1.23, 0.54, 0.1, 100, 0.001}, {"replay_input.signal"}, {"replay_output.signal"});
+    duration = timer.GetSecond();
+
+    SignalFile<float> replay_output;
+    printf("==== offline replay (%zu channels x %zu samples): ====\n", replay_channels, replay_samples);
+    if (replayed && replay_output.Open("replay_output.signal") && replay_output.ChannelCount() > 0 &&
+        replay_output.SampleCount() == replay_samples) {
+        printf("replayed: %d, %g Msamples/s, last output of channel 0: %g\n", replayed,
+               replay_channels * replay_samples / duration / 1e6, replay_output.Channel(0)[replay_samples - 1]);
+    } else {
+        printf("replay failed\n");
+    }
+#endif
+
+
+    // 闭环仿真：256 组 PID 参数同时对同一个对象做阶跃响应，指标在仿真的同一遍中算出
+    size_t sim_scenarios = 256, sim_steps = 5000;
+    float sim_Ts         = 0.001f;
+    pid::PIDBank<float> sim_controllers(sim_scenarios);
+    for (size_t s = 0; s < sim_scenarios; s++) {
+        sim_controllers.SetParam(s, 0.5f + 0.02f * s, 5.0f, 0.001f, 100, sim_Ts);
+    }
+    SisoStateSpaceBank<float, 2> sim_plants(SisoStateSpace<float, 2>({0.01, 0.008}, {1, -1.7, 0.72}), sim_scenarios);
+    ClosedLoopSimulation<float> simulation(sim_scenarios, sim_Ts);
+
+    std::vector<float> sim_reference(sim_steps, 1.0f), sim_output(sim_steps * sim_scenarios);
+    ClosedLoopSignals<float> sim_signals;
+    sim_signals.reference        = sim_reference.data();
+    sim_signals.shared_reference = true;
+    sim_signals.output           = sim_output.data();
+
+    timer.Start();
+    simulation.Run(sim_controllers, sim_plants, sim_signals, sim_steps);
+    duration = timer.GetSecond();
+
+    const auto &sim_metrics = simulation.GetMetrics();
+    size_t best_scenario    = std::min_element(sim_metrics.iae.begin(), sim_metrics.iae.end()) - sim_metrics.iae.begin();
+    printf("==== closed-loop simulation (%zu scenarios x %zu steps): ====\n", sim_scenarios, sim_steps);
+    printf("%g ns per scenario step, best Kp: %g, IAE: %g, overshoot: %g, settling time: %g\n",
+           duration / (sim_scenarios * sim_steps) * 1e9, sim_controllers.GetKp(best_scenario), sim_metrics.iae[best_scenario],
+           sim_metrics.overshoot[best_scenario], sim_metrics.settling_time[best_scenario]);
+
+
+    // 抗饱和 PID 参数搜索：网格上的每组参数在 4 个随机的对象上仿真，取最坏的指标，多线程执行
+    pid::SweepOptions<float> sweep_options;
+    sweep_options.space.Kp         = {0.1f, 20, 16, true};
+    sweep_options.space.Ki         = {0.5f, 200, 16, true};
+    sweep_options.space.Kd         = {0, 0.05f, 4};
+    sweep_options.space.output_min = {-5, -5};
+    sweep_options.space.output_max = {5, 5};
+    sweep_options.Ts               = 0.001f;
+    sweep_options.steps            = 2000;
+    sweep_options.plant_samples    = 4;
+    sweep_options.plant_sampler    = [](std::mt19937_64 &rng) {
+        std::uniform_real_distribution<float> pole(0.9f, 0.995f); // 一阶对象的极点不确定
+        float p = pole(rng);
+        return static_dispatch::ZTf<float>({0, 1 - p}, {1, -p});
+    };
+
+    size_t pareto_updates = 0;
+    timer.Start();
+    auto sweep_result = pid::PIDSweep<float>(sweep_options).Run([&](const pid::SweepCandidate<float> &) { pareto_updates++; });
+    duration          = timer.GetSecond();
+    printf("==== PID sweep (%zu candidates x %zu plants): ====\n", sweep_result.evaluated, sweep_options.plant_samples);
+    printf("%g us per candidate, unstable: %zu, pareto front: %zu (%zu updates), best IAE: %g (Kp %g, Ki %g, Kd %g)\n",
+           duration / sweep_result.evaluated * 1e6, sweep_result.unstable, sweep_result.pareto.size(), pareto_updates,
+           sweep_result.best_iae.iae, sweep_result.best_iae.Kp, sweep_result.best_iae.Ki, sweep_result.best_iae.Kd);
+
+
+    // 频率响应和稳定裕度：带纯滞后的一阶对象，很多组 PI 参数的开环传递函数
+    const double fr_Ts = 0.001;
+    static_dispatch::ZTf<double> fr_plant({0, 0, 0, 0, 0.02}, {1, -0.98, 0, 0, 0});
+    FrequencyResponse<double> fr_response(FrequencyResponse<double>::LogSpace(0.1, 3141, 2000), fr_Ts);
+
+    std::vector<TfPolynomials> fr_loops;
+    for (size_t i = 0; i < 10000; i++) {
+        pid::static_dispatch::PI<double, static_dispatch::DiscreteIntegrator<double>> pi{0.01 * (i + 1), 20, fr_Ts};
+        fr_loops.push_back(OpenLoopTf(LinearTf(pi), LinearTf(fr_plant)));
+    }
+
+    timer.Start();
+    auto fr_margins = fr_response.MarginsBatch(fr_loops);
+    duration        = timer.GetSecond();
+
+    size_t fr_stable = std::count_if(fr_margins.begin(), fr_margins.end(), [](const StabilityMargins<double> &m) { return m.stable; });
+    printf("==== frequency response (%zu loops x %zu frequencies): ====\n", fr_loops.size(), fr_response.Size());
+    printf("%g us per loop, stable: %zu, Kp = 5: gain margin %g at %g rad/s, phase margin %g deg at %g rad/s\n",
+           duration / fr_loops.size() * 1e6, fr_stable, fr_margins[499].gain_margin, fr_margins[499].phase_crossover_frequency,
+           fr_margins[499].phase_margin, fr_margins[499].gain_crossover_frequency);
+
+
+    // 采样周期可变的 PID：周期在名义值的 ±15% 内抖动，积分 cos(t) 的误差与固定周期的积分器对比
+    const float vts_Ts = 0.001f;
+    pid::VariableTsPID<float> vts_pid{1.2f, 10, 0.01f, 100, vts_Ts};
+    static_dispatch::DiscreteIntegrator<float> vts_fixed{1, vts_Ts};
+    static_dispatch::VariableTsIntegrator<float> vts_variable{1, vts_Ts};
+    std::mt19937 vts_rng(1);
+    std::uniform_real_distribution<float> vts_jitter(0.85f * vts_Ts, 1.15f * vts_Ts);
+
+    const size_t vts_steps = 100000;
+    std::vector<float> vts_dt(vts_steps);
+    for (auto &dt : vts_dt) {
+        dt = vts_jitter(vts_rng);
+    }
+
+    double vts_time = 0;
+    float vts_fixed_output = 0, vts_variable_output = 0;
+    for (size_t i = 0; i < vts_steps; i++) {
+        vts_time += vts_dt[i];
+        vts_fixed_output    = vts_fixed.Step(std::cos(float(vts_time)));
+        vts_variable_output = vts_variable.Step(std::cos(float(vts_time)), vts_dt[i]);
+    }
+
+    float vts_output = 0;
+    timer.Start();
+    for (size_t i = 0; i < vts_steps; i++) {
+        vts_output = vts_pid.Step(1 - vts_output * 0.001f, vts_dt[i]);
+    }
+    duration = timer.GetSecond();
+    printf("==== variable-Ts PID (+-15%% jitter): ====\n");
+    printf("%g ns per step, output: %g, derivative cache misses: %zu, integral error fixed: %g, variable: %g\n",
+           duration / vts_steps * 1e9, vts_output, vts_pid.d_controller.GetCacheMisses(), std::abs(vts_fixed_output - std::sin(vts_time)),
+           std::abs(vts_variable_output - std::sin(vts_time)));
+
+
+    // 定点数：同一组参数的 Q31、Q16.16 控制器与 double 控制器对比，统计输出的最大误差（Q31 的信号，包括 input * Ki，都要在 [-1, 1) 内）
+    pid::PID_AntiWindup<Q31> fx_pid{0.5, 0.5, 0.001, 100, 0.001, 1, -0.9, 0.9};
+    pid::PID_AntiWindup<Fixed<int32_t, 16>> fx_pid16{0.5, 0.5, 0.001, 100, 0.001, 1, -0.9, 0.9};
+    pid::PID_AntiWindup<double> fx_pid_ref{0.5, 0.5, 0.001, 100, 0.001, 1, -0.9, 0.9};
+    // Q15 的 PID：Ki * Ts / 2 * u 约为 1e-5，小于 Q15 的分辨率，积分器的状态为 Q31 才能累积
+    pid::PID<Q15> fx_pid15{0.5, 0.05, 0.001, 100, 0.001};
+    pid::PID<double> fx_pid15_ref{0.5, 0.05, 0.001, 100, 0.001};
+    ZTf<Q31> fx_filter({0.0025, 0.005, 0.0025}, {1, -1.8, 0.81});
+    ZTf<Q15> fx_filter15({0.0025, 0.005, 0.0025}, {1, -1.8, 0.81});
+    ZTf<double> fx_filter_ref({0.0025, 0.005, 0.0025}, {1, -1.8, 0.81});
+
+    const size_t fx_steps = 100000;
+    std::vector<double> fx_input(fx_steps);
+    for (size_t i = 0; i < fx_steps; i++) {
+        fx_input[i] = 0.5 * std::sin(i * 0.002) + 0.1 * std::sin(i * 0.37);
+    }
+
+    double fx_pid_error = 0, fx_pid16_error = 0, fx_pid15_error = 0, fx_filter_error = 0, fx_filter15_error = 0;
+    for (size_t i = 0; i < fx_steps; i++) {
+        auto reference    = fx_pid_ref.Step(fx_input[i]);
+        fx_pid_error      = std::max(fx_pid_error, std::abs(static_cast<double>(fx_pid.Step(fx_input[i])) - reference));
+        fx_pid16_error    = std::max(fx_pid16_error, std::abs(static_cast<double>(fx_pid16.Step(fx_input[i])) - reference));
+        reference         = fx_pid15_ref.Step(fx_input[i]);
+        fx_pid15_error    = std::max(fx_pid15_error, std::abs(static_cast<double>(fx_pid15.Step(fx_input[i])) - reference));
+        reference         = fx_filter_ref.Step(fx_input[i]);
+        fx_filter_error   = std::max(fx_filter_error, std::abs(static_cast<double>(fx_filter.Step(fx_input[i])) - reference));
+        fx_filter15_error = std::max(fx_filter15_error, std::abs(static_cast<double>(fx_filter15.Step(fx_input[i])) - reference));
+    }
+
+    std::vector<Q31> fx_q31_input(fx_input.begin(), fx_input.end());
+    Q31 fx_output = 0;
+    fx_pid.ResetState();
+    timer.Start();
+    for (size_t i = 0; i < fx_steps; i++) {
+        fx_output = fx_pid.Step(fx_q31_input[i]);
+    }
+    duration = timer.GetSecond();
+    printf("==== fixed point vs double (max abs error): ====\n");
+    printf("PID_AntiWindup Q31: %g, Q16.16: %g, PID Q15: %g, ZTf Q31: %g, Q15: %g, Q31 PID %g ns per step, output: %g\n",
+           fx_pid_error, fx_pid16_error, fx_pid15_error, fx_filter_error, fx_filter15_error, duration / fx_steps * 1e9,
+           static_cast<double>(fx_output));
+
     return 0;
 }
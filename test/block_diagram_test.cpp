@@ -0,0 +1,119 @@
+#include "check.hpp"
+#include "control_system/block_diagram.hpp"
+#include "control_system/pid_controller.hpp"
+#include "control_system/z_tf.hpp"
+#include <vector>
+
+using namespace control_system;
+
+// 增益为 1 的串联直接读取源信号，结果与直接串联逐位相同
+static void UnitGainChain()
+{
+    BlockDiagram<float> diagram;
+    auto input = diagram.AddInput();
+    auto a     = diagram.AddBlock(ZTf<float>({0.2}, {1, -0.8}));
+    auto b     = diagram.AddBlock(ZTf<float>({0.5, 0.1}, {1, -0.3}));
+    diagram.Connect(input, a);
+    diagram.Connect(a, b);
+    diagram.AddOutput(b);
+    CHECK(diagram.Compile());
+
+    ZTf<float> ra({0.2}, {1, -0.8}), rb({0.5, 0.1}, {1, -0.3});
+    for (int k = 0; k < 50; k++) {
+        float u = float(k % 7) - 3, y;
+        diagram.Step(&u, &y);
+        CHECK(y == rb.Step(ra.Step(u)));
+    }
+}
+
+// 单条非 1 增益、多条连线求和、经 UnitDelay 的反馈混在一起
+static void MixedEdges()
+{
+    BlockDiagram<float> diagram;
+    auto r     = diagram.AddInput();
+    auto gain  = diagram.AddBlock(ZTf<float>({1}, {1}));
+    auto sum   = diagram.AddBlock(ZTf<float>({1}, {1}));
+    auto delay = diagram.AddUnitDelay(0.25f);
+    diagram.Connect(r, gain, 2);      // gain = 2 r
+    diagram.Connect(gain, sum);       // sum = gain - delay
+    diagram.Connect(delay, sum, -1);
+    diagram.Connect(sum, delay);      // delay = 上一个周期的 sum
+    diagram.AddOutput(sum);
+    CHECK(diagram.Compile());
+
+    float u = 1, y, previous = 0.25f;
+    for (int k = 0; k < 5; k++) {
+        diagram.Step(&u, &y);
+        CHECK(y == 2 * u - previous);
+        previous = y;
+    }
+
+    // 重新编译后信号和状态都回到初值
+    CHECK(diagram.Compile());
+    CHECK(diagram.GetSignal(sum) == 0);
+    diagram.Step(&u, &y);
+    CHECK(y == 2 - 0.25f);
+}
+
+// 搭建一个两输入两输出的框图，with_delay 时加上经 UnitDelay 的反馈
+static void BuildMimo(BlockDiagram<float> &diagram, bool with_delay)
+{
+    auto r     = diagram.AddInput();
+    auto d     = diagram.AddInput();
+    auto pid   = diagram.AddBlock(pid::PID<float>{1.2, 0.5, 0.01, 100, 0.01});
+    auto plant = diagram.AddBlock(ZTf<float>({0.1}, {1, -0.9}));
+    auto sat   = diagram.AddBlock(Saturation<float, float>{-1, 1});
+    diagram.Connect(r, pid);
+    diagram.Connect(d, pid, -0.5f);
+    diagram.Connect(pid, plant);
+    diagram.Connect(plant, sat, 3);
+    if (with_delay) {
+        auto delay = diagram.AddUnitDelay();
+        diagram.Connect(plant, delay);
+        diagram.Connect(delay, pid, -1);
+    }
+    diagram.AddOutput(sat);
+    diagram.AddOutput(r);
+}
+
+// StepBlock() 跨越多个 kBlockSize 的块，与逐个 Step() 逐位相同，之后 GetSignal() 是最后一个周期的值
+static void StepBlockMatchesStep()
+{
+    for (bool with_delay : {false, true}) {
+        BlockDiagram<float> blocked, stepped;
+        BuildMimo(blocked, with_delay);
+        BuildMimo(stepped, with_delay);
+        CHECK(blocked.Compile() && stepped.Compile());
+
+        const size_t n = 2 * BlockDiagram<float>::kBlockSize + 7;
+        std::vector<float> r(n), d(n), y0(n), y1(n);
+        for (size_t k = 0; k < n; k++) {
+            r[k] = float(k % 11) * 0.1f;
+            d[k] = float(k % 5) - 2;
+        }
+        const float *inputs[] = {r.data(), d.data()};
+        float *outputs[]      = {y0.data(), y1.data()};
+        blocked.StepBlock(inputs, outputs, 5);
+        blocked.StepBlock(inputs, outputs, 0);
+        const float *rest_inputs[] = {r.data() + 5, d.data() + 5};
+        float *rest_outputs[]      = {y0.data() + 5, y1.data() + 5};
+        blocked.StepBlock(rest_inputs, rest_outputs, n - 5);
+
+        for (size_t k = 0; k < n; k++) {
+            float u[] = {r[k], d[k]}, y[2];
+            stepped.Step(u, y);
+            CHECK(y0[k] == y[0] && y1[k] == y[1]);
+        }
+        for (size_t node = 0; node < stepped.NodeCount(); node++) {
+            CHECK(blocked.GetSignal(node) == stepped.GetSignal(node));
+        }
+    }
+}
+
+int main()
+{
+    UnitGainChain();
+    MixedEdges();
+    StepBlockMatchesStep();
+    return CheckFailures();
+}
@@ -0,0 +1,30 @@
+/**
+ * @file check.hpp
+ * @author X. Y.
+ * @brief 测试用的检查宏
+ * @version 0.1
+ * @date 2023-09-08
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * 与 assert 不同，Release（NDEBUG）下也检查；失败时打印位置，main() 返回 CheckFailures() 作为退出码
+ *
+ */
+
+#pragma once
+
+#include <cstdio>
+
+inline int &CheckFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            CheckFailures()++;                                                             \
+        }                                                                                  \
+    } while (0)
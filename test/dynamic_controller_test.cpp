@@ -0,0 +1,122 @@
+#include "check.hpp"
+#include "control_system/block_algebra.hpp"
+#include "control_system/block_diagram.hpp"
+#include "control_system/pid_controller.hpp"
+#include "control_system/z_tf.hpp"
+#include <vector>
+
+using namespace control_system;
+
+// 虚函数接口的类型可以再派生，构造函数的初始化列表中直接写 ZTf<float>，重写的 Step() 通过基类的引用调用
+struct DoubledTf : ZTf<float> {
+    DoubledTf(const std::vector<float> &num, const std::vector<float> &den)
+        : ZTf<float>(num, den) {};
+
+    float Step(float input) override
+    {
+        return 2 * ZTf<float>::Step(input);
+    }
+};
+
+struct FixedTf : control_system::ZTf<float> {
+    FixedTf()
+        : ZTf<float>({1}, {1, -0.5}) {}
+};
+
+static void PublicTypesCanBeDerived()
+{
+    DoubledTf doubled({1}, {1, -0.5});
+    ZTf<float> plain({1}, {1, -0.5});
+    DiscreteControllerBase<float> &controller = doubled;
+
+    for (int k = 0; k < 10; k++) {
+        CHECK(controller.Step(1) == 2 * plain.Step(1));
+    }
+
+    // StepBlock() 也调用重写的 Step()：0, 2, 3, ...
+    DoubledTf blocked({1, 0}, {1, -0.5}), stepped({1, 0}, {1, -0.5});
+    DiscreteControllerBase<float> &block_controller = blocked;
+    std::vector<float> input{0, 1, 1, 1, 1}, output(input.size());
+    block_controller.StepBlock(input.data(), output.data(), input.size());
+    for (size_t k = 0; k < input.size(); k++) {
+        CHECK(output[k] == stepped.Step(input[k]));
+    }
+    CHECK(output[1] == 2 && output[2] == 3);
+
+    // 框图中也调用重写的 Step()
+    BlockDiagram<float> diagram;
+    auto u = diagram.AddInput();
+    auto g = diagram.AddBlock(DoubledTf({1, 0}, {1, -0.5}));
+    diagram.Connect(u, g);
+    diagram.AddOutput(g);
+    CHECK(diagram.Compile());
+    float y, one = 1;
+    diagram.Step(&one, &y);
+    CHECK(y == 2);
+
+    // 没有重写的派生类与 ZTf 相同
+    FixedTf fixed;
+    ZTf<float> reference({1}, {1, -0.5});
+    fixed.StepBlock(input.data(), output.data(), input.size());
+    for (size_t k = 0; k < input.size(); k++) {
+        CHECK(output[k] == reference.Step(input[k]));
+    }
+}
+
+// 公开类型参与组合时取出其中的 static_dispatch 类型，限幅器转换为 SaturationBlock
+static void CompositionUsesStaticTypes()
+{
+    auto series = Series(pid::P<float>{2}, Saturation<float, float>{-1, 1});
+    static_assert(std::is_same<decltype(series), SeriesBlock<pid::static_dispatch::P<float>, SaturationBlock<float>>>::value, "");
+    CHECK(series.Step(0.25f) == 0.5f && series.Step(1) == 1);
+}
+
+// 虚函数接口的组合控制器中，积分器和微分器也是虚函数接口的类型
+static void CompositeMembersAreDynamic()
+{
+    pid::PID<float> pid_controller{1, 2, 0.1, 100, 0.01};
+    pid::PID<float> reference{1, 2, 0.1, 100, 0.01};
+    DiscreteControllerBase<float> &integrator = pid_controller.i_controller;
+    DiscreteControllerBase<float> &derivative = pid_controller.d_controller;
+
+    for (int k = 0; k < 10; k++) {
+        float output = pid_controller.Step(1);
+        CHECK(output == reference.Step(1));
+    }
+    integrator.ResetState();
+    derivative.ResetState();
+    CHECK(pid_controller.i_controller.GetStateOutput() == 0);
+    CHECK(pid_controller.d_controller.GetLastOutput() == 0);
+
+    pid::PID_AntiWindup<float> anti_windup{1, 2, 0.1, 100, 0.01, 1, -1, 1};
+    pid::PD<float> pd_controller{1, 0.1, 100, 0.01};
+    pid::PI<float> pi_controller{1, 2, 0.01};
+    DiscreteControllerBase<float> &d1 = anti_windup.d_controller;
+    DiscreteControllerBase<float> &d2 = pd_controller.d_controller;
+    DiscreteControllerBase<float> &i1 = pi_controller.i_controller;
+    CHECK(d1.Step(1) == d2.Step(1));
+    CHECK(i1.Step(1) == 0.01f);
+}
+
+// 带限幅的积分器的 StepBlock() 与逐个 Step() 相同（不能继承不限幅的 DiscreteIntegrator::StepBlock()）
+static void SaturatedIntegratorBlockMatchesStep()
+{
+    DiscreteIntegratorSaturation<float> stepped{{100, 0.01}, {-1, 1}};
+    DiscreteIntegratorSaturation<float> blocked{{100, 0.01}, {-1, 1}};
+
+    std::vector<float> input(50, 1), output(50);
+    blocked.StepBlock(input.data(), output.data(), input.size());
+    for (size_t k = 0; k < input.size(); k++) {
+        CHECK(output[k] == stepped.Step(input[k]));
+        CHECK(output[k] <= 1);
+    }
+}
+
+int main()
+{
+    PublicTypesCanBeDerived();
+    CompositionUsesStaticTypes();
+    CompositeMembersAreDynamic();
+    SaturatedIntegratorBlockMatchesStep();
+    return CheckFailures();
+}
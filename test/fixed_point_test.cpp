@@ -0,0 +1,157 @@
+#include "check.hpp"
+#include "control_system/fixed_point.hpp"
+#include "control_system/pid_controller.hpp"
+#include "control_system/z_tf.hpp"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace control_system;
+
+using Q16_16 = Fixed<int32_t, 16>;
+
+// 加、减、取负在 [-1, 1) 之外饱和，不回绕
+static void SaturatingAddSubtract()
+{
+    CHECK(Q15(0.75) + Q15(0.75) == std::numeric_limits<Q15>::max());
+    CHECK(Q15(-0.75) - Q15(0.75) == std::numeric_limits<Q15>::lowest());
+    CHECK(Q31(0.25) + Q31(0.5) == Q31(0.75));
+    CHECK(-Q31(-1) == std::numeric_limits<Q31>::max());
+    CHECK(Q16_16(30000) + Q16_16(30000) == std::numeric_limits<Q16_16>::max());
+}
+
+// 乘法四舍五入（正好一半时向正无穷），(-1) * (-1) = 1 饱和为最大值
+static void Multiply()
+{
+    CHECK(Q31(-1) * Q31(-1) == std::numeric_limits<Q31>::max());
+    CHECK(Q15(-1) * Q15(-1) == std::numeric_limits<Q15>::max());
+    CHECK(Q31(-1) * Q31(0.5) == Q31(-0.5));
+    CHECK(Q16_16(300) * Q16_16(300) == std::numeric_limits<Q16_16>::max());
+    CHECK(Q16_16(-1.5) * Q16_16(2) == Q16_16(-3));
+
+    CHECK((Q15::FromRaw(1) * Q15(0.5)).Raw() == 1);  // 0.5 LSB -> 1
+    CHECK((Q15::FromRaw(-1) * Q15(0.5)).Raw() == 0); // -0.5 LSB -> 0
+    CHECK((Q15::FromRaw(3) * Q15(0.5)).Raw() == 2);  // 1.5 LSB -> 2
+}
+
+// 除法向零舍入，溢出和除以 0 时按被除数的符号饱和
+static void Divide()
+{
+    CHECK(Q31(0.25) / Q31(0.5) == Q31(0.5));
+    CHECK(Q31(0.5) / Q31(0.25) == std::numeric_limits<Q31>::max());
+    CHECK(Q31(-0.5) / Q31(0.25) == std::numeric_limits<Q31>::lowest());
+    CHECK((Q15::FromRaw(1) / Q15::FromRaw(3)).Raw() == 10922);
+    CHECK((Q15::FromRaw(-1) / Q15::FromRaw(3)).Raw() == -10922);
+
+    CHECK(Q31(0.5) / Q31(0) == std::numeric_limits<Q31>::max());
+    CHECK(Q31(-0.5) / Q31(0) == std::numeric_limits<Q31>::lowest());
+    CHECK(Q31(0) / Q31(0) == std::numeric_limits<Q31>::max());
+    CHECK(Q16_16(-3) / Q16_16(0) == std::numeric_limits<Q16_16>::lowest());
+}
+
+// 由 double 构造时四舍五入（一半时远离 0）并饱和，NaN 为 0
+static void ConstructFromDouble()
+{
+    CHECK(Q15(1.0 / 65536).Raw() == 1);
+    CHECK(Q15(-1.0 / 65536).Raw() == -1);
+    CHECK(Q15(0.4 / 32768).Raw() == 0);
+    CHECK(Q31(1.0) == std::numeric_limits<Q31>::max());
+    CHECK(Q31(-1.0).Raw() == INT32_MIN);
+    CHECK(Q31(-2.0).Raw() == INT32_MIN);
+    CHECK(Q31(NAN).Raw() == 0);
+    CHECK(Q16_16(1.5).Raw() == 3 << 15);
+    CHECK(static_cast<double>(Q16_16(-2.25)) == -2.25);
+}
+
+// Q15 -> Q31（积分器的状态）不丢失精度，可以隐式转换；反过来四舍五入并饱和
+static void ConvertQ15ToQ31()
+{
+    static_assert(std::is_same<NumericTraits<Q15>::StateType, Q31>::value, "Q15 的状态为 Q31");
+    static_assert(std::is_same<NumericTraits<Q31>::StateType, Q31>::value, "");
+    static_assert(std::is_convertible<Q15, Q31>::value && !std::is_convertible<Q31, Q15>::value, "");
+
+    Q31 state = Q15::FromRaw(12345);
+    CHECK(state.Raw() == 12345 << 16);
+    state = Q15::FromRaw(-32768);
+    CHECK(state.Raw() == INT32_MIN);
+    state = Q15::FromRaw(32767);
+    CHECK(state.Raw() == int32_t(32767) << 16);
+
+    CHECK(Q15(Q31::FromRaw(INT32_MAX)) == std::numeric_limits<Q15>::max());
+    CHECK(Q15(Q31::FromRaw(int32_t(12345) << 16 | 0x8000)).Raw() == 12346);
+    CHECK(Q15(Q16_16(3)) == std::numeric_limits<Q15>::max());
+    CHECK(Q15(Q16_16(-0.5)) == Q15(-0.5));
+}
+
+// FixedCoefficient：尾数用满 31 位，大小相差很大的系数的相对误差都不超过 2^-31
+static void CoefficientShift()
+{
+    FixedCoefficient<Q31> small(0.0005);
+    CHECK(small.GetShift() == 41);
+    CHECK(small.GetMantissa() >= (1 << 30));
+    CHECK(std::abs(double(small) - 0.0005) <= 0.0005 * std::ldexp(1, -31));
+
+    FixedCoefficient<Q31> large(50), negative(-0.3);
+    CHECK(large.GetShift() == 25 && double(large) == 50);
+    CHECK(negative.GetMantissa() <= -(1 << 30));
+    CHECK(std::abs(double(negative) + 0.3) <= 0.3 * std::ldexp(1, -31));
+
+    // 四舍五入进位到 2^31 时少移一位
+    FixedCoefficient<Q31> carry(1 - std::ldexp(1, -40));
+    CHECK(carry.GetShift() == 30 && carry.GetMantissa() == (1 << 30));
+
+    // 绝对值不小于 2^31 时饱和，0 和 NaN 为 0
+    FixedCoefficient<Q31> huge(1e10), zero(0.0), nan(NAN);
+    CHECK(huge.GetShift() == 0 && huge.GetMantissa() == INT32_MAX);
+    CHECK(zero.GetMantissa() == 0 && nan.GetMantissa() == 0);
+
+    // 与信号相乘：结果四舍五入，溢出时饱和
+    CHECK(std::abs(static_cast<double>(small * Q31(0.5)) - 0.00025) <= std::ldexp(1, -31));
+    CHECK(large * Q31(0.5) == std::numeric_limits<Q31>::max());
+    CHECK(Q15(0.5) * FixedCoefficient<Q15>(-1.0) == Q15(-0.5));
+}
+
+// 与 double 的控制器相比，输出的最大误差（同一组参数，输入在 [-0.6, 0.6] 内）
+static void ControllerErrorBounds()
+{
+    pid::PID_AntiWindup<Q31> pid31{0.5, 0.5, 0.001, 100, 0.001, 1, -0.9, 0.9};
+    pid::PID_AntiWindup<Q16_16> pid16{0.5, 0.5, 0.001, 100, 0.001, 1, -0.9, 0.9};
+    pid::PID_AntiWindup<double> pid_reference{0.5, 0.5, 0.001, 100, 0.001, 1, -0.9, 0.9};
+    pid::PID<Q15> pid15{0.5, 0.05, 0.001, 100, 0.001};
+    pid::PID<double> pid15_reference{0.5, 0.05, 0.001, 100, 0.001};
+    ZTf<Q31> filter31({0.0025, 0.005, 0.0025}, {1, -1.8, 0.81});
+    ZTf<Q15> filter15({0.0025, 0.005, 0.0025}, {1, -1.8, 0.81});
+    ZTf<double> filter_reference({0.0025, 0.005, 0.0025}, {1, -1.8, 0.81});
+
+    double pid31_error = 0, pid16_error = 0, pid15_error = 0, filter31_error = 0, filter15_error = 0;
+    for (int k = 0; k < 20000; k++) {
+        const double u = 0.5 * std::sin(k * 0.002) + 0.1 * std::sin(k * 0.37);
+
+        double reference = pid_reference.Step(u);
+        pid31_error      = std::max(pid31_error, std::abs(static_cast<double>(pid31.Step(Q31(u))) - reference));
+        pid16_error      = std::max(pid16_error, std::abs(static_cast<double>(pid16.Step(Q16_16(u))) - reference));
+        reference        = pid15_reference.Step(u);
+        pid15_error      = std::max(pid15_error, std::abs(static_cast<double>(pid15.Step(Q15(u))) - reference));
+        reference        = filter_reference.Step(u);
+        filter31_error   = std::max(filter31_error, std::abs(static_cast<double>(filter31.Step(Q31(u))) - reference));
+        filter15_error   = std::max(filter15_error, std::abs(static_cast<double>(filter15.Step(Q15(u))) - reference));
+    }
+
+    CHECK(pid31_error < 1e-6);
+    CHECK(pid16_error < 5e-3);
+    CHECK(pid15_error < 2e-4);
+    CHECK(filter31_error < 1e-6);
+    CHECK(filter15_error < 5e-3);
+}
+
+int main()
+{
+    SaturatingAddSubtract();
+    Multiply();
+    Divide();
+    ConstructFromDouble();
+    ConvertQ15ToQ31();
+    CoefficientShift();
+    ControllerErrorBounds();
+    return CheckFailures();
+}
@@ -0,0 +1,43 @@
+#include "check.hpp"
+#include "control_system/frequency_response.hpp"
+#include <cmath>
+
+using namespace control_system;
+
+// L = K / (z + 0.5)：L(-1) = -2K 为负实数，相角穿越正好在 Nyquist 频率上
+static void PhaseCrossoverAtNyquist()
+{
+    const double Ts = 0.001;
+    FrequencyResponse<double> response(FrequencyResponse<double>::LogSpace(0.1, 3141, 2000), Ts); // 停在 π / Ts 之前
+
+    for (double K : {0.1, 1.0, 5.0}) {
+        TfPolynomials loop{{K}, {1, 0.5}};
+        auto margins = response.Margins(loop);
+
+        CHECK(std::abs(margins.gain_margin - 1 / (2 * K)) < 1e-12);
+        CHECK(std::abs(margins.phase_crossover_frequency - std::acos(-1.0) / Ts) < 1e-9);
+        CHECK(margins.stable == (margins.gain_margin > 1)); // 闭环特征多项式 z + 0.5 + K
+    }
+}
+
+// 相角穿越在频率点之间时仍由插值得到：L = 0.5 / (z (z - 0.5))
+static void PhaseCrossoverInsideGrid()
+{
+    const double Ts = 0.001;
+    FrequencyResponse<double> response(FrequencyResponse<double>::LogSpace(0.1, 3141, 20000), Ts);
+    TfPolynomials loop{{0.5}, {1, -0.5, 0}};
+    auto margins = response.Margins(loop);
+
+    // ∠L = -180° 处：z = e^{jθ}，cos θ = 0.25，|L| = 0.5 / |z - 0.5| = 0.5 / sqrt(1.25 - cos θ)
+    const double gain_margin = std::sqrt(1.25 - 0.25) / 0.5;
+    CHECK(std::abs(margins.gain_margin - gain_margin) < 1e-3);
+    CHECK(std::abs(margins.phase_crossover_frequency - std::acos(0.25) / Ts) < 1);
+    CHECK(margins.stable);
+}
+
+int main()
+{
+    PhaseCrossoverAtNyquist();
+    PhaseCrossoverInsideGrid();
+    return CheckFailures();
+}
@@ -0,0 +1,45 @@
+#include "check.hpp"
+#include "control_system/gain_scheduled_pid.hpp"
+#include "control_system/pid_controller.hpp"
+#include <algorithm>
+#include <vector>
+
+using namespace control_system;
+
+// 调度变量停在某个断点上（包括最后一个以及超出范围）时，与该断点参数的 pid::PID 逐位相同
+static void MatchesPidAtBreakpoints()
+{
+    const std::vector<float> breakpoints{0, 700, 1900, 3100};
+    const std::vector<float> Kp{1.0f, 1.3f, 0.7f, 1.9f}, Ki{10, 13, 17, 31}, Kd{0.01f, 0.02f, 0.03f, 0.07f}, Kn{100, 90, 80, 70};
+    const std::vector<float> schedule{0, 700, 1900, 3100, 5000};
+
+    for (float s : schedule) {
+        const size_t i = std::min<size_t>(std::lower_bound(breakpoints.begin(), breakpoints.end(), s) - breakpoints.begin(), 3);
+        pid::GainScheduledPID<float> scheduled(breakpoints, Kp, Ki, Kd, Kn, 0.001f);
+        pid::PID<float> reference{Kp[i], Ki[i], Kd[i], Kn[i], 0.001f};
+
+        for (int k = 0; k < 100; k++) {
+            const float input = float(k % 9) * 0.3f - 1;
+            CHECK(scheduled.Step(input, s) == reference.Step(input));
+        }
+    }
+}
+
+// 离开最后一个断点后回到中间，仍然按所在的段插值
+static void LeavesTopSegment()
+{
+    pid::GainScheduledPID<double> scheduled({0, 1000, 3000}, {1.0, 1.5, 2.0}, {10, 15, 30}, {0, 0, 0}, {100, 100, 100}, 0.001);
+    scheduled.SetSchedulingVariable(4000);
+    CHECK(scheduled.GetGains().Kp == 2.0);
+    scheduled.SetSchedulingVariable(2000);
+    CHECK(scheduled.GetGains().Kp == 1.75);
+    scheduled.SetSchedulingVariable(500);
+    CHECK(scheduled.GetGains().Kp == 1.25);
+}
+
+int main()
+{
+    MatchesPidAtBreakpoints();
+    LeavesTopSegment();
+    return CheckFailures();
+}
@@ -0,0 +1,66 @@
+#include "check.hpp"
+#include "control_system/lookup_table.hpp"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace control_system;
+
+static const float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+// NaN 输入取第一个断点处的值，而不是把 NaN 转换为下标
+static void NaNInput()
+{
+    static_dispatch::LookupTable1D<float> even({0, 1, 2, 3}, {5, 6, 7, 8});
+    static_dispatch::LookupTable1D<float> uneven({0, 1, 2, 4}, {5, 6, 7, 8});
+    static_dispatch::LookupTable1D<float> nearest({0, 1, 2, 4}, {5, 6, 7, 8}, Interpolation::Nearest);
+
+    CHECK(even.Step(kNaN) == 5);
+    CHECK(uneven.Step(kNaN) == 5);
+    CHECK(nearest.Step(kNaN) == 5);
+
+    float input[3] = {kNaN, 1.5f, kNaN};
+    float output[3];
+    even.StepBlock(input, output, 3);
+    CHECK(output[0] == 5 && output[1] == 6.5f && output[2] == 5);
+
+    LookupTable2D<float> map({{0, 1, 2}, {0, 10}}, {0, 1, 2, 3, 4, 5});
+    CHECK(map(kNaN, 0.0f) == 0);
+    CHECK(map(1.0f, kNaN) == 1);
+}
+
+// EvaluateBlock() 与逐点调用 Evaluate() 逐位一致，包括不足一批的尾部
+static void BlockMatchesScalar(const std::vector<std::vector<float>> &breakpoints, Interpolation interpolation)
+{
+    std::vector<float> table(breakpoints[0].size() * breakpoints[1].size() * breakpoints[2].size());
+    for (size_t i = 0; i < table.size(); i++) {
+        table[i] = std::sin(float(i));
+    }
+    LookupTableND<float, 3> block(breakpoints, table, interpolation);
+    LookupTableND<float, 3> scalar(breakpoints, table, interpolation);
+
+    const size_t n = 150;
+    std::vector<float> x0(n), x1(n), x2(n), output(n);
+    for (size_t k = 0; k < n; k++) {
+        x0[k] = -0.5f + 0.03f * float(k);
+        x1[k] = 2.0f * std::cos(0.1f * float(k));
+        x2[k] = float(k % 7) - 1.0f;
+    }
+    x0[17] = kNaN;
+
+    block.EvaluateBlock({x0.data(), x1.data(), x2.data()}, output.data(), n);
+    for (size_t k = 0; k < n; k++) {
+        float expected = scalar.Evaluate({x0[k], x1[k], x2[k]});
+        CHECK(std::memcmp(&expected, &output[k], sizeof(float)) == 0);
+    }
+}
+
+int main()
+{
+    NaNInput();
+    BlockMatchesScalar({{0, 1, 2, 3}, {-1, 0, 1}, {0, 1, 2, 3, 4}}, Interpolation::Linear);
+    BlockMatchesScalar({{0, 0.5, 2, 3}, {-1, 0.2, 1}, {0, 1, 3, 4, 4.5}}, Interpolation::Linear);
+    BlockMatchesScalar({{0, 0.5, 2, 3}, {-1, 0, 1}, {0, 1, 3, 4, 4.5}}, Interpolation::Nearest);
+    return CheckFailures();
+}
@@ -0,0 +1,57 @@
+#include "check.hpp"
+#include "control_system/multirate_scheduler.hpp"
+#include <vector>
+
+using namespace control_system;
+
+// 慢 -> 快：慢回路在第 0 拍写入的值，快回路正好在第 10 拍（一个慢周期后）第一次读到
+static void SlowToFastDelaysOneSlowPeriod()
+{
+    MultiRateScheduler scheduler(1);
+    RateTransition<int> transition{-1};
+    std::vector<int> seen;
+    uint64_t tick = 0;
+
+    scheduler.AddTask([&] { transition.Write(int(tick)); }, 10);
+    scheduler.AddRateTransition(transition, 10);
+    scheduler.AddTask([&] { seen.push_back(transition.Read()); }, 1);
+
+    for (tick = 0; tick < 30; tick++) {
+        scheduler.Tick();
+    }
+
+    for (size_t k = 0; k < seen.size(); k++) {
+        int expected = k < 10 ? -1 : int(k / 10 - 1) * 10;
+        CHECK(seen[k] == expected);
+    }
+}
+
+// 快 -> 慢：慢回路每次看到的是快回路在上一拍写入的值（零阶保持）
+static void FastToSlowIsZeroOrderHold()
+{
+    MultiRateScheduler scheduler(1);
+    RateTransition<int> transition{-1};
+    std::vector<int> seen;
+    uint64_t tick = 0;
+
+    scheduler.AddTask([&] { transition.Write(int(tick)); }, 1);
+    scheduler.AddRateTransition(transition, 10);
+    scheduler.AddTask([&] { seen.push_back(transition.Read()); }, 10);
+
+    for (tick = 0; tick < 40; tick++) {
+        scheduler.Tick();
+    }
+
+    CHECK(seen.size() == 4);
+    CHECK(seen[0] == -1);
+    for (size_t k = 1; k < seen.size(); k++) {
+        CHECK(seen[k] == int(k * 10 - 1));
+    }
+}
+
+int main()
+{
+    SlowToFastDelaysOneSlowPeriod();
+    FastToSlowIsZeroOrderHold();
+    return CheckFailures();
+}
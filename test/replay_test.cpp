@@ -0,0 +1,116 @@
+#include "check.hpp"
+#include "control_system/replay.hpp"
+#include "control_system/pid_controller.hpp"
+#include "control_system/z_tf.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace control_system;
+
+static const std::string kInput    = "replay_test_input.signal";
+static const std::string kMissing  = "replay_test_missing.signal";
+static const std::string kOutput[] = {"replay_test_output0.signal", "replay_test_output1.signal"};
+
+// 输出文件原来的内容：一个通道，值为 42
+static void WriteOldOutputs()
+{
+    for (const auto &path : kOutput) {
+        CHECK(WriteSignalFile<float>(path, {{42}}));
+    }
+}
+
+static bool OutputsUntouched()
+{
+    for (const auto &path : kOutput) {
+        SignalFile<float> file;
+        if (!file.Open(path) || file.SampleCount() != 1 || file.Channel(0)[0] != 42) return false;
+    }
+    return true;
+}
+
+// 第二个输入文件不存在时，第一个输出文件也不会被创建（截断）
+static void MissingInputKeepsOutputs()
+{
+    WriteOldOutputs();
+    std::remove(kMissing.c_str());
+
+    CHECK(!ReplayFiles<float>(ZTf<float>({0.5}, {1}), {kInput, kMissing}, {kOutput[0], kOutput[1]}));
+    CHECK(OutputsUntouched());
+
+    CHECK(ReplayFiles<float>(ZTf<float>({0.5}, {1}), {kInput, kInput}, {kOutput[0], kOutput[1]}));
+    SignalFile<float> file;
+    CHECK(file.Open(kOutput[1]) && file.SampleCount() == 3 && file.Channel(1)[2] == 3);
+}
+
+// 框图：第二个输入文件的通道数与框图不符时，输出文件保持原样
+static void DiagramChannelMismatchKeepsOutputs()
+{
+    WriteOldOutputs();
+    CHECK(WriteSignalFile<float>(kMissing, {{1, 2, 3}}));
+
+    auto build = [](BlockDiagram<float> &diagram) {
+        auto a = diagram.AddInput();
+        auto b = diagram.AddInput();
+        auto g = diagram.AddBlock(ZTf<float>({1}, {1}));
+        diagram.Connect(a, g);
+        diagram.Connect(b, g);
+        diagram.AddOutput(g);
+    };
+    CHECK(!ReplayDiagramFiles<float>(build, {kInput, kMissing}, {kOutput[0], kOutput[1]}));
+    CHECK(OutputsUntouched());
+}
+
+// 框图按块、按分片回放（预热到文件开头）与逐个 Step() 逐位相同
+static void DiagramShardsMatchStep()
+{
+    const size_t n = 1000;
+    std::vector<float> r(n), d(n);
+    for (size_t k = 0; k < n; k++) {
+        r[k] = float(k % 13) * 0.1f;
+        d[k] = float(k % 7) - 3;
+    }
+    CHECK(WriteSignalFile<float>(kMissing, {r, d}));
+
+    auto build = [](BlockDiagram<float> &diagram) {
+        auto a   = diagram.AddInput();
+        auto b   = diagram.AddInput();
+        auto pid = diagram.AddBlock(pid::PID<float>{1.2, 0.5, 0.01, 100, 0.01});
+        diagram.Connect(a, pid);
+        diagram.Connect(b, pid, -0.5f);
+        diagram.AddOutput(pid);
+    };
+    ReplayOptions options;
+    options.threads        = 3;
+    options.block_size     = 90;
+    options.shard_samples  = 300;
+    options.warmup_samples = n;
+    CHECK(ReplayDiagramFiles<float>(build, {kMissing}, {kOutput[0]}, options));
+
+    BlockDiagram<float> reference;
+    build(reference);
+    CHECK(reference.Compile());
+    SignalFile<float> file;
+    CHECK(file.Open(kOutput[0]) && file.ChannelCount() == 1 && file.SampleCount() == n);
+    for (size_t k = 0; k < n; k++) {
+        float u[] = {r[k], d[k]}, y;
+        reference.Step(u, &y);
+        CHECK(file.Channel(0)[k] == y);
+    }
+}
+
+int main()
+{
+    CHECK(WriteSignalFile<float>(kInput, {{1, 2, 3}, {4, 5, 6}}));
+
+    MissingInputKeepsOutputs();
+    DiagramChannelMismatchKeepsOutputs();
+    DiagramShardsMatchStep();
+
+    std::remove(kInput.c_str());
+    std::remove(kMissing.c_str());
+    for (const auto &path : kOutput) {
+        std::remove(path.c_str());
+    }
+    return CheckFailures();
+}
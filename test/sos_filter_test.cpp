@@ -0,0 +1,85 @@
+#include "check.hpp"
+#include "control_system/sos_filter.hpp"
+#include "control_system/polynomial.hpp"
+#include "control_system/z_tf.hpp"
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+using namespace control_system;
+
+// n 阶 Butterworth 低通经双线性变换得到的 Z 传递函数，分子为 (z+1)^n
+static void Butterworth(size_t n, double cutoff, double Ts, std::vector<double> &num, std::vector<double> &den)
+{
+    const double pi = std::acos(-1.0);
+    const double wc = 2 / Ts * std::tan(cutoff * Ts / 2); // 预畸变
+
+    std::vector<std::complex<double>> poles;
+    for (size_t k = 0; k < n; k++) {
+        auto s = std::polar(wc, pi / 2 + pi * (2 * k + 1) / (2 * n));
+        poles.push_back((2 / Ts + s) / (2 / Ts - s));
+    }
+
+    auto den_complex = PolyFromRoots(poles);
+    den.clear();
+    for (const auto &c : den_complex) {
+        den.push_back(c.real());
+    }
+
+    num = {1};
+    for (size_t k = 0; k < n; k++) {
+        num = PolyMultiply(num, std::vector<double>{1, 1});
+    }
+    num = PolyScale(num, PolyEval(den, 1.0) / PolyEval(num, 1.0)); // 直流增益为 1
+}
+
+// (z+1)^8 的 8 重根要求到接近机器精度，而不是 eps^(1/8)
+static void RepeatedRootsAreResolved()
+{
+    std::vector<double> p{1};
+    for (int k = 0; k < 8; k++) {
+        p = PolyMultiply(p, std::vector<double>{1, 1});
+    }
+
+    auto roots = PolyRoots(p);
+    CHECK(roots.size() == 8);
+    for (const auto &r : roots) {
+        CHECK(std::abs(r + 1.0) < 1e-12);
+    }
+
+    // 相距很近的不同的根不能被合并
+    roots = PolyRoots(PolyMultiply(std::vector<double>{1, -0.999}, std::vector<double>{1, -0.998}));
+    CHECK(roots.size() == 2);
+    CHECK(std::abs(std::abs(roots[0].real() - roots[1].real()) - 0.001) < 1e-9);
+}
+
+// 分子为 (z+1)^n 的滤波器分解为二阶节后，与直接型的 ZTf 输出一致
+static void SosMatchesZTfForTustinButterworth()
+{
+    for (size_t n = 2; n <= 8; n++) {
+        std::vector<double> num, den;
+        Butterworth(n, 2 * std::acos(-1.0) * 50, 0.001, num, den);
+
+        ZTf<double> direct(num, den);
+        SosFilter<double> cascade(num, den);
+
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> input(-1, 1);
+        double max_error = 0;
+        for (int k = 0; k < 20000; k++) {
+            auto x    = input(rng);
+            max_error = std::max(max_error, std::abs(direct.Step(x) - cascade.Step(x)));
+        }
+
+        CHECK(max_error < 1e-9);
+        if (max_error >= 1e-9) std::printf("  order %zu: max error %g\n", n, max_error);
+    }
+}
+
+int main()
+{
+    RepeatedRootsAreResolved();
+    SosMatchesZTfForTustinButterworth();
+    return CheckFailures();
+}
@@ -0,0 +1,109 @@
+#include "check.hpp"
+#include "control_system/trace_recorder.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace control_system;
+
+static const std::string kPath = "trace_recorder_test.bin";
+
+static void WriteTrace(size_t records)
+{
+    TraceChannel<float, 2> channel({"input", "output"});
+    TraceWriter writer(std::chrono::milliseconds(1), 64);
+    CHECK(writer.Add(channel, kPath));
+    for (size_t i = 0; i < records; i++) {
+        channel.Record(i, float(i), -float(i));
+    }
+    writer.Stop();
+    CHECK(!writer.HasWriteError());
+    CHECK(writer.GetLost() == 0);
+}
+
+static void RoundTrip()
+{
+    WriteTrace(200);
+
+    TraceData<float> data;
+    CHECK(LoadTrace(kPath, data));
+    CHECK(data.names.size() == 2 && data.names[1] == "output");
+    CHECK(data.ticks.size() == 200);
+    CHECK(data.columns.size() == 2 && data.columns[1].size() == 200);
+    CHECK(data.columns[1][199] == -199.0f);
+    CHECK(data.dropped == 0);
+}
+
+// 块头中的记录数与块的长度不符时拒绝读取，而不是越界复制
+static void RejectsInconsistentBlock()
+{
+    WriteTrace(10);
+
+    FILE *file = std::fopen(kPath.c_str(), "r+b");
+    CHECK(file != nullptr);
+    if (file == nullptr) return;
+
+    TraceFileHeader header;
+    TraceBlockHeader block;
+    CHECK(std::fread(&header, sizeof(header), 1, file) == 1);
+    CHECK(std::fseek(file, long(sizeof(header) + header.names_size), SEEK_SET) == 0);
+    CHECK(std::fread(&block, sizeof(block), 1, file) == 1);
+    CHECK(block.count == 10);
+
+    block.count = 1000;
+    CHECK(std::fseek(file, long(sizeof(header) + header.names_size), SEEK_SET) == 0);
+    CHECK(std::fwrite(&block, sizeof(block), 1, file) == 1);
+    std::fclose(file);
+
+    TraceData<float> data;
+    CHECK(!LoadTrace(kPath, data));
+}
+
+// 写不进去的文件（/dev/full 总是返回“磁盘已满”）：Add() 返回 false
+static void ReportsWriteFailure()
+{
+    FILE *full = std::fopen("/dev/full", "wb");
+    if (full == nullptr) return;
+    std::fclose(full);
+
+    TraceChannel<float, 2> channel({"input", "output"});
+    TraceWriter writer;
+    CHECK(!writer.Add(channel, "/dev/full"));
+}
+
+// Stop() 关闭文件之后的记录：FlushAll() 和再次 Start() 时算作丢失，不再写文件
+static void RecordsAfterStopAreLost()
+{
+    TraceChannel<float, 2> channel({"input", "output"});
+    TraceWriter writer(std::chrono::milliseconds(1), 64);
+    CHECK(writer.Add(channel, kPath));
+    channel.Record(0, 1, 2);
+    writer.Stop();
+
+    for (size_t i = 0; i < 3; i++) {
+        channel.Record(i + 1, 1, 2);
+    }
+    CHECK(writer.FlushAll() == 3);
+    CHECK(writer.GetLost() == 3);
+
+    channel.Record(4, 1, 2);
+    writer.Start();
+    writer.Stop();
+    writer.FlushAll(); // 后台线程可能在 Stop() 之前没有运行
+    CHECK(writer.GetLost() == 4);
+    CHECK(!writer.HasWriteError());
+
+    TraceData<float> data;
+    CHECK(LoadTrace(kPath, data));
+    CHECK(data.ticks.size() == 1);
+}
+
+int main()
+{
+    RoundTrip();
+    RejectsInconsistentBlock();
+    ReportsWriteFailure();
+    RecordsAfterStopAreLost();
+    std::remove(kPath.c_str());
+    return CheckFailures();
+}
@@ -0,0 +1,84 @@
+#include "check.hpp"
+#include "control_system/fixed_point.hpp"
+#include "control_system/variable_ts.hpp"
+#include <cmath>
+#include <vector>
+
+using namespace control_system;
+
+// 固定周期的部分与 DiscreteIntegrator 逐位相同，原地的 StepBlock() 之后 Step(input, dt) 用的是正确的上一个输入
+static void FixedPathMatchesIntegrator()
+{
+    static_dispatch::DiscreteIntegrator<float> fixed{2, 0.01f};
+    static_dispatch::VariableTsIntegrator<float> blocked{2, 0.01f}, stepped{2, 0.01f};
+
+    std::vector<float> data{0.5f, -1, 2, 0.25f};
+    std::vector<float> expected(data.size());
+    for (size_t k = 0; k < data.size(); k++) {
+        expected[k] = fixed.Step(data[k]);
+        stepped.Step(data[k]);
+    }
+    blocked.StepBlock(data.data(), data.data(), data.size()); // 输出覆盖输入
+    CHECK(data == expected);
+    CHECK(blocked.Step(1, 0.012f) == stepped.Step(1, 0.012f));
+}
+
+// y[k] = y[k-1] + Ki * dt / 2 * (u[k-1] + u[k])
+static void Trapezoid()
+{
+    static_dispatch::VariableTsIntegrator<double> integrator{2, 0.01};
+    integrator.Step(1);
+    double y = integrator.Step(3, 0.02);
+    CHECK(std::abs(y - (0.01 + 2 * 0.02 / 2 * (1 + 3))) < 1e-15);
+}
+
+// dt 不是正数（包括 NaN）时按名义周期，状态不会变成 NaN
+static void InvalidDtUsesNominalTs()
+{
+    static_dispatch::DiscreteIntegrator<float> fixed{1, 0.001f};
+    static_dispatch::VariableTsIntegratorSaturation<float> variable{{1, 0.001f}, {-1, 1}};
+
+    const float invalid[] = {NAN, 0, -0.001f};
+    for (float dt : invalid) {
+        CHECK(variable.Step(1, dt) == fixed.Step(1));
+    }
+    for (int k = 0; k < 5; k++) {
+        CHECK(variable.Step(1) == fixed.Step(1));
+    }
+}
+
+// Q15：u[k-1] + u[k] 超出 [-1, 1) 时分别乘以系数，不在 Q15 中饱和
+static void FixedPointDoesNotSaturateInputSum()
+{
+    static_dispatch::VariableTsIntegrator<Q15> fixed{10, 0.001};
+    static_dispatch::VariableTsIntegrator<double> reference{10, 0.001};
+
+    const double dt[] = {0.0012, 0.0009, 0.00115, 0.00088};
+    double error = 0;
+    fixed.Step(Q15(0.75));
+    reference.Step(0.75);
+    for (int k = 0; k < 40; k++) {
+        double y = double(fixed.Step(Q15(0.75), dt[k % 4]));
+        error    = std::max(error, std::abs(y - reference.Step(0.75, dt[k % 4])));
+    }
+    CHECK(error < 1e-4);
+}
+
+// 带限幅的积分器按实测周期积分时也限幅
+static void SaturatedDtStep()
+{
+    VariableTsIntegratorSaturation<float> integrator{{100, 0.01f}, {-1, 1}};
+    for (int k = 0; k < 10; k++) {
+        CHECK(integrator.Step(1, 0.012f) <= 1);
+    }
+}
+
+int main()
+{
+    FixedPathMatchesIntegrator();
+    Trapezoid();
+    InvalidDtUsesNominalTs();
+    FixedPointDoesNotSaturateInputSum();
+    SaturatedDtStep();
+    return CheckFailures();
+}